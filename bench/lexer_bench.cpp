@@ -0,0 +1,326 @@
+// Lexer microbenchmark.
+//
+// Usage: lexer_bench [file.py] [iterations]
+//
+// Without a file a multi-megabyte data-definition module is generated in
+// memory. Reports tokenize() throughput of the previous lexer (kept below
+// as LegacyLexer) and of the current one at every SIMD level, and compares
+// keyword classification and character classification against the
+// previous implementations (std::unordered_map and <cctype>).
+#include "lexer.h"
+#include "scan.h"
+#include "char_class.h"
+#include <chrono>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string generateSource() {
+    std::string source = "# generated data definitions\n";
+    for (int i = 0; i < 60000; ++i) {
+        source += "record_" + std::to_string(i) + " = {\"name\": \"entry number " + std::to_string(i) +
+                  "\", \"value\": " + std::to_string(i * 7919 % 100003) + ".25, \"active\": True}\n";
+        if (i % 100 == 0) {
+            source += "def lookup_" + std::to_string(i) + "(key):\n"
+                      "    if key in record_" + std::to_string(i) + ":\n"
+                      "        return record_" + std::to_string(i) + "[key]\n"
+                      "    return None  # not found\n";
+        }
+    }
+    return source;
+}
+
+// Previous keyword lookup, kept for comparison
+TokenType legacyIdentifierType(const std::string& text) {
+    static const std::unordered_map<std::string, TokenType> keywords = {
+        {"if", TokenType::IF}, {"elif", TokenType::ELIF}, {"else", TokenType::ELSE},
+        {"while", TokenType::WHILE}, {"for", TokenType::FOR}, {"in", TokenType::IN},
+        {"def", TokenType::DEF}, {"return", TokenType::RETURN}, {"class", TokenType::CLASS},
+        {"import", TokenType::IMPORT}, {"from", TokenType::FROM}, {"as", TokenType::AS},
+        {"try", TokenType::TRY}, {"except", TokenType::EXCEPT}, {"True", TokenType::TRUE},
+        {"False", TokenType::FALSE}, {"None", TokenType::NONE}, {"and", TokenType::AND},
+        {"or", TokenType::OR}, {"not", TokenType::NOT}
+    };
+    auto it = keywords.find(text);
+    return it != keywords.end() ? it->second : TokenType::IDENTIFIER;
+}
+
+// The lexer as it was before the SIMD scanners, character tables and
+// perfect-hash keywords: one character at a time through <cctype>, with
+// token text built by appending, so the current lexer has a baseline
+class LegacyLexer {
+public:
+    explicit LegacyLexer(const std::string& source) : source(source) {
+        indent_stack.push_back(0);
+    }
+
+    std::vector<Token> tokenize() {
+        std::vector<Token> tokens;
+        while (!isAtEnd()) {
+            if (at_line_start) {
+                auto indent_tokens = handleIndentation();
+                tokens.insert(tokens.end(), indent_tokens.begin(), indent_tokens.end());
+                at_line_start = false;
+            }
+
+            char c = advance();
+            switch (c) {
+                case ' ':
+                case '\r':
+                case '\t':
+                    break;
+                case '\n':
+                    tokens.push_back(makeToken(TokenType::NEWLINE));
+                    line++;
+                    column = 1;
+                    at_line_start = true;
+                    break;
+                case '#':
+                    while (peek() != '\n' && !isAtEnd()) advance();
+                    break;
+                case '+': tokens.push_back(operatorToken('=', TokenType::PLUS_ASSIGN, "+=", TokenType::PLUS, "+")); break;
+                case '-': tokens.push_back(operatorToken('=', TokenType::MINUS_ASSIGN, "-=", TokenType::MINUS, "-")); break;
+                case '*': tokens.push_back(operatorToken('*', TokenType::POWER, "**", TokenType::MULTIPLY, "*")); break;
+                case '=': tokens.push_back(operatorToken('=', TokenType::EQUAL, "==", TokenType::ASSIGN, "=")); break;
+                case '!': tokens.push_back(operatorToken('=', TokenType::NOT_EQUAL, "!=", TokenType::INVALID, "!")); break;
+                case '<': tokens.push_back(operatorToken('=', TokenType::LESS_EQUAL, "<=", TokenType::LESS, "<")); break;
+                case '>': tokens.push_back(operatorToken('=', TokenType::GREATER_EQUAL, ">=", TokenType::GREATER, ">")); break;
+                case '/': tokens.push_back(makeToken(TokenType::DIVIDE, "/")); break;
+                case '%': tokens.push_back(makeToken(TokenType::MODULO, "%")); break;
+                case '(': tokens.push_back(makeToken(TokenType::LEFT_PAREN, "(")); break;
+                case ')': tokens.push_back(makeToken(TokenType::RIGHT_PAREN, ")")); break;
+                case '[': tokens.push_back(makeToken(TokenType::LEFT_BRACKET, "[")); break;
+                case ']': tokens.push_back(makeToken(TokenType::RIGHT_BRACKET, "]")); break;
+                case '{': tokens.push_back(makeToken(TokenType::LEFT_BRACE, "{")); break;
+                case '}': tokens.push_back(makeToken(TokenType::RIGHT_BRACE, "}")); break;
+                case ',': tokens.push_back(makeToken(TokenType::COMMA, ",")); break;
+                case '.': tokens.push_back(makeToken(TokenType::DOT, ".")); break;
+                case ':': tokens.push_back(makeToken(TokenType::COLON, ":")); break;
+                case ';': tokens.push_back(makeToken(TokenType::SEMICOLON, ";")); break;
+                case '"':
+                case '\'':
+                    current--;
+                    tokens.push_back(string());
+                    break;
+                default:
+                    if (std::isdigit(c)) {
+                        current--;
+                        tokens.push_back(number());
+                    } else if (std::isalpha(c) || c == '_') {
+                        current--;
+                        tokens.push_back(identifier());
+                    } else {
+                        tokens.push_back(makeToken(TokenType::INVALID, std::string(1, c)));
+                    }
+                    break;
+            }
+        }
+        while (indent_stack.size() > 1) {
+            indent_stack.pop_back();
+            tokens.push_back(makeToken(TokenType::DEDENT));
+        }
+        tokens.push_back(makeToken(TokenType::EOF_TOKEN));
+        return tokens;
+    }
+
+private:
+    std::string source;
+    size_t current = 0;
+    int line = 1;
+    int column = 1;
+    std::vector<int> indent_stack;
+    bool at_line_start = true;
+
+    bool isAtEnd() { return current >= source.length(); }
+    char advance() { column++; return source[current++]; }
+    char peek() { return isAtEnd() ? '\0' : source[current]; }
+    char peekNext() { return current + 1 >= source.length() ? '\0' : source[current + 1]; }
+    Token makeToken(TokenType type, const std::string& value = "") { return Token(type, value, line, column); }
+
+    Token operatorToken(char second, TokenType pair, const char* pair_text, TokenType single, const char* single_text) {
+        if (peek() == second) {
+            advance();
+            return makeToken(pair, pair_text);
+        }
+        return makeToken(single, single_text);
+    }
+
+    Token number() {
+        std::string value;
+        while (std::isdigit(peek())) value += advance();
+        if (peek() == '.' && std::isdigit(peekNext())) {
+            value += advance();
+            while (std::isdigit(peek())) value += advance();
+        }
+        return makeToken(TokenType::NUMBER, value);
+    }
+
+    Token string() {
+        char quote = advance();
+        std::string value;
+        while (peek() != quote && !isAtEnd()) {
+            if (peek() == '\n') line++;
+            if (peek() == '\\') {
+                advance();
+                char escaped = advance();
+                switch (escaped) {
+                    case 'n': value += '\n'; break;
+                    case 't': value += '\t'; break;
+                    case 'r': value += '\r'; break;
+                    default: value += escaped; break;
+                }
+            } else {
+                value += advance();
+            }
+        }
+        if (isAtEnd()) return makeToken(TokenType::INVALID, "Unterminated string");
+        advance();
+        return makeToken(TokenType::STRING, value);
+    }
+
+    Token identifier() {
+        std::string value;
+        while (std::isalnum(peek()) || peek() == '_') value += advance();
+        return makeToken(legacyIdentifierType(value), value);
+    }
+
+    std::vector<Token> handleIndentation() {
+        std::vector<Token> tokens;
+        int spaces = 0;
+        while (peek() == ' ') {
+            spaces++;
+            advance();
+        }
+        if (peek() == '\n' || peek() == '#') return tokens;
+        if (spaces > indent_stack.back()) {
+            indent_stack.push_back(spaces);
+            tokens.push_back(makeToken(TokenType::INDENT));
+        } else {
+            while (indent_stack.size() > 1 && indent_stack.back() > spaces) {
+                indent_stack.pop_back();
+                tokens.push_back(makeToken(TokenType::DEDENT));
+            }
+        }
+        return tokens;
+    }
+};
+
+void benchTokenize(const std::string& source, int iterations) {
+    size_t legacy_tokens = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        LegacyLexer lexer(source);
+        legacy_tokens += lexer.tokenize().size();
+    }
+    double legacy = secondsSince(start);
+    std::cout << "tokenize (legacy): " << static_cast<long>(legacy_tokens / legacy) << " tokens/s, "
+              << source.size() * iterations / legacy / 1e6 << " MB/s" << std::endl;
+
+    const scan::SimdLevel levels[] = {scan::SimdLevel::SCALAR, scan::SimdLevel::SSE2, scan::SimdLevel::AVX2};
+    for (scan::SimdLevel level : levels) {
+        scan::setSimdLevel(level);
+        if (scan::simdLevel() != level) continue; // not supported here
+
+        size_t tokens = 0;
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            Lexer lexer(source);
+            tokens += lexer.tokenize().size();
+        }
+        double seconds = secondsSince(start);
+        std::cout << "tokenize (" << scan::simdLevelName(level) << "): "
+                  << static_cast<long>(tokens / seconds) << " tokens/s, "
+                  << source.size() * iterations / seconds / 1e6 << " MB/s, "
+                  << legacy / seconds << "x legacy" << (tokens == legacy_tokens ? "" : " (token count differs)")
+                  << std::endl;
+    }
+}
+
+void benchKeywords(const std::string& source, int iterations) {
+    // Every identifier in the input, as the lexer would see it
+    std::vector<std::string> words;
+    for (size_t i = 0; i < source.size();) {
+        if (charclass::isIdentifierStart(source[i])) {
+            size_t start = i;
+            while (i < source.size() && charclass::isIdentifierChar(source[i])) ++i;
+            words.push_back(source.substr(start, i - start));
+        } else {
+            ++i;
+        }
+    }
+
+    size_t keywords = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto& word : words) keywords += legacyIdentifierType(word) != TokenType::IDENTIFIER;
+    }
+    double legacy = secondsSince(start);
+
+    size_t check = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto& word : words) check += Lexer::identifierType(word) != TokenType::IDENTIFIER;
+    }
+    double perfect = secondsSince(start);
+
+    double lookups = static_cast<double>(words.size()) * iterations;
+    std::cout << "keyword lookup: unordered_map " << lookups / legacy / 1e6 << " M/s, perfect hash "
+              << lookups / perfect / 1e6 << " M/s" << (check == keywords ? "" : " (MISMATCH)") << std::endl;
+}
+
+void benchCharClasses(const std::string& source, int iterations) {
+    size_t legacy_count = 0;
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (char c : source) legacy_count += std::isalnum(c) || c == '_';
+    }
+    double legacy = secondsSince(start);
+
+    size_t table_count = 0;
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (char c : source) table_count += charclass::isIdentifierChar(c);
+    }
+    double table = secondsSince(start);
+
+    double bytes = static_cast<double>(source.size()) * iterations;
+    std::cout << "identifier char test: <cctype> " << bytes / legacy / 1e6 << " MB/s, table "
+              << bytes / table / 1e6 << " MB/s" << (legacy_count == table_count ? "" : " (MISMATCH)") << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string source;
+    if (argc > 1) {
+        std::ifstream file(argv[1]);
+        if (!file.is_open()) {
+            std::cerr << "Could not open file: " << argv[1] << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+    } else {
+        source = generateSource();
+    }
+    int iterations = argc > 2 ? std::stoi(argv[2]) : 5;
+
+    std::cout << "input: " << source.size() / 1024 << " KiB, " << iterations << " iterations" << std::endl;
+    benchTokenize(source, iterations);
+    benchKeywords(source, iterations);
+    benchCharClasses(source, iterations);
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Parser microbenchmark.
+//
+// Usage: parser_bench [file.py ...] [-n iterations] [-j threads]
+//
+// Without files an expression-heavy synthetic module is generated in
+// memory. Each input is tokenized once; only Parser::parse() is timed.
+// With -j, lexing plus parsing is also timed serially and through
+// ParallelParser with the given number of threads (0 = one per core).
+// Loading the same programs back from their flat AST encoding is timed too.
+#include "lexer.h"
+#include "parser.h"
+#include "parallel_parser.h"
+#include "flat_ast.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string generateSource() {
+    std::string source;
+    for (int i = 0; i < 20000; ++i) {
+        std::string n = std::to_string(i);
+        source += "value_" + n + " = (a_" + n + " + b * 3 - c / 2) % 7 ** 2 >= limit and not flag or -x < y\n";
+        source += "items_" + n + " = [1, 2.5, \"text\", {\"key\": obj.field[0]}, f(1, g(2), h[i + 1])]\n";
+        if (i % 50 == 0) {
+            source += "def helper_" + n + "(p, q):\n"
+                      "    if p == q or p != None:\n"
+                      "        return p * q + 1\n"
+                      "    return obj.method(p, q - 1)\n";
+        }
+    }
+    return source;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> sources;
+    int iterations = 5;
+    int threads = -1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            iterations = std::stoi(argv[++i]);
+            continue;
+        }
+        if (arg == "-j" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+            continue;
+        }
+        std::ifstream file(arg);
+        if (!file.is_open()) {
+            std::cerr << "Could not open file: " << arg << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        sources.push_back(buffer.str());
+    }
+    if (sources.empty()) {
+        sources.push_back(generateSource());
+    }
+
+    std::vector<std::vector<Token>> inputs;
+    size_t bytes = 0;
+    size_t token_count = 0;
+    for (const auto& source : sources) {
+        Lexer lexer(source);
+        inputs.push_back(lexer.tokenize());
+        bytes += source.size();
+        token_count += inputs.back().size();
+    }
+
+    // Copies are made up front: Parser takes its tokens by value
+    std::vector<std::vector<Token>> copies;
+    for (int i = 0; i < iterations; ++i) {
+        copies.insert(copies.end(), inputs.begin(), inputs.end());
+    }
+
+    size_t statements = 0;
+    auto start = Clock::now();
+    for (auto& tokens : copies) {
+        Parser parser(std::move(tokens));
+        statements += parser.parse()->statements.size();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "input: " << bytes / 1024 << " KiB, " << token_count << " tokens, "
+              << statements / iterations << " statements, " << iterations << " iterations" << std::endl;
+    std::cout << "parse: " << static_cast<long>(token_count * iterations / seconds) << " tokens/s, "
+              << seconds * 1000 / iterations << " ms per pass" << std::endl;
+
+    std::vector<flat::FlatAst> flattened;
+    size_t flat_nodes = 0;
+    for (const auto& source : sources) {
+        Lexer lexer(source);
+        Parser parser(lexer.tokenize());
+        flattened.emplace_back(*parser.parse());
+        flat_nodes += flattened.back().view().node_count;
+    }
+    start = Clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const auto& ast : flattened) {
+            ast.view().inflate();
+        }
+    }
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "inflate flat AST: " << flat_nodes << " nodes, " << seconds * 1000 / iterations
+              << " ms per pass" << std::endl;
+
+    if (threads >= 0) {
+        for (unsigned count : {1u, static_cast<unsigned>(threads)}) {
+            start = Clock::now();
+            for (int i = 0; i < iterations; ++i) {
+                for (const auto& source : sources) {
+                    ParallelParser::parse(source, count);
+                }
+            }
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            std::cout << "lex + parse, " << (count == 0 ? std::string("all") : std::to_string(count))
+                      << " thread(s): " << seconds * 1000 / iterations << " ms per pass" << std::endl;
+        }
+    }
+    return 0;
+}
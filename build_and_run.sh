@@ -29,7 +29,7 @@ echo ""
 
 # Run the executable
 echo "=== Running LangProject ==="
-./LangProject
+./LangProject --demo
 
 echo ""
 echo "=== Script completed ==="
@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# Edits a module while a REPL session has it imported, and checks that
+# reload(module) and --watch pick up the edited file
+# Usage: ./run_reload_tests.sh
+
+# Build if needed
+if [ ! -f "build/LangProject" ]; then
+    echo "Building project..."
+    mkdir -p build
+    cd build
+    cmake .. && make
+    cd ..
+fi
+
+lang="$(pwd)/build/LangProject"
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+write_first_version() {
+    cat > "$work/greeting.py" <<'EOF'
+def message(name):
+    return "hello " + name
+
+version = 1
+EOF
+}
+
+write_edited_version() {
+    cat > "$work/greeting.py" <<'EOF'
+def message(name):
+    return "hi " + name + "!"
+
+def shout(name):
+    return "HEY " + name
+
+version = 2
+EOF
+}
+
+# Waits until the session has printed a line starting with $1
+wait_for_output() {
+    for _ in $(seq 100); do
+        if grep -q "^$1" "$work/output"; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    return 1
+}
+
+# run_session OPTIONS FIRST SECOND: feeds the REPL the first phase, edits
+# greeting.py once its output is in, then feeds the second phase
+run_session() {
+    write_first_version
+    : > "$work/output"
+    (
+        cd "$work"
+        {
+            printf '%s\n' "$2"
+            wait_for_output "phase 1:"
+            write_edited_version
+            printf '%s\n' "$3"
+        } | "$lang" $1 > output 2>&1
+    )
+}
+
+passed=0
+total=0
+
+check() {
+    ((total++))
+    echo -n "Running $1... "
+    # Everything from the first phase's output on, past the banner
+    session=$(sed -n '/^phase 1:/,$p' "$work/output")
+    if [ "$session" == "$2" ]; then
+        echo "PASS"
+        ((passed++))
+    else
+        echo "FAIL"
+        echo "Expected:"
+        echo "$2"
+        echo "Got:"
+        cat "$work/output"
+    fi
+}
+
+echo "Running reload tests..."
+echo "====================="
+
+# The edit is only seen once the module is reloaded; functions taken from
+# the old version keep running its code
+run_session "" '
+import greeting
+old_message = greeting.message
+print("phase 1:", greeting.version, greeting.message("ann"))
+' '
+print("before reload:", greeting.version, greeting.message("ann"))
+same = reload(greeting)
+print("same module:", same == greeting)
+print("after reload:", greeting.version, greeting.message("ann"), greeting.shout("bo"))
+print("old message:", old_message("ann"))
+'
+check "reload(module)" 'phase 1: 1 hello ann
+before reload: 1 hello ann
+same module: True
+after reload: 2 hi ann! HEY bo
+old message: hello ann'
+
+# With --watch the session re-executes the edited module before the next input
+run_session "--watch" '
+import greeting
+print("phase 1:", greeting.version, greeting.message("ann"))
+' '
+print("phase 2:", greeting.version, greeting.message("ann"), greeting.shout("bo"))
+'
+check "--watch" 'phase 1: 1 hello ann
+phase 2: 2 hi ann! HEY bo'
+
+echo "====================="
+echo "Results: $passed/$total tests passed"
+[ "$passed" == "$total" ]
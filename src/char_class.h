@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Character classes for the lexer, computed at compile time. Unlike <cctype>
+// these do not depend on the locale, and bytes >= 0x80 are never letters.
+namespace charclass {
+
+enum : uint8_t {
+    DIGIT = 1 << 0,
+    ALPHA = 1 << 1,
+    UNDERSCORE = 1 << 2,
+    BLANK = 1 << 3   // ' ', '\t', '\r'; newlines are tokens
+};
+
+constexpr std::array<uint8_t, 256> makeTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c = '0'; c <= '9'; ++c) table[c] |= DIGIT;
+    for (int c = 'a'; c <= 'z'; ++c) table[c] |= ALPHA;
+    for (int c = 'A'; c <= 'Z'; ++c) table[c] |= ALPHA;
+    table['_'] |= UNDERSCORE;
+    table[' '] |= BLANK;
+    table['\t'] |= BLANK;
+    table['\r'] |= BLANK;
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> table = makeTable();
+
+constexpr uint8_t of(char c) {
+    return table[static_cast<unsigned char>(c)];
+}
+
+constexpr bool isDigit(char c) {
+    return of(c) & DIGIT;
+}
+
+constexpr bool isIdentifierStart(char c) {
+    return of(c) & (ALPHA | UNDERSCORE);
+}
+
+constexpr bool isIdentifierChar(char c) {
+    return of(c) & (ALPHA | UNDERSCORE | DIGIT);
+}
+
+constexpr bool isBlank(char c) {
+    return of(c) & BLANK;
+}
+
+static_assert(isIdentifierStart('_') && !isIdentifierStart('7') && isIdentifierChar('7'));
+static_assert(!isIdentifierChar(static_cast<char>(0xE9)), "non-ASCII bytes are not letters");
+
+} // namespace charclass
@@ -0,0 +1,213 @@
+#include "coroutine.h"
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// AddressSanitizer has to be told about stack switches
+#if defined(__SANITIZE_ADDRESS__)
+#define COROUTINE_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define COROUTINE_ASAN 1
+#endif
+#endif
+
+#ifdef COROUTINE_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+namespace {
+
+void startSwitch([[maybe_unused]] void** fake_stack, [[maybe_unused]] const void* bottom,
+                 [[maybe_unused]] size_t size) {
+#ifdef COROUTINE_ASAN
+    __sanitizer_start_switch_fiber(fake_stack, bottom, size);
+#endif
+}
+
+void finishSwitch([[maybe_unused]] void* fake_stack, [[maybe_unused]] const void** old_bottom,
+                  [[maybe_unused]] size_t* old_size) {
+#ifdef COROUTINE_ASAN
+    __sanitizer_finish_switch_fiber(fake_stack, old_bottom, old_size);
+#endif
+}
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace
+
+#ifdef COROUTINE_X86_64_SWITCH
+// switch_stack(save, load) pushes the callee-saved registers and the SSE and
+// x87 control words, stores the stack pointer in *save, then pops the same
+// from load and returns on that stack. A new stack is laid out so that its
+// first switch returns into start_stack, which calls r13(r12) and marks the
+// end of the call chain for unwinders.
+extern "C" {
+void lang_coroutine_switch_stack(void** save, void* load);
+void lang_coroutine_start_stack();
+}
+
+asm(R"(
+    .pushsection .text
+    .globl lang_coroutine_switch_stack
+    .hidden lang_coroutine_switch_stack
+    .type lang_coroutine_switch_stack, @function
+lang_coroutine_switch_stack:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size lang_coroutine_switch_stack, .-lang_coroutine_switch_stack
+
+    .globl lang_coroutine_start_stack
+    .hidden lang_coroutine_start_stack
+    .type lang_coroutine_start_stack, @function
+lang_coroutine_start_stack:
+    .cfi_startproc
+    .cfi_undefined rip
+    movq %r12, %rdi
+    callq *%r13
+    ud2
+    .cfi_endproc
+    .size lang_coroutine_start_stack, .-lang_coroutine_start_stack
+    .popsection
+)");
+#endif
+
+Coroutine* Coroutine::running = nullptr;
+
+Coroutine::Coroutine(std::function<void()> body) : body(std::move(body)) {}
+
+Coroutine::~Coroutine() {
+    if (stack) {
+        munmap(stack, STACK_SIZE + pageSize());
+    }
+}
+
+void Coroutine::resume() {
+    if (done) {
+        throw std::logic_error("resuming a finished coroutine");
+    }
+    
+    if (!stack) {
+        // The lowest page stays inaccessible so an overflow faults
+        void* mapping = mmap(nullptr, STACK_SIZE + pageSize(), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Could not allocate a generator stack");
+        }
+        mprotect(mapping, pageSize(), PROT_NONE);
+        stack = mapping;
+        
+#ifdef COROUTINE_X86_64_SWITCH
+        // What switch_stack pops, from the top of the (page aligned) stack
+        // down: the return address, rbp, rbx, r12, r13, r14, r15 and the
+        // control words, which start out as the resumer's
+        void** top = reinterpret_cast<void**>(static_cast<char*>(stack) + pageSize() + STACK_SIZE);
+        void** sp = top;
+        *--sp = reinterpret_cast<void*>(&lang_coroutine_start_stack);
+        *--sp = nullptr;                                        // rbp
+        *--sp = nullptr;                                        // rbx
+        *--sp = this;                                           // r12
+        *--sp = reinterpret_cast<void*>(&Coroutine::start);     // r13
+        *--sp = nullptr;                                        // r14
+        *--sp = nullptr;                                        // r15
+        uint32_t control[2] = {0, 0};
+        asm volatile("stmxcsr %0" : "=m"(control[0]));
+        asm volatile("fnstcw %0" : "=m"(control[1]));
+        *--sp = nullptr;
+        std::memcpy(sp, control, sizeof(control));
+        context = sp;
+#else
+        getcontext(&context);
+        context.uc_stack.ss_sp = static_cast<char*>(stack) + pageSize();
+        context.uc_stack.ss_size = STACK_SIZE;
+        context.uc_link = nullptr;
+        // makecontext only passes ints, so the pointer travels in two halves
+        uintptr_t self = reinterpret_cast<uintptr_t>(this);
+        makecontext(&context, reinterpret_cast<void (*)()>(&Coroutine::entry), 2,
+                    static_cast<unsigned>(self >> 32), static_cast<unsigned>(self & 0xFFFFFFFFu));
+#endif
+    }
+    
+    Coroutine* outer = running;
+    running = this;
+    void* fake_stack = nullptr;
+    startSwitch(&fake_stack, static_cast<char*>(stack) + pageSize(), STACK_SIZE);
+#ifdef COROUTINE_X86_64_SWITCH
+    lang_coroutine_switch_stack(&caller, context);
+#else
+    swapcontext(&caller, &context);
+#endif
+    finishSwitch(fake_stack, nullptr, nullptr);
+    running = outer;
+    
+    if (error) {
+        std::exception_ptr escaped = std::move(error);
+        error = nullptr;
+        std::rethrow_exception(escaped);
+    }
+}
+
+void Coroutine::suspend() {
+    Coroutine* self = running;
+    if (!self) {
+        throw std::logic_error("suspending outside a coroutine");
+    }
+    void* fake_stack = nullptr;
+    startSwitch(&fake_stack, self->caller_stack, self->caller_stack_size);
+#ifdef COROUTINE_X86_64_SWITCH
+    lang_coroutine_switch_stack(&self->context, self->caller);
+#else
+    swapcontext(&self->context, &self->caller);
+#endif
+    // Resumed, possibly by different code than last time
+    finishSwitch(fake_stack, &self->caller_stack, &self->caller_stack_size);
+}
+
+#ifndef COROUTINE_X86_64_SWITCH
+void Coroutine::entry(unsigned high, unsigned low) {
+    start(reinterpret_cast<Coroutine*>((static_cast<uintptr_t>(high) << 32) | low));
+}
+#endif
+
+void Coroutine::start(Coroutine* self) {
+    finishSwitch(nullptr, &self->caller_stack, &self->caller_stack_size);
+    
+    try {
+        self->body();
+    } catch (...) {
+        self->error = std::current_exception();
+    }
+    self->done = true;
+    
+    // Never resumed again; a null fake stack tells ASan this stack is done
+    startSwitch(nullptr, self->caller_stack, self->caller_stack_size);
+#ifdef COROUTINE_X86_64_SWITCH
+    lang_coroutine_switch_stack(&self->context, self->caller);
+#else
+    setcontext(&self->caller);
+#endif
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <functional>
+
+// On x86-64 ELF targets stacks are switched by a few instructions of our own;
+// elsewhere ucontext is used, whose swapcontext also saves the signal mask
+// with a system call on every switch
+#if defined(__x86_64__) && defined(__ELF__)
+#define COROUTINE_X86_64_SWITCH 1
+#else
+#include <ucontext.h>
+#endif
+
+// Stackful coroutines, the resumable frames behind generators.
+//
+// The body runs on a stack of its own, so it can suspend itself from any
+// depth of nested interpreter calls and later continue where it left off
+// with all of its C++ frames intact. Coroutines nest: a body may resume
+// another coroutine, and suspend() always returns to whoever resumed the
+// running one. A body must not suspend while a C++ exception is being
+// handled, since the runtime's record of caught exceptions is per thread.
+class Coroutine {
+public:
+    // Reserved address space per stack; pages are only committed when touched
+    static constexpr size_t STACK_SIZE = 1 << 20;
+    
+    explicit Coroutine(std::function<void()> body);
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+    // Frees the stack without unwinding it: the body must have returned (or
+    // never started), or the objects on its stack are leaked
+    ~Coroutine();
+    
+    // Runs the body until it suspends or returns. An exception escaping the
+    // body finishes the coroutine and is rethrown here.
+    void resume();
+    
+    // Called from inside a body: returns to the caller of resume()
+    static void suspend();
+    
+    bool started() const { return stack != nullptr; }
+    bool finished() const { return done; }
+    
+private:
+    std::function<void()> body;
+    void* stack = nullptr; // mapping including the guard page, allocated on first resume
+#ifdef COROUTINE_X86_64_SWITCH
+    // Saved stack pointers of the suspended body and of its resumer
+    void* context = nullptr;
+    void* caller = nullptr;
+#else
+    ucontext_t context;
+    ucontext_t caller;
+#endif
+    bool done = false;
+    std::exception_ptr error;
+    // Stack of the code that resumed us, for AddressSanitizer
+    const void* caller_stack = nullptr;
+    size_t caller_stack_size = 0;
+    
+    static Coroutine* running;
+    static void start(Coroutine* self);
+#ifndef COROUTINE_X86_64_SWITCH
+    static void entry(unsigned high, unsigned low);
+#endif
+};
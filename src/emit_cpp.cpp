@@ -0,0 +1,879 @@
+#include "emit_cpp.h"
+#include "flat_ast.h"
+#include "lexer.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Set by the build; see CMakeLists.txt
+#ifndef LANG_RUNTIME_INCLUDE_DIR
+#define LANG_RUNTIME_INCLUDE_DIR "src"
+#endif
+#ifndef LANG_RUNTIME_LIBRARY
+#define LANG_RUNTIME_LIBRARY "liblang_runtime.a"
+#endif
+
+namespace {
+
+// Single-quoted for /bin/sh
+std::string shellQuote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+// Keeps a file name from ending the comment it appears in
+std::string commentSafe(const std::string& text) {
+    std::string safe;
+    for (char c : text) {
+        safe += (c == '\n' || c == '\r') ? ' ' : c;
+    }
+    return safe;
+}
+
+// As a C++ string literal; bytes other than printable ASCII are written as
+// three-digit octal escapes, which cannot run into the next character
+std::string quoted(const std::string& text) {
+    std::string literal = "\"";
+    char escape[8];
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        } else if (byte < 0x20 || byte >= 0x7f) {
+            std::snprintf(escape, sizeof(escape), "\\%03o", byte);
+            literal += escape;
+        } else {
+            literal += c;
+        }
+    }
+    return literal + "\"";
+}
+
+// As a C++ double literal that reads back as the same value
+std::string numberLiteral(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", value);
+    std::string literal = text;
+    if (literal.find_first_of(".e") == std::string::npos) {
+        literal += ".0";
+    }
+    return literal;
+}
+
+// Operators the runtime applies with performBinaryOp/performUnaryOp, by name
+const char* operatorName(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS: return "PLUS";
+        case TokenType::MINUS: return "MINUS";
+        case TokenType::MULTIPLY: return "MULTIPLY";
+        case TokenType::DIVIDE: return "DIVIDE";
+        case TokenType::MODULO: return "MODULO";
+        case TokenType::EQUAL: return "EQUAL";
+        case TokenType::NOT_EQUAL: return "NOT_EQUAL";
+        case TokenType::LESS: return "LESS";
+        case TokenType::LESS_EQUAL: return "LESS_EQUAL";
+        case TokenType::GREATER: return "GREATER";
+        case TokenType::GREATER_EQUAL: return "GREATER_EQUAL";
+        case TokenType::AND: return "AND";
+        case TokenType::OR: return "OR";
+        case TokenType::NOT: return "NOT";
+        default: return nullptr;
+    }
+}
+
+void writeBytes(const std::string& bytes, std::ostream& out) {
+    char hex[8];
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        out << (i % 16 == 0 ? "\n    " : " ");
+        std::snprintf(hex, sizeof(hex), "0x%02x,", static_cast<unsigned char>(bytes[i]));
+        out << hex;
+    }
+}
+
+// Translates module-level statements and function bodies into C++ functions
+// over EmittedProgram. Expressions become a sequence of temporaries, so
+// operands are evaluated in the interpreter's order; a node with no
+// translation is left to the interpreter by its flat AST index.
+class Translator {
+public:
+    explicit Translator(const std::unordered_map<const ASTNode*, uint32_t>& indices) : indices(indices) {}
+
+    std::ostringstream code;
+    std::vector<std::string> names;      // Symbols used, in first-use order
+    std::vector<std::string> constants;  // literal values, made once
+    size_t translated = 0;
+    size_t interpreted = 0;
+
+    // ExecStatus function_name(EmittedProgram& rt) running stmts. In a body
+    // with a number frame, unboxed number locals are read and written there
+    void function(const std::string& function_name, const std::vector<std::unique_ptr<Statement>>& stmts,
+                  bool number_frame) {
+        code << "ExecStatus " << function_name << "(EmittedProgram& rt) {\n";
+        numbers = number_frame;
+        temporaries = 0;
+        statements(stmts);
+        code << "    return ExecStatus::NORMAL;\n"
+             << "}\n";
+    }
+
+private:
+    const std::unordered_map<const ASTNode*, uint32_t>& indices;
+    std::unordered_map<std::string, size_t> name_ids;
+    std::unordered_map<std::string, size_t> constant_ids;
+    size_t temporaries = 0;
+    int depth = 1;
+    bool numbers = false;
+
+    std::ostream& line() {
+        return code << std::string(static_cast<size_t>(depth) * 4, ' ');
+    }
+
+    uint32_t index(const ASTNode& node) const {
+        auto it = indices.find(&node);
+        if (it == indices.end()) {
+            throw std::runtime_error("Node missing from the flat AST");
+        }
+        return it->second;
+    }
+
+    std::string name(Symbol symbol) {
+        auto [it, added] = name_ids.emplace(symbol.str(), names.size());
+        if (added) {
+            names.push_back(symbol.str());
+        }
+        return "names[" + std::to_string(it->second) + "]";
+    }
+
+    // One value serves every evaluation of a literal: numbers, booleans and
+    // None are never changed in place, and a string only is when nothing
+    // but the binding being assigned refers to it
+    std::string constant(const std::string& make) {
+        auto [it, added] = constant_ids.emplace(make, constants.size());
+        if (added) {
+            constants.push_back(make);
+        }
+        return "constants[" + std::to_string(it->second) + "]";
+    }
+
+    std::string temporary() {
+        return std::to_string(temporaries++);
+    }
+
+    void open() {
+        line() << "{\n";
+        ++depth;
+    }
+
+    void close() {
+        --depth;
+        line() << "}\n";
+    }
+
+    void statements(const std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (const auto& stmt : stmts) statement(*stmt);
+    }
+
+    void interpret(const Statement& stmt) {
+        ++interpreted;
+        line() << "if (rt.execute(" << index(stmt) << ") == ExecStatus::RETURN) return ExecStatus::RETURN;\n";
+    }
+
+    // A block body, run in a scope of its own
+    void block(const BlockStatement& body) {
+        line() << "EmittedProgram::Block block(rt);\n";
+        statements(body.statements);
+    }
+
+    void statement(const Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::EXPRESSION_STMT: {
+                const Expression& expr = *static_cast<const ExpressionStatement&>(stmt).expression;
+                begin();
+                if (stopsIteration(expr)) {
+                    line() << "if (rt.stopIteration(" << index(expr) << ")) return ExecStatus::RETURN;\n";
+                }
+                std::string expression = value(expr);
+                line() << expression << ";\n";
+                close();
+                break;
+            }
+            case NodeType::ASSIGNMENT_STMT:
+                assignment(static_cast<const AssignmentStatement&>(stmt));
+                break;
+            case NodeType::ATTRIBUTE_ASSIGNMENT_STMT:
+                attributeAssignment(static_cast<const AttributeAssignmentStatement&>(stmt));
+                break;
+            case NodeType::INDEX_ASSIGNMENT_STMT:
+                indexAssignment(static_cast<const IndexAssignmentStatement&>(stmt));
+                break;
+            case NodeType::IF_STMT: {
+                const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+                begin();
+                std::string test = condition(*if_stmt.condition);
+                line() << "if (" << test << ") {\n";
+                ++depth;
+                block(*if_stmt.then_branch);
+                --depth;
+                if (if_stmt.else_branch) {
+                    line() << "} else {\n";
+                    ++depth;
+                    if (if_stmt.else_branch->type == NodeType::BLOCK_STMT) {
+                        block(static_cast<const BlockStatement&>(*if_stmt.else_branch));
+                    } else {
+                        statement(*if_stmt.else_branch);
+                    }
+                    --depth;
+                }
+                line() << "}\n";
+                close();
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                const auto& while_stmt = static_cast<const WhileStatement&>(stmt);
+                begin();
+                line() << "while (true) {\n";
+                ++depth;
+                open();
+                std::string test = condition(*while_stmt.condition);
+                line() << "if (!(" << test << ")) break;\n";
+                close();
+                block(*while_stmt.body);
+                close();
+                close();
+                break;
+            }
+            case NodeType::FOR_STMT: {
+                const auto& for_stmt = static_cast<const ForStatement&>(stmt);
+                begin();
+                std::string id = temporary();
+                std::string iterable = operand(*for_stmt.iterable);
+                line() << "auto iterator" << id << " = rt.iterate(" << iterable << ");\n";
+                line() << "Value item" << id << ";\n";
+                line() << "while (iterator" << id << "->next(item" << id << ")) {\n";
+                ++depth;
+                line() << "rt.bind(" << name(for_stmt.variable) << ", item" << id << ");\n";
+                block(*for_stmt.body);
+                close();
+                close();
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                const auto& return_stmt = static_cast<const ReturnStatement&>(stmt);
+                begin();
+                std::string result = return_stmt.value ? value(*return_stmt.value) : constant("makeValue(nullptr)");
+                line() << "return rt.returnValue(" << result << ");\n";
+                close();
+                break;
+            }
+            case NodeType::YIELD_STMT: {
+                const auto& yield_stmt = static_cast<const YieldStatement&>(stmt);
+                begin();
+                std::string yielded = yield_stmt.value ? value(*yield_stmt.value) : constant("makeValue(nullptr)");
+                line() << "rt.yield(" << yielded << ");\n";
+                close();
+                break;
+            }
+            case NodeType::TRY_STMT:
+                tryStatement(static_cast<const TryStatement&>(stmt));
+                break;
+            default:
+                // Definitions and imports: the functions a def creates run
+                // their translated bodies all the same
+                interpret(stmt);
+                break;
+        }
+    }
+
+    // Opens the C++ block holding a translated statement's temporaries
+    void begin() {
+        ++translated;
+        open();
+        line() << "rt.safePoint();\n";
+    }
+
+    // raise("StopIteration"[, value]), which may end a loop's __next__ call
+    // instead of raising (see Interpreter::isStopIterationRaise)
+    static bool stopsIteration(const Expression& expr) {
+        if (expr.type != NodeType::CALL_EXPR) return false;
+        const auto& call = static_cast<const CallExpression&>(expr);
+        return call.callee->type == NodeType::IDENTIFIER_EXPR &&
+               static_cast<const IdentifierExpression&>(*call.callee).name == "raise" &&
+               !call.arguments.empty() && call.arguments.size() <= 2 &&
+               call.arguments[0]->type == NodeType::STRING_EXPR &&
+               static_cast<const StringExpression&>(*call.arguments[0]).value == "StopIteration";
+    }
+
+    void assignment(const AssignmentStatement& assign) {
+        const Expression& value_expr = *assign.value;
+        if (assign.number_slot >= 0 && numbers) {
+            begin();
+            std::string number_code = number(value_expr);
+            line() << "rt.number(" << assign.number_slot << ") = " << number_code << ";\n";
+            close();
+            return;
+        }
+        // name op= operand and name = name + piece read the binding first,
+        // so a list can grow in place and a string be appended to
+        if (value_expr.type == NodeType::BINARY_EXPR) {
+            const auto& binary = static_cast<const BinaryExpression&>(value_expr);
+            bool reads_target = binary.left->type == NodeType::IDENTIFIER_EXPR &&
+                                static_cast<const IdentifierExpression&>(*binary.left).name == assign.identifier &&
+                                static_cast<const IdentifierExpression&>(*binary.left).slot == assign.slot &&
+                                static_cast<const IdentifierExpression&>(*binary.left).number_slot < 0;
+            if (reads_target && operatorName(binary.operator_type) &&
+                (assign.augmented || binary.operator_type == TokenType::PLUS)) {
+                begin();
+                std::string left = operand(*binary.left);
+                std::string right = operand(*binary.right);
+                std::string target = assign.slot >= 0 ? std::to_string(assign.slot) : name(assign.identifier);
+                const char* suffix = assign.slot >= 0 ? "Parameter(" : "(";
+                if (assign.augmented) {
+                    line() << "rt.update" << suffix << target << ", TokenType::"
+                           << operatorName(binary.operator_type) << ", " << left << ", " << right << ");\n";
+                } else {
+                    line() << "rt.concatenate" << suffix << target << ", " << left << ", " << right << ");\n";
+                }
+                close();
+                return;
+            }
+        }
+        if (assign.augmented) {
+            interpret(assign);
+            return;
+        }
+        begin();
+        std::string value_code = value(value_expr);
+        if (assign.slot >= 0) {
+            line() << "rt.parameter(" << assign.slot << ") = " << value_code << ";\n";
+        } else {
+            line() << "rt.store(" << name(assign.identifier) << ", " << value_code << ");\n";
+        }
+        close();
+    }
+
+    void attributeAssignment(const AttributeAssignmentStatement& assign) {
+        if (!assign.augmented) {
+            begin();
+            std::string object = operand(*assign.object);
+            std::string value_code = operand(*assign.value);
+            line() << "rt.setAttribute(" << object << ", " << name(assign.attribute) << ", " << value_code << ");\n";
+            close();
+            return;
+        }
+        // The interpreter evaluates the object again when the instance has
+        // no such attribute yet, which only a name can do unobserved
+        if (assign.object->type != NodeType::IDENTIFIER_EXPR || assign.value->type != NodeType::BINARY_EXPR) {
+            interpret(assign);
+            return;
+        }
+        const auto& binary = static_cast<const BinaryExpression&>(*assign.value);
+        if (binary.left->type != NodeType::ATTRIBUTE_EXPR || !operatorName(binary.operator_type)) {
+            interpret(assign);
+            return;
+        }
+        begin();
+        std::string object = operand(*assign.object);
+        std::string left = "v" + temporary();
+        line() << "Value " << left << " = rt.attribute(" << object << ", " << name(assign.attribute) << ");\n";
+        std::string right = operand(*binary.right);
+        line() << "rt.updateAttribute(" << object << ", " << name(assign.attribute) << ", TokenType::"
+               << operatorName(binary.operator_type) << ", " << left << ", " << right << ");\n";
+        close();
+    }
+
+    // The operand is evaluated after the target for an augmented assignment
+    // and before it for a plain one, as in executeIndexAssignment
+    void indexAssignment(const IndexAssignmentStatement& assign) {
+        bool augmented = assign.op != TokenType::ASSIGN;
+        if (augmented && !operatorName(assign.op)) {
+            interpret(assign);
+            return;
+        }
+        begin();
+        std::string value_code = augmented ? "" : operand(*assign.value);
+        std::string object = operand(*assign.object);
+        std::string index_code = operand(*assign.index);
+        if (augmented) {
+            std::string current = "v" + temporary();
+            line() << "Value " << current << " = getItem(" << object << ", " << index_code << ");\n";
+            std::string operand_code = operand(*assign.value);
+            value_code = "rt.augment(TokenType::" + std::string(operatorName(assign.op)) + ", " + current + ", " +
+                         operand_code + ")";
+        }
+        line() << "setItem(" << object << ", " << index_code << ", " << value_code << ");\n";
+        close();
+    }
+
+    // The handler runs after the C++ catch is over, as in executeTry
+    void tryStatement(const TryStatement& try_stmt) {
+        begin();
+        std::string id = temporary();
+        line() << "int handler" << id << " = -1;\n";
+        line() << "Value exception" << id << ";\n";
+        open();
+        line() << "EmittedProgram::Try attempt(rt);\n";
+        line() << "try {\n";
+        ++depth;
+        block(*try_stmt.try_body);
+        --depth;
+        std::string types;
+        for (const auto& clause : try_stmt.except_clauses) {
+            types += (types.empty() ? "" : ", ") + quoted(clause.exception_type);
+        }
+        line() << "} catch (const std::runtime_error& error) {\n";
+        ++depth;
+        line() << "handler" << id << " = rt.handler(error, {" << types << "}, exception" << id << ");\n";
+        line() << "if (handler" << id << " < 0) throw;\n";
+        --depth;
+        line() << "}\n";
+        close();
+        for (size_t i = 0; i < try_stmt.except_clauses.size(); ++i) {
+            const ExceptClause& clause = try_stmt.except_clauses[i];
+            line() << (i == 0 ? "if" : "} else if") << " (handler" << id << " == " << i << ") {\n";
+            ++depth;
+            if (!clause.variable_name.empty()) {
+                line() << "rt.bind(" << name(clause.variable_name) << ", exception" << id << ");\n";
+            }
+            block(*clause.body);
+            --depth;
+        }
+        if (!try_stmt.except_clauses.empty()) {
+            line() << "}\n";
+        }
+        close();
+    }
+
+    // Code for a value that later operands must not be evaluated before:
+    // anything but a literal is computed into a temporary now
+    std::string operand(const Expression& expr) {
+        switch (expr.type) {
+            case NodeType::NUMBER_EXPR:
+            case NodeType::STRING_EXPR:
+            case NodeType::BOOLEAN_EXPR:
+            case NodeType::NONE_EXPR:
+                return value(expr);
+            default: {
+                std::string value_code = value(expr);
+                std::string variable = "v" + temporary();
+                line() << "Value " << variable << " = " << value_code << ";\n";
+                return variable;
+            }
+        }
+    }
+
+    std::string operands(const std::vector<std::unique_ptr<Expression>>& exprs) {
+        std::string list;
+        for (const auto& expr : exprs) {
+            list += (list.empty() ? "" : ", ") + operand(*expr);
+        }
+        return "{" + list + "}";
+    }
+
+    // Both operands unboxed in a number frame: the interpreter computes the
+    // node on doubles (see evaluateUnboxedBinary)
+    bool unboxedOperands(const BinaryExpression& binary) const {
+        return numbers && binary.left->unboxed && binary.right->unboxed;
+    }
+
+    static const char* comparison(TokenType op) {
+        switch (op) {
+            case TokenType::EQUAL: return " == ";
+            case TokenType::NOT_EQUAL: return " != ";
+            case TokenType::LESS: return " < ";
+            case TokenType::LESS_EQUAL: return " <= ";
+            case TokenType::GREATER: return " > ";
+            case TokenType::GREATER_EQUAL: return " >= ";
+            default: return nullptr;
+        }
+    }
+
+    // C++ double expression for a number expression, as evaluateNumber:
+    // unboxed nodes only read literals and number locals, so they need no
+    // temporaries
+    std::string number(const Expression& expr) {
+        if (expr.unboxed) {
+            switch (expr.type) {
+                case NodeType::NUMBER_EXPR: {
+                    double literal = static_cast<const NumberExpression&>(expr).value;
+                    if (!std::isfinite(literal)) break;
+                    return numberLiteral(literal);
+                }
+                case NodeType::IDENTIFIER_EXPR: {
+                    int slot = static_cast<const IdentifierExpression&>(expr).number_slot;
+                    if (slot < 0) break;
+                    return "rt.number(" + std::to_string(slot) + ")";
+                }
+                case NodeType::UNARY_EXPR:
+                    return "(-" + number(*static_cast<const UnaryExpression&>(expr).operand) + ")";
+                case NodeType::BINARY_EXPR: {
+                    const auto& binary = static_cast<const BinaryExpression&>(expr);
+                    switch (binary.operator_type) {
+                        case TokenType::PLUS:
+                            return "(" + number(*binary.left) + " + " + number(*binary.right) + ")";
+                        case TokenType::MINUS:
+                            return "(" + number(*binary.left) + " - " + number(*binary.right) + ")";
+                        case TokenType::MULTIPLY:
+                            return "(" + number(*binary.left) + " * " + number(*binary.right) + ")";
+                        case TokenType::DIVIDE:
+                            return "rt.divide(" + number(*binary.left) + ", " + number(*binary.right) + ")";
+                        case TokenType::MODULO:
+                            return "modulo(" + number(*binary.left) + ", " + number(*binary.right) + ")";
+                        default:
+                            break;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        return "getNumber(" + value(expr) + ")";
+    }
+
+    // C++ condition for the truth of expr
+    std::string condition(const Expression& expr) {
+        if (expr.type == NodeType::BINARY_EXPR) {
+            const auto& binary = static_cast<const BinaryExpression&>(expr);
+            const char* compare = comparison(binary.operator_type);
+            if (compare && !binary.unboxed && unboxedOperands(binary)) {
+                return number(*binary.left) + compare + number(*binary.right);
+            }
+        }
+        return "rt.truthy(" + operand(expr) + ")";
+    }
+
+    // Code for the value of expr, after emitting what its operands need
+    std::string value(const Expression& expr) {
+        switch (expr.type) {
+            case NodeType::NUMBER_EXPR: {
+                double number = static_cast<const NumberExpression&>(expr).value;
+                if (!std::isfinite(number)) break;
+                return constant("makeValue(" + numberLiteral(number) + ")");
+            }
+            case NodeType::STRING_EXPR: {
+                const std::string& text = static_cast<const StringExpression&>(expr).value;
+                return constant("makeValue(std::string(" + quoted(text) + ", " + std::to_string(text.size()) + "))");
+            }
+            case NodeType::BOOLEAN_EXPR:
+                return constant(static_cast<const BooleanExpression&>(expr).value ? "makeValue(true)" : "makeValue(false)");
+            case NodeType::NONE_EXPR:
+                return constant("makeValue(nullptr)");
+            case NodeType::IDENTIFIER_EXPR: {
+                const auto& id = static_cast<const IdentifierExpression&>(expr);
+                if (id.slot >= 0) {
+                    return "rt.parameter(" + std::to_string(id.slot) + ")";
+                }
+                if (id.number_slot >= 0 && numbers) {
+                    return "makeValue(rt.number(" + std::to_string(id.number_slot) + "))";
+                }
+                return "rt.load(" + name(id.name) + ")";
+            }
+            case NodeType::BINARY_EXPR: {
+                const auto& binary = static_cast<const BinaryExpression&>(expr);
+                if (unboxedOperands(binary)) {
+                    if (binary.unboxed) {
+                        return "makeValue(" + number(binary) + ")";
+                    }
+                    if (const char* compare = comparison(binary.operator_type)) {
+                        return "makeValue(" + number(*binary.left) + compare + number(*binary.right) + ")";
+                    }
+                }
+                const char* op = operatorName(binary.operator_type);
+                if (!op) break;
+                std::string left = operand(*binary.left);
+                std::string right = operand(*binary.right);
+                return "rt.binary(TokenType::" + std::string(op) + ", " + left + ", " + right + ")";
+            }
+            case NodeType::UNARY_EXPR: {
+                const auto& unary = static_cast<const UnaryExpression&>(expr);
+                const char* op = operatorName(unary.operator_type);
+                if (!op) break;
+                return "rt.unary(TokenType::" + std::string(op) + ", " + operand(*unary.operand) + ")";
+            }
+            case NodeType::LIST_EXPR:
+                return "rt.list(" + operands(static_cast<const ListExpression&>(expr).elements) + ")";
+            case NodeType::DICT_EXPR: {
+                std::string dict = "v" + temporary();
+                line() << "Value " << dict << " = rt.dict();\n";
+                for (const auto& pair : static_cast<const DictExpression&>(expr).pairs) {
+                    std::string key = operand(*pair.first);
+                    std::string item = operand(*pair.second);
+                    line() << "rt.insert(" << dict << ", " << key << ", " << item << ");\n";
+                }
+                return dict;
+            }
+            case NodeType::INDEX_EXPR: {
+                const auto& index_expr = static_cast<const IndexExpression&>(expr);
+                std::string object = operand(*index_expr.object);
+                std::string index_code = operand(*index_expr.index);
+                return "getItem(" + object + ", " + index_code + ")";
+            }
+            case NodeType::ATTRIBUTE_EXPR: {
+                const auto& attribute = static_cast<const AttributeExpression&>(expr);
+                if (attribute.object->type == NodeType::SUPER_EXPR) {
+                    return "rt.superAttribute(" + name(attribute.attribute) + ")";
+                }
+                return "rt.attribute(" + operand(*attribute.object) + ", " + name(attribute.attribute) + ")";
+            }
+            case NodeType::CALL_EXPR: {
+                // Arguments are evaluated before the callee, as in evaluateCallExpr
+                const auto& call = static_cast<const CallExpression&>(expr);
+                if (call.callee->type == NodeType::ATTRIBUTE_EXPR) {
+                    const auto& method = static_cast<const AttributeExpression&>(*call.callee);
+                    std::string arguments = operands(call.arguments);
+                    if (method.object->type == NodeType::SUPER_EXPR) {
+                        return "rt.callSuper(" + name(method.attribute) + ", " + arguments + ")";
+                    }
+                    std::string object = operand(*method.object);
+                    return "rt.callMethod(" + object + ", " + name(method.attribute) + ", " + arguments + ")";
+                }
+                std::string arguments = operands(call.arguments);
+                std::string callee = operand(*call.callee);
+                return "rt.call(" + callee + ", " + arguments + ")";
+            }
+            default:
+                break;
+        }
+        return "rt.evaluate(" + std::to_string(index(expr)) + ")";
+    }
+};
+
+// Calls visit on each statement of stmts and, after it, the statements
+// nested in it: blocks, function and class bodies
+void forEachStatement(const Statement& stmt, const std::function<void(const Statement&)>& visit);
+
+void forEachStatement(const std::vector<std::unique_ptr<Statement>>& stmts,
+                      const std::function<void(const Statement&)>& visit) {
+    for (const auto& stmt : stmts) forEachStatement(*stmt, visit);
+}
+
+void forEachStatement(const Statement& stmt, const std::function<void(const Statement&)>& visit) {
+    visit(stmt);
+    switch (stmt.type) {
+        case NodeType::BLOCK_STMT:
+            forEachStatement(static_cast<const BlockStatement&>(stmt).statements, visit);
+            break;
+        case NodeType::IF_STMT: {
+            const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+            forEachStatement(if_stmt.then_branch->statements, visit);
+            if (if_stmt.else_branch) forEachStatement(*if_stmt.else_branch, visit);
+            break;
+        }
+        case NodeType::WHILE_STMT:
+            forEachStatement(static_cast<const WhileStatement&>(stmt).body->statements, visit);
+            break;
+        case NodeType::FOR_STMT:
+            forEachStatement(static_cast<const ForStatement&>(stmt).body->statements, visit);
+            break;
+        case NodeType::FUNCTION_DEF_STMT: {
+            const auto& def = static_cast<const FunctionDefStatement&>(stmt);
+            if (def.body) forEachStatement(def.body->statements, visit);
+            break;
+        }
+        case NodeType::CLASS_DEF_STMT:
+            forEachStatement(static_cast<const ClassDefStatement&>(stmt).body->statements, visit);
+            break;
+        case NodeType::TRY_STMT: {
+            const auto& try_stmt = static_cast<const TryStatement&>(stmt);
+            forEachStatement(try_stmt.try_body->statements, visit);
+            for (const auto& clause : try_stmt.except_clauses) {
+                forEachStatement(clause.body->statements, visit);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Adds the modules stmts import (at any depth) that can be found as NAME.py
+// from the working directory, where the interpreter would look for them
+// now, and in turn the modules those import
+void collectImports(const std::vector<std::unique_ptr<Statement>>& stmts,
+                    std::vector<std::pair<std::string, std::shared_ptr<Program>>>& modules);
+
+void importModule(const std::string& module_name,
+                  std::vector<std::pair<std::string, std::shared_ptr<Program>>>& modules) {
+    for (const auto& module : modules) {
+        if (module.first == module_name) return;
+    }
+    // A module not found is left to the import at run time to report
+    std::ifstream file(module_name + ".py");
+    if (!file.is_open()) return;
+    std::stringstream source;
+    source << file.rdbuf();
+    
+    std::shared_ptr<Program> program;
+    try {
+        Lexer lexer(source.str());
+        Parser parser(lexer.tokenize());
+        program = parser.parse();
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error loading module '" + module_name + "': " + e.what());
+    }
+    modules.emplace_back(module_name, program);
+    collectImports(program->statements, modules);
+}
+
+void collectImports(const std::vector<std::unique_ptr<Statement>>& stmts,
+                    std::vector<std::pair<std::string, std::shared_ptr<Program>>>& modules) {
+    forEachStatement(stmts, [&modules](const Statement& stmt) {
+        if (stmt.type == NodeType::IMPORT_STMT) {
+            importModule(static_cast<const ImportStatement&>(stmt).module_name, modules);
+        } else if (stmt.type == NodeType::FROM_IMPORT_STMT) {
+            importModule(static_cast<const FromImportStatement&>(stmt).module_name, modules);
+        }
+    });
+}
+
+} // namespace
+
+void CppEmitter::emit(const Program& program, const std::string& source_name, std::ostream& out) {
+    std::unordered_map<const ASTNode*, uint32_t> indices;
+    flat::FlatAst flat(program, &indices);
+    std::ostringstream encoded;
+    flat.write(encoded);
+    
+    // Every def gets a C++ function for its body; the functions it creates
+    // run that instead of interpreting the body
+    std::vector<const FunctionDefStatement*> functions;
+    forEachStatement(program.statements, [&functions](const Statement& stmt) {
+        if (stmt.type == NodeType::FUNCTION_DEF_STMT && static_cast<const FunctionDefStatement&>(stmt).body) {
+            functions.push_back(static_cast<const FunctionDefStatement*>(&stmt));
+        }
+    });
+    
+    Translator translator(indices);
+    for (size_t i = 0; i < functions.size(); ++i) {
+        const FunctionDefStatement& def = *functions[i];
+        translator.code << "\n// def " << commentSafe(def.name) << "(";
+        for (size_t j = 0; j < def.parameters.size(); ++j) {
+            translator.code << (j == 0 ? "" : ", ") << commentSafe(def.parameters[j]);
+        }
+        translator.code << ")\n";
+        translator.function("function" + std::to_string(i), def.body->statements, !def.number_locals.empty());
+    }
+    translator.code << "\n// Module-level code\n";
+    translator.function("module_code", program.statements, false);
+    
+    std::vector<std::pair<std::string, std::shared_ptr<Program>>> modules;
+    collectImports(program.statements, modules);
+    
+    out << "// Generated by LangProject --emit-cpp from " << commentSafe(source_name) << "; do not edit.\n"
+        << "// Build: c++ -std=c++17 -O2 -I<LangProject>/src FILE.cpp <build>/liblang_runtime.a -pthread\n"
+        << "//\n"
+        << "// Module-level code and " << functions.size() << " function bod" << (functions.size() == 1 ? "y" : "ies")
+        << ": " << translator.translated << " statement(s) translated to C++, " << translator.interpreted
+        << " run by the\n"
+        << "// interpreter (definitions, imports, ...). Imported modules run on the interpreter.\n"
+        << "#include \"emitted_program.h\"\n"
+        << "#include <exception>\n"
+        << "#include <iostream>\n"
+        << "#include <stdexcept>\n"
+        << "\n"
+        << "namespace {\n"
+        << "\n"
+        << "// The parsed program in the flat AST format, inflated at startup for\n"
+        << "// the nodes the interpreter runs\n"
+        << "alignas(8) const unsigned char program_data[] = {";
+    writeBytes(encoded.str(), out);
+    out << "\n};\n";
+    
+    for (size_t i = 0; i < modules.size(); ++i) {
+        std::ostringstream module_encoded;
+        flat::FlatAst(*modules[i].second).write(module_encoded);
+        out << "\n"
+            << "// Module " << commentSafe(modules[i].first) << "\n"
+            << "alignas(8) const unsigned char module" << i << "_data[] = {";
+        writeBytes(module_encoded.str(), out);
+        out << "\n};\n";
+    }
+    
+    if (!translator.names.empty()) {
+        out << "\n"
+            << "const Symbol names[] = {";
+        for (size_t i = 0; i < translator.names.size(); ++i) {
+            out << (i % 4 == 0 ? "\n    " : " ") << "Symbol(" << quoted(translator.names[i]) << "),";
+        }
+        out << "\n};\n";
+    }
+    if (!translator.constants.empty()) {
+        out << "\n"
+            << "// Literal values, made by run()\n"
+            << "const Value* constants = nullptr;\n";
+    }
+    out << translator.code.str()
+        << "\n"
+        << "ExecStatus run(EmittedProgram& rt) {\n";
+    if (!translator.constants.empty()) {
+        out << "    const Value values[] = {";
+        for (const auto& constant : translator.constants) {
+            out << "\n        " << constant << ",";
+        }
+        out << "\n    };\n"
+            << "    constants = values;\n";
+    }
+    out << "    return module_code(rt);\n"
+        << "}\n"
+        << "\n"
+        << "} // namespace\n"
+        << "\n"
+        << "int main() {\n"
+        << "    try {\n"
+        << "        EmittedProgram program(flat::FlatAstView::fromBuffer(\n"
+        << "            reinterpret_cast<const char*>(program_data), sizeof(program_data), " << quoted(source_name) << "));\n";
+    for (size_t i = 0; i < modules.size(); ++i) {
+        std::string data = "module" + std::to_string(i) + "_data";
+        out << "        program.addModule(" << quoted(modules[i].first) << ", flat::FlatAstView::fromBuffer(\n"
+            << "            reinterpret_cast<const char*>(" << data << "), sizeof(" << data << "), "
+            << quoted(modules[i].first + ".py") << "));\n";
+    }
+    for (size_t i = 0; i < functions.size(); ++i) {
+        out << "        program.addFunction(" << indices.at(functions[i]) << ", function" << i << ");\n";
+    }
+    out << "        program.run(run);\n"
+        << "    } catch (const std::exception& e) {\n"
+        << "        std::cerr << \"Error: \" << e.what() << std::endl;\n"
+        << "        return 1;\n"
+        << "    }\n"
+        << "    return 0;\n"
+        << "}\n";
+}
+
+void CppEmitter::write(const Program& program, const std::string& source_name, const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+    emit(program, source_name, file);
+    if (!file) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+}
+
+void CppEmitter::compile(const std::string& cpp_path, const std::string& executable) {
+    const char* compiler = std::getenv("CXX");
+    std::string command = std::string(compiler && *compiler ? compiler : "c++") +
+                          " -std=c++17 -O2 -I" + shellQuote(LANG_RUNTIME_INCLUDE_DIR) + " " + shellQuote(cpp_path) +
+                          " " + shellQuote(LANG_RUNTIME_LIBRARY) + " -pthread -o " + shellQuote(executable);
+    std::cerr << "[emit-cpp] " << command << std::endl;
+    if (std::system(command.c_str()) != 0) {
+        throw std::runtime_error("Compiling " + cpp_path + " failed");
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "parser.h"
+#include <ostream>
+#include <string>
+
+// C++ output for scripts that never change between runs.
+//
+// The generated translation unit translates the main file's module-level
+// statements and each function body into C++ that calls the interpreter
+// runtime (the lang_runtime library, see emitted_program.h). A def becomes
+// a C++ function that the functions it creates run when called, inside the
+// frame the interpreter sets up, so parameters are read from their frame
+// slots and number locals TypeInference proved are plain doubles. The
+// program is also held as a flat AST in a static array (see flat_ast.h) for
+// what is not translated: definitions and imports, which build runtime
+// objects, and nodes the translator has no form for are run by the
+// interpreter, so the executable inflates the flat AST at startup. This is
+// not a compiler: other values stay boxed and go through the runtime, so
+// the gain over the interpreter is mostly the dispatch it skips.
+//
+// Modules the program imports that exist as NAME.py in the working
+// directory when the file is generated are embedded the same way, so the
+// executable imports them from any directory; other imports still look for
+// a file at run time.
+class CppEmitter {
+public:
+    // source_name only appears in comments and error messages
+    static void emit(const Program& program, const std::string& source_name, std::ostream& out);
+    static void write(const Program& program, const std::string& source_name, const std::string& path);
+
+    // Builds a file written by write() into an executable with the system
+    // compiler ($CXX, or c++), linking the runtime this binary was built with
+    static void compile(const std::string& cpp_path, const std::string& executable);
+};
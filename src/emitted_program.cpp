@@ -0,0 +1,295 @@
+#include "emitted_program.h"
+#include <iostream>
+#include <stdexcept>
+
+EmittedProgram::EmittedProgram(const flat::FlatAstView& ast)
+    : program(ast.inflate(nullptr, &nodes)) {
+    interpreter.native_program = this;
+}
+
+void EmittedProgram::addModule(const std::string& name, const flat::FlatAstView& ast) {
+    interpreter.addModule(name, ast.inflate());
+}
+
+void EmittedProgram::addFunction(uint32_t definition, NativeBody body) {
+    const ASTNode* node = nodes.at(definition);
+    if (node->type != NodeType::FUNCTION_DEF_STMT) {
+        throw std::runtime_error("Node " + std::to_string(definition) + " is not a function definition");
+    }
+    interpreter.native_bodies[static_cast<const FunctionDefStatement*>(node)] = body;
+}
+
+void EmittedProgram::run(ExecStatus (*code)(EmittedProgram&)) {
+    try {
+        if (code(*this) == ExecStatus::RETURN) {
+            std::cout << "Top-level return: " << valueToString(interpreter.return_value) << std::endl;
+            interpreter.return_value.reset();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Runtime error: " << e.what() << std::endl;
+    }
+}
+
+void EmittedProgram::collectAtSafePoint() {
+    if (interpreter.collector.collectionDue()) {
+        interpreter.collector.collectScheduled();
+    }
+    if (!interpreter.abandoned_generators.empty()) {
+        interpreter.closeGenerators();
+    }
+}
+
+ExecStatus EmittedProgram::execute(uint32_t statement) {
+    return interpreter.execute(static_cast<const Statement&>(*nodes.at(statement)));
+}
+
+Value EmittedProgram::evaluate(uint32_t expression) {
+    return interpreter.evaluate(static_cast<const Expression&>(*nodes.at(expression)));
+}
+
+ExecStatus EmittedProgram::returnValue(Value value) {
+    interpreter.return_value = std::move(value);
+    return ExecStatus::RETURN;
+}
+
+void EmittedProgram::yield(Value value) {
+    interpreter.yieldValue(std::move(value));
+}
+
+bool EmittedProgram::stopIteration(uint32_t expression) {
+    if (!interpreter.current_function || interpreter.current_function != interpreter.stop_iteration_function ||
+        interpreter.call_depth != interpreter.stop_iteration_depth ||
+        !interpreter.isStopIterationRaise(static_cast<const Expression&>(*nodes.at(expression)))) {
+        return false;
+    }
+    interpreter.return_value = interpreter.stop_iteration;
+    return true;
+}
+
+Value EmittedProgram::load(Symbol name) {
+    return interpreter.environment->get(name);
+}
+
+void EmittedProgram::store(Symbol name, const Value& value) {
+    if (Value* binding = interpreter.environment->lookup(name)) {
+        *binding = value;
+    } else {
+        interpreter.defineVariable(name, value);
+    }
+}
+
+bool EmittedProgram::appendInPlace(Value* binding, const Value& left, const Value& right) {
+    // The binding and left are the only references
+    if (isString(left) && isString(right) && binding && binding->get() == left.get() && left.use_count() == 2) {
+        std::get<std::string>((*binding)->value) += getString(right);
+        return true;
+    }
+    return false;
+}
+
+void EmittedProgram::concatenate(Symbol name, const Value& left, const Value& right) {
+    if (!appendInPlace(interpreter.environment->lookup(name), left, right)) {
+        store(name, binary(TokenType::PLUS, left, right));
+    }
+}
+
+void EmittedProgram::update(Symbol name, TokenType op, const Value& left, const Value& right) {
+    if (op == TokenType::PLUS) {
+        if (isList(left)) {
+            interpreter.extendList(left, right);
+            store(name, left);
+            return;
+        }
+        concatenate(name, left, right);
+        return;
+    }
+    store(name, binary(op, left, right));
+}
+
+void EmittedProgram::concatenateParameter(uint32_t slot, const Value& left, const Value& right) {
+    if (!appendInPlace(&parameter(slot), left, right)) {
+        Value result = binary(TokenType::PLUS, left, right);
+        parameter(slot) = std::move(result);
+    }
+}
+
+void EmittedProgram::updateParameter(uint32_t slot, TokenType op, const Value& left, const Value& right) {
+    if (op == TokenType::PLUS) {
+        if (isList(left)) {
+            interpreter.extendList(left, right);
+            parameter(slot) = left;
+            return;
+        }
+        concatenateParameter(slot, left, right);
+        return;
+    }
+    Value result = binary(op, left, right);
+    parameter(slot) = std::move(result);
+}
+
+void EmittedProgram::updateAttribute(const Value& object, Symbol name, TokenType op, const Value& left, const Value& right) {
+    if (!isClassInstance(object)) {
+        binary(op, left, right);
+        throw std::runtime_error("Can only assign attributes to class instances");
+    }
+    auto& attributes = getClassInstance(object)->attributes;
+    auto binding = attributes.find(name);
+    if (op == TokenType::PLUS && binding != attributes.end()) {
+        if (isList(left)) {
+            interpreter.extendList(left, right);
+            attributes[name] = left;
+            return;
+        }
+        if (appendInPlace(&binding->second, left, right)) {
+            return;
+        }
+    }
+    Value result = binary(op, left, right);
+    attributes[name] = std::move(result);
+}
+
+Value EmittedProgram::augment(TokenType op, const Value& current, const Value& operand) {
+    if (op == TokenType::PLUS && isList(current)) {
+        interpreter.extendList(current, operand);
+        return current;
+    }
+    return interpreter.performBinaryOp(op, current, operand);
+}
+
+void EmittedProgram::bind(Symbol name, const Value& value) {
+    interpreter.defineVariable(name, value);
+}
+
+Value EmittedProgram::genericBinary(TokenType op, const Value& left, const Value& right) {
+    return interpreter.performBinaryOp(op, left, right);
+}
+
+Value EmittedProgram::unary(TokenType op, const Value& operand) {
+    return interpreter.performUnaryOp(op, operand);
+}
+
+bool EmittedProgram::genericTruthy(const Value& value) {
+    return interpreter.isTruthy(value);
+}
+
+Value EmittedProgram::list(std::initializer_list<Value> items) {
+    return makeValue(ListType(items));
+}
+
+Value EmittedProgram::dict() {
+    return makeValue(DictType());
+}
+
+void EmittedProgram::insert(const Value& dict, const Value& key, const Value& value) {
+    if (!isString(key)) {
+        throw std::runtime_error("Dictionary keys must be strings");
+    }
+    getDict(dict)[getString(key)] = value;
+}
+
+Value EmittedProgram::attribute(const Value& object, Symbol name) {
+    return interpreter.getAttribute(object, name);
+}
+
+void EmittedProgram::setAttribute(const Value& object, Symbol name, const Value& value) {
+    if (!isClassInstance(object)) {
+        throw std::runtime_error("Can only assign attributes to class instances");
+    }
+    getClassInstance(object)->attributes[name] = value;
+}
+
+Value EmittedProgram::call(const Value& callee, std::initializer_list<Value> arguments) {
+    size_t args_base = interpreter.stack.size();
+    interpreter.stack.insert(interpreter.stack.end(), arguments);
+    return callFrom(callee, args_base);
+}
+
+Value EmittedProgram::callMethod(const Value& object, Symbol name, std::initializer_list<Value> arguments) {
+    size_t args_base = interpreter.stack.size();
+    interpreter.stack.insert(interpreter.stack.end(), arguments);
+    Value callee;
+    try {
+        callee = interpreter.getAttribute(object, name);
+    } catch (...) {
+        interpreter.stack.resize(args_base);
+        throw;
+    }
+    if (isClassInstance(object) && isFunction(callee)) {
+        interpreter.stack.insert(interpreter.stack.begin() + args_base, object);
+    }
+    return callFrom(callee, args_base);
+}
+
+Value EmittedProgram::superAttribute(Symbol name) {
+    Value self;
+    return interpreter.getSuperMethod(name, self);
+}
+
+Value EmittedProgram::callSuper(Symbol name, std::initializer_list<Value> arguments) {
+    size_t args_base = interpreter.stack.size();
+    interpreter.stack.insert(interpreter.stack.end(), arguments);
+    Value object;
+    Value callee;
+    try {
+        callee = interpreter.getSuperMethod(name, object);
+    } catch (...) {
+        interpreter.stack.resize(args_base);
+        throw;
+    }
+    if (isClassInstance(object) && isFunction(callee)) {
+        interpreter.stack.insert(interpreter.stack.begin() + args_base, object);
+    }
+    return callFrom(callee, args_base);
+}
+
+Value EmittedProgram::callFrom(const Value& callee, size_t args_base) {
+    try {
+        Value result = interpreter.callValue(callee, args_base);
+        interpreter.stack.resize(args_base);
+        return result;
+    } catch (...) {
+        interpreter.stack.resize(args_base);
+        throw;
+    }
+}
+
+std::unique_ptr<Iterator> EmittedProgram::iterate(const Value& iterable) {
+    return interpreter.makeIterator(iterable);
+}
+
+int EmittedProgram::handler(const std::runtime_error& error, std::initializer_list<const char*> types, Value& exception) {
+    // Errors of the runtime itself are RuntimeError, bound as their message
+    const auto* raised = dynamic_cast<const RuntimeException*>(&error);
+    std::string type = raised ? raised->exception_type : "RuntimeError";
+    int index = 0;
+    for (const char* clause : types) {
+        if (!*clause || type == clause) {
+            exception = raised ? raised->exception_value : makeValue(std::string(error.what()));
+            return index;
+        }
+        ++index;
+    }
+    return -1;
+}
+
+EmittedProgram::Block::Block(EmittedProgram& program)
+    : interpreter(program.interpreter),
+      previous(interpreter.environment),
+      previous_pending(interpreter.scope_pending) {
+    interpreter.scope_pending = true;
+}
+
+EmittedProgram::Block::~Block() {
+    interpreter.environment = std::move(previous);
+    interpreter.scope_pending = previous_pending;
+}
+
+EmittedProgram::Try::Try(EmittedProgram& program)
+    : interpreter(program.interpreter),
+      previous_stop(interpreter.stop_iteration_function) {
+    interpreter.stop_iteration_function = nullptr;
+}
+
+EmittedProgram::Try::~Try() {
+    interpreter.stop_iteration_function = previous_stop;
+}
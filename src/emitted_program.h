@@ -0,0 +1,185 @@
+#pragma once
+#include "flat_ast.h"
+#include "interpreter.h"
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Runtime side of a program generated by --emit-cpp (see emit_cpp.h).
+//
+// The generated code runs the main file's module-level statements and
+// function bodies as C++ through the operations below, which do what the
+// interpreter does for the same nodes. A translated body runs in the frame
+// Interpreter::callFunction sets up for the call, reading parameters and
+// number locals from the slots the resolver and TypeInference gave them.
+// What the code does not translate (definitions, imports, ...) it hands to
+// the interpreter, naming the node by its index in the program's flat AST.
+class EmittedProgram {
+public:
+    // Inflates the program; the interpreter is created with default options
+    explicit EmittedProgram(const flat::FlatAstView& ast);
+    EmittedProgram(const EmittedProgram&) = delete;
+    EmittedProgram& operator=(const EmittedProgram&) = delete;
+
+    // A module imported by the program, built in instead of read from name.py
+    void addModule(const std::string& name, const flat::FlatAstView& ast);
+
+    // Calls of the functions created by the def node at index definition
+    // run body instead of interpreting the def's body
+    void addFunction(uint32_t definition, NativeBody body);
+    
+    // Runs the generated module-level code the way Interpreter::interpret
+    // runs a program: a top-level return and runtime errors are reported
+    void run(ExecStatus (*code)(EmittedProgram&));
+
+    // Statement boundary: the interpreter's safe point for collection
+    inline void safePoint();
+
+    // Nodes left to the interpreter, by flat AST index
+    ExecStatus execute(uint32_t statement);
+    Value evaluate(uint32_t expression);
+
+    // Frame of the running function: a parameter at its frame slot, and an
+    // unboxed number local (only when the function has a number frame)
+    Value& parameter(uint32_t slot) { return interpreter.stack[interpreter.frame_base + slot]; }
+    double& number(uint32_t slot) { return interpreter.numbers[interpreter.number_base + slot]; }
+    inline double divide(double left, double right);
+    
+    // return value; the generated code returns the status
+    ExecStatus returnValue(Value value);
+    void yield(Value value);
+    // For raise("StopIteration", ...) at expression: true when it ends the
+    // __next__ call a for loop is making, with the marker as return value
+    bool stopIteration(uint32_t expression);
+    
+    Value load(Symbol name);
+    // name = value: an existing binding is assigned, otherwise one is defined
+    // in the current scope
+    void store(Symbol name, const Value& value);
+    // name = left + right, where left is what name held: a string nothing
+    // else refers to is appended to in place
+    void concatenate(Symbol name, const Value& left, const Value& right);
+    // name op= right, where left is what name held: a list is extended in
+    // place (aliases see the items) and strings are appended as above
+    void update(Symbol name, TokenType op, const Value& left, const Value& right);
+    // The same for a parameter at its frame slot
+    void concatenateParameter(uint32_t slot, const Value& left, const Value& right);
+    void updateParameter(uint32_t slot, TokenType op, const Value& left, const Value& right);
+    // object.name op= right, where left is what object.name gave
+    void updateAttribute(const Value& object, Symbol name, TokenType op, const Value& left, const Value& right);
+    // object[index] op= operand: the value to store back
+    Value augment(TokenType op, const Value& current, const Value& operand);
+    // Binds a for loop variable or an exception in the current scope
+    void bind(Symbol name, const Value& value);
+
+    // The generated code passes op as a constant, so for numbers the inline
+    // part reduces to the operation itself
+    inline Value binary(TokenType op, const Value& left, const Value& right);
+    Value unary(TokenType op, const Value& operand);
+    inline bool truthy(const Value& value);
+    Value list(std::initializer_list<Value> items);
+    // A dict literal is built pair by pair, each key checked as it is added
+    Value dict();
+    void insert(const Value& dict, const Value& key, const Value& value);
+    Value attribute(const Value& object, Symbol name);
+    void setAttribute(const Value& object, Symbol name, const Value& value);
+    Value call(const Value& callee, std::initializer_list<Value> arguments);
+    // object.name(arguments): an instance's method gets the instance first
+    Value callMethod(const Value& object, Symbol name, std::initializer_list<Value> arguments);
+    // super().name and super().name(arguments) in a method
+    Value superAttribute(Symbol name);
+    Value callSuper(Symbol name, std::initializer_list<Value> arguments);
+    std::unique_ptr<Iterator> iterate(const Value& iterable);
+
+    // Index of the except clause, among the types listed (empty: any),
+    // that handles error, and the value it binds; -1 if none does
+    int handler(const std::runtime_error& error, std::initializer_list<const char*> types, Value& exception);
+    
+    // Scope of one run of a block body, as Interpreter::executeBlock sets
+    // up: it is only created if something is defined in it
+    class Block {
+    public:
+        explicit Block(EmittedProgram& program);
+        Block(const Block&) = delete;
+        Block& operator=(const Block&) = delete;
+        ~Block();
+
+    private:
+        Interpreter& interpreter;
+        std::shared_ptr<Environment> previous;
+        bool previous_pending;
+    };
+    
+    // Around a try body, as Interpreter::executeTry: a raise("StopIteration")
+    // in it throws, so that the except clauses can catch it
+    class Try {
+    public:
+        explicit Try(EmittedProgram& program);
+        Try(const Try&) = delete;
+        Try& operator=(const Try&) = delete;
+        ~Try();
+        
+    private:
+        Interpreter& interpreter;
+        const Function* previous_stop;
+    };
+
+private:
+    // Filled in by inflating the program, so declared before it; the program
+    // outlives the interpreter, as functions defined by it point into it
+    std::vector<const ASTNode*> nodes;
+    std::unique_ptr<Program> program;
+    Interpreter interpreter;
+
+    void collectAtSafePoint();
+    Value callFrom(const Value& callee, size_t args_base);
+    // Appends right to the string binding holds when left is it and nothing
+    // else refers to it
+    bool appendInPlace(Value* binding, const Value& left, const Value& right);
+    Value genericBinary(TokenType op, const Value& left, const Value& right);
+    bool genericTruthy(const Value& value);
+};
+
+void EmittedProgram::safePoint() {
+    if (interpreter.collector.collectionDue() || !interpreter.abandoned_generators.empty()) {
+        collectAtSafePoint();
+    }
+}
+
+Value EmittedProgram::binary(TokenType op, const Value& left, const Value& right) {
+    const double* a = std::get_if<double>(&left->value);
+    const double* b = std::get_if<double>(&right->value);
+    if (a && b) {
+        switch (op) {
+            case TokenType::PLUS: return makeValue(*a + *b);
+            case TokenType::MINUS: return makeValue(*a - *b);
+            case TokenType::MULTIPLY: return makeValue(*a * *b);
+            case TokenType::DIVIDE:
+                if (*b == 0) break;
+                return makeValue(*a / *b);
+            case TokenType::MODULO: return makeValue(modulo(*a, *b));
+            case TokenType::EQUAL: return makeValue(*a == *b);
+            case TokenType::NOT_EQUAL: return makeValue(*a != *b);
+            case TokenType::LESS: return makeValue(*a < *b);
+            case TokenType::LESS_EQUAL: return makeValue(*a <= *b);
+            case TokenType::GREATER: return makeValue(*a > *b);
+            case TokenType::GREATER_EQUAL: return makeValue(*a >= *b);
+            default: break;
+        }
+    }
+    return genericBinary(op, left, right);
+}
+
+double EmittedProgram::divide(double left, double right) {
+    if (right == 0) throw std::runtime_error("Division by zero");
+    return left / right;
+}
+
+bool EmittedProgram::truthy(const Value& value) {
+    if (const bool* flag = std::get_if<bool>(&value->value)) {
+        return *flag;
+    }
+    return genericTruthy(value);
+}
@@ -0,0 +1,717 @@
+#include "flat_ast.h"
+#include "resolver.h"
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Node fields by type (strings are string table ids, lists are offsets into
+// the list array, optional children are NO_NODE when absent):
+//
+//   NUMBER_EXPR                a = number index
+//   STRING_EXPR                a = string
+//   BOOLEAN_EXPR               a = 0 or 1
+//   IDENTIFIER_EXPR            a = name
+//   BINARY_EXPR                op, a = left, b = right
+//   UNARY_EXPR                 op, a = operand
+//   CALL_EXPR                  a = callee, b = list of arguments
+//   LIST_EXPR                  a = list of elements
+//   DICT_EXPR                  a = list of key, value, key, value...
+//   INDEX_EXPR                 a = object, b = index
+//   ATTRIBUTE_EXPR             a = object, b = attribute
+//   EXPRESSION_STMT            a = expression
+//   ASSIGNMENT_STMT            op = 1 if augmented, a = name, b = value
+//   ATTRIBUTE_ASSIGNMENT_STMT  op = 1 if augmented, a = object, b = attribute, c = value
+//   INDEX_ASSIGNMENT_STMT      op, a = object, b = index, c = value
+//   BLOCK_STMT, PROGRAM        a = list of statements
+//   IF_STMT                    a = condition, b = then block, c = else (optional)
+//   WHILE_STMT                 a = condition, b = body
+//   FOR_STMT                   a = variable, b = iterable, c = body
+//   FUNCTION_DEF_STMT          a = name, b = list of parameter names, c = body
+//   CLASS_DEF_STMT             a = name, b = base (optional), c = body
+//   IMPORT_STMT                a = module, b = alias
+//   FROM_IMPORT_STMT           a = module, b = list of name, alias, name, alias...
+//   RETURN_STMT                a = value (optional)
+//   YIELD_STMT                 a = value (optional)
+//   TRY_STMT                   a = body, b = list of type, variable, body per clause
+//
+// Children are always encoded before their parent, so every child index is
+// smaller than its parent's; inflate() relies on that to reject cycles.
+
+namespace flat {
+
+namespace {
+
+// On-disk layout: Header, then the numbers, nodes, lists, string offsets and
+// string bytes, each section padded to 8 bytes. Everything is in host byte
+// order; byte_order tells a mismatched file apart from a corrupt one.
+constexpr char MAGIC[8] = {'L', 'P', 'F', 'L', 'A', 'T', '\0', '\0'};
+constexpr uint32_t VERSION = 3;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t root;
+    uint32_t node_count;
+    uint32_t list_size;
+    uint32_t number_count;
+    uint32_t string_count;
+    uint32_t string_bytes;
+};
+static_assert(sizeof(Header) % 8 == 0, "sections after the header stay aligned");
+
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~static_cast<size_t>(7);
+}
+
+// Section sizes in file order
+struct Layout {
+    size_t numbers;
+    size_t nodes;
+    size_t lists;
+    size_t offsets;
+    size_t strings;
+
+    explicit Layout(const Header& header)
+        : numbers(padded(header.number_count * sizeof(double))),
+          nodes(padded(static_cast<size_t>(header.node_count) * sizeof(Node))),
+          lists(padded(header.list_size * sizeof(uint32_t))),
+          offsets(padded((static_cast<size_t>(header.string_count) + 1) * sizeof(uint32_t))),
+          strings(padded(header.string_bytes)) {}
+
+    size_t total() const { return sizeof(Header) + numbers + nodes + lists + offsets + strings; }
+};
+
+[[noreturn]] void corrupt(const std::string& detail) {
+    throw std::runtime_error("Corrupt flat AST: " + detail);
+}
+
+bool isExpression(NodeType type) {
+    return type <= NodeType::SUPER_EXPR;
+}
+
+// The items of one list, read in place
+struct Items {
+    const uint32_t* first;
+    const uint32_t* last;
+
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    uint32_t operator[](size_t i) const { return first[i]; }
+};
+
+class Inflater {
+private:
+    const FlatAstView& ast;
+    std::vector<const BlockStatement*>* blocks;
+    std::vector<const ASTNode*>* nodes;
+
+public:
+    Inflater(const FlatAstView& view, std::vector<const BlockStatement*>* block_table,
+             std::vector<const ASTNode*>* node_table)
+        : ast(view), blocks(block_table), nodes(node_table) {
+        if (blocks) {
+            blocks->assign(ast.node_count, nullptr);
+        }
+        if (nodes) {
+            nodes->assign(ast.node_count, nullptr);
+        }
+    }
+
+    std::unique_ptr<Program> program() {
+        if (ast.root >= ast.node_count || static_cast<NodeType>(ast.nodes[ast.root].type) != NodeType::PROGRAM) {
+            corrupt("missing program node");
+        }
+        auto result = std::make_unique<Program>(statements(ast.nodes[ast.root].a, ast.root));
+        record(ast.root, result.get());
+        return result;
+    }
+
+private:
+    void record(uint32_t index, const ASTNode* node) {
+        if (nodes) {
+            (*nodes)[index] = node;
+        }
+    }
+
+    const Node& child(uint32_t index, uint32_t parent) const {
+        if (index >= parent) {
+            corrupt("node " + std::to_string(parent) + " has an invalid child");
+        }
+        return ast.nodes[index];
+    }
+
+    Items list(uint32_t offset, uint32_t parent) const {
+        if (offset >= ast.list_size || ast.lists[offset] > ast.list_size - offset - 1) {
+            corrupt("node " + std::to_string(parent) + " has an invalid list");
+        }
+        const uint32_t* items = ast.listItems(offset);
+        return Items{items, items + ast.listCount(offset)};
+    }
+
+    std::string string(uint32_t id) const {
+        if (id >= ast.string_count) {
+            corrupt("invalid string id " + std::to_string(id));
+        }
+        return std::string(ast.string(id));
+    }
+
+    std::unique_ptr<Expression> optionalExpression(uint32_t index, uint32_t parent) {
+        return index == NO_NODE ? nullptr : expression(index, parent);
+    }
+
+    std::unique_ptr<Expression> expression(uint32_t index, uint32_t parent) {
+        auto result = buildExpression(index, parent);
+        record(index, result.get());
+        return result;
+    }
+
+    std::unique_ptr<Expression> buildExpression(uint32_t index, uint32_t parent) {
+        const Node& node = child(index, parent);
+        NodeType type = static_cast<NodeType>(node.type);
+        if (!isExpression(type)) {
+            corrupt("expected an expression at node " + std::to_string(index));
+        }
+        int line = static_cast<int>(node.line);
+        int column = node.column;
+        TokenType op = static_cast<TokenType>(node.op);
+
+        switch (type) {
+            case NodeType::NUMBER_EXPR:
+                if (node.a >= ast.number_count) corrupt("invalid number index");
+                return std::make_unique<NumberExpression>(ast.number(node.a), line, column);
+            case NodeType::STRING_EXPR:
+                return std::make_unique<StringExpression>(string(node.a), line, column);
+            case NodeType::BOOLEAN_EXPR:
+                return std::make_unique<BooleanExpression>(node.a != 0, line, column);
+            case NodeType::NONE_EXPR:
+                return std::make_unique<NoneExpression>(line, column);
+            case NodeType::IDENTIFIER_EXPR:
+                return std::make_unique<IdentifierExpression>(string(node.a), line, column);
+            case NodeType::BINARY_EXPR:
+                return std::make_unique<BinaryExpression>(expression(node.a, index), op, expression(node.b, index), line, column);
+            case NodeType::UNARY_EXPR:
+                return std::make_unique<UnaryExpression>(op, expression(node.a, index), line, column);
+            case NodeType::CALL_EXPR:
+                return std::make_unique<CallExpression>(expression(node.a, index), expressions(node.b, index), line, column);
+            case NodeType::LIST_EXPR:
+                return std::make_unique<ListExpression>(expressions(node.a, index), line, column);
+            case NodeType::DICT_EXPR: {
+                auto items = expressions(node.a, index);
+                if (items.size() % 2 != 0) corrupt("odd number of dict items");
+                std::vector<std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>> pairs;
+                for (size_t i = 0; i < items.size(); i += 2) {
+                    pairs.emplace_back(std::move(items[i]), std::move(items[i + 1]));
+                }
+                return std::make_unique<DictExpression>(std::move(pairs), line, column);
+            }
+            case NodeType::INDEX_EXPR:
+                return std::make_unique<IndexExpression>(expression(node.a, index), expression(node.b, index), line, column);
+            case NodeType::ATTRIBUTE_EXPR:
+                return std::make_unique<AttributeExpression>(expression(node.a, index), string(node.b), line, column);
+            case NodeType::SUPER_EXPR:
+                return std::make_unique<SuperExpression>(line, column);
+            default:
+                corrupt("unknown expression type");
+        }
+    }
+
+    std::vector<std::unique_ptr<Expression>> expressions(uint32_t offset, uint32_t parent) {
+        std::vector<std::unique_ptr<Expression>> result;
+        for (uint32_t item : list(offset, parent)) {
+            result.push_back(expression(item, parent));
+        }
+        return result;
+    }
+
+    std::vector<std::unique_ptr<Statement>> statements(uint32_t offset, uint32_t parent) {
+        std::vector<std::unique_ptr<Statement>> result;
+        for (uint32_t item : list(offset, parent)) {
+            result.push_back(statement(item, parent));
+        }
+        return result;
+    }
+
+    std::unique_ptr<BlockStatement> block(uint32_t index, uint32_t parent) {
+        const Node& node = child(index, parent);
+        if (static_cast<NodeType>(node.type) != NodeType::BLOCK_STMT) {
+            corrupt("expected a block at node " + std::to_string(index));
+        }
+        auto result = std::make_unique<BlockStatement>(statements(node.a, index), static_cast<int>(node.line), node.column);
+        if (blocks) {
+            (*blocks)[index] = result.get();
+        }
+        record(index, result.get());
+        return result;
+    }
+
+    // The interpreter runs an augmented assignment's value as target op value
+    bool augmented(const Node& node, const Expression& value) {
+        if (node.op == 0) {
+            return false;
+        }
+        if (node.op != 1 || value.type != NodeType::BINARY_EXPR) {
+            corrupt("invalid augmented assignment");
+        }
+        return true;
+    }
+
+    std::unique_ptr<Statement> statement(uint32_t index, uint32_t parent) {
+        auto result = buildStatement(index, parent);
+        record(index, result.get());
+        return result;
+    }
+
+    std::unique_ptr<Statement> buildStatement(uint32_t index, uint32_t parent) {
+        const Node& node = child(index, parent);
+        NodeType type = static_cast<NodeType>(node.type);
+        int line = static_cast<int>(node.line);
+        int column = node.column;
+
+        switch (type) {
+            case NodeType::EXPRESSION_STMT:
+                return std::make_unique<ExpressionStatement>(expression(node.a, index), line, column);
+            case NodeType::ASSIGNMENT_STMT: {
+                auto assign = std::make_unique<AssignmentStatement>(string(node.a), expression(node.b, index), line, column);
+                assign->augmented = augmented(node, *assign->value);
+                return assign;
+            }
+            case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+                auto assign = std::make_unique<AttributeAssignmentStatement>(expression(node.a, index), string(node.b),
+                                                                             expression(node.c, index), line, column);
+                assign->augmented = augmented(node, *assign->value);
+                return assign;
+            }
+            case NodeType::INDEX_ASSIGNMENT_STMT:
+                return std::make_unique<IndexAssignmentStatement>(expression(node.a, index), expression(node.b, index),
+                                                                  static_cast<TokenType>(node.op),
+                                                                  expression(node.c, index), line, column);
+            case NodeType::BLOCK_STMT:
+                // A block in statement position, such as an else branch
+                return block(index, index + 1);
+            case NodeType::IF_STMT: {
+                std::unique_ptr<Statement> else_branch;
+                if (node.c != NO_NODE) {
+                    else_branch = statement(node.c, index);
+                }
+                return std::make_unique<IfStatement>(expression(node.a, index), block(node.b, index),
+                                                     std::move(else_branch), line, column);
+            }
+            case NodeType::WHILE_STMT:
+                return std::make_unique<WhileStatement>(expression(node.a, index), block(node.b, index), line, column);
+            case NodeType::FOR_STMT:
+                return std::make_unique<ForStatement>(string(node.a), expression(node.b, index), block(node.c, index), line, column);
+            case NodeType::FUNCTION_DEF_STMT: {
+                std::vector<std::string> parameters;
+                for (uint32_t id : list(node.b, index)) {
+                    parameters.push_back(string(id));
+                }
+                auto function = std::make_unique<FunctionDefStatement>(string(node.a), std::move(parameters),
+                                                                       block(node.c, index), line, column);
+                // Slots and free names are not stored; recompute them
+                Resolver::resolveFunction(*function);
+                return function;
+            }
+            case NodeType::CLASS_DEF_STMT:
+                return std::make_unique<ClassDefStatement>(string(node.a), optionalExpression(node.b, index),
+                                                           block(node.c, index), line, column);
+            case NodeType::IMPORT_STMT:
+                return std::make_unique<ImportStatement>(string(node.a), string(node.b), line, column);
+            case NodeType::FROM_IMPORT_STMT: {
+                auto ids = list(node.b, index);
+                if (ids.size() % 2 != 0) corrupt("odd number of import names");
+                std::vector<std::pair<std::string, std::string>> imports;
+                for (size_t i = 0; i < ids.size(); i += 2) {
+                    imports.emplace_back(string(ids[i]), string(ids[i + 1]));
+                }
+                return std::make_unique<FromImportStatement>(string(node.a), std::move(imports), line, column);
+            }
+            case NodeType::RETURN_STMT:
+                return std::make_unique<ReturnStatement>(optionalExpression(node.a, index), line, column);
+            case NodeType::YIELD_STMT:
+                return std::make_unique<YieldStatement>(optionalExpression(node.a, index), line, column);
+            case NodeType::TRY_STMT: {
+                auto items = list(node.b, index);
+                if (items.size() % 3 != 0) corrupt("incomplete except clause");
+                std::vector<ExceptClause> clauses;
+                for (size_t i = 0; i < items.size(); i += 3) {
+                    clauses.emplace_back(string(items[i]), string(items[i + 1]), block(items[i + 2], index));
+                }
+                return std::make_unique<TryStatement>(block(node.a, index), std::move(clauses), line, column);
+            }
+            default:
+                corrupt("expected a statement at node " + std::to_string(index));
+        }
+    }
+};
+
+} // namespace
+
+std::unique_ptr<Program> FlatAstView::inflate(std::vector<const BlockStatement*>* blocks,
+                                              std::vector<const ASTNode*>* nodes) const {
+    Inflater inflater(*this, blocks, nodes);
+    return inflater.program();
+}
+
+FlatAstView FlatAstView::fromBuffer(const char* base, size_t size, const std::string& name) {
+    if (size < sizeof(Header)) {
+        corrupt(name + " is too small");
+    }
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        corrupt(name + " is not a flat AST file");
+    }
+    if (header.version != VERSION || header.byte_order != BYTE_ORDER_MARK) {
+        corrupt(name + " was written by an incompatible version or platform");
+    }
+    Layout layout(header);
+    if (layout.total() != size) {
+        corrupt(name + " has the wrong size");
+    }
+
+    // Point straight into the buffer, which must be 8-byte aligned
+    FlatAstView contents;
+    const char* cursor = base + sizeof(Header);
+    contents.numbers = reinterpret_cast<const double*>(cursor);
+    cursor += layout.numbers;
+    contents.nodes = reinterpret_cast<const Node*>(cursor);
+    cursor += layout.nodes;
+    contents.lists = reinterpret_cast<const uint32_t*>(cursor);
+    cursor += layout.lists;
+    contents.string_offsets = reinterpret_cast<const uint32_t*>(cursor);
+    cursor += layout.offsets;
+    contents.string_data = cursor;
+    contents.node_count = header.node_count;
+    contents.list_size = header.list_size;
+    contents.number_count = header.number_count;
+    contents.string_count = header.string_count;
+    contents.root = header.root;
+
+    // Node fields are checked as they are used; string bounds are checked here
+    for (uint32_t i = 0; i < header.string_count; ++i) {
+        if (contents.string_offsets[i] > contents.string_offsets[i + 1]) {
+            corrupt(name + " has an invalid string table");
+        }
+    }
+    if (contents.string_offsets[0] != 0 || contents.string_offsets[header.string_count] != header.string_bytes) {
+        corrupt(name + " has an invalid string table");
+    }
+    return contents;
+}
+
+FlatAst::FlatAst(const Program& program, std::unordered_map<const ASTNode*, uint32_t>* node_indices)
+    : indices(node_indices) {
+    std::vector<uint32_t> statements;
+    for (const auto& stmt : program.statements) {
+        statements.push_back(encode(stmt.get()));
+    }
+    root = addNode(program, addList(statements));
+}
+
+uint32_t FlatAst::intern(const std::string& text) {
+    auto it = interned.find(text);
+    if (it != interned.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(string_offsets.size() - 1);
+    string_data += text;
+    string_offsets.push_back(static_cast<uint32_t>(string_data.size()));
+    interned.emplace(text, id);
+    return id;
+}
+
+uint32_t FlatAst::addNode(const ASTNode& source, uint32_t a, uint32_t b, uint32_t c, uint8_t op) {
+    Node node;
+    node.type = static_cast<uint8_t>(source.type);
+    node.op = op;
+    node.column = static_cast<uint16_t>(source.column);
+    node.line = static_cast<uint32_t>(source.line);
+    node.a = a;
+    node.b = b;
+    node.c = c;
+    nodes.push_back(node);
+    uint32_t index = static_cast<uint32_t>(nodes.size() - 1);
+    if (indices) {
+        (*indices)[&source] = index;
+    }
+    return index;
+}
+
+uint32_t FlatAst::addList(const std::vector<uint32_t>& items) {
+    uint32_t offset = static_cast<uint32_t>(lists.size());
+    lists.push_back(static_cast<uint32_t>(items.size()));
+    lists.insert(lists.end(), items.begin(), items.end());
+    return offset;
+}
+
+uint32_t FlatAst::encode(const Expression* expr) {
+    if (!expr) {
+        return NO_NODE;
+    }
+
+    switch (expr->type) {
+        case NodeType::NUMBER_EXPR:
+            numbers.push_back(static_cast<const NumberExpression*>(expr)->value);
+            return addNode(*expr, static_cast<uint32_t>(numbers.size() - 1));
+        case NodeType::STRING_EXPR:
+            return addNode(*expr, intern(static_cast<const StringExpression*>(expr)->value));
+        case NodeType::BOOLEAN_EXPR:
+            return addNode(*expr, static_cast<const BooleanExpression*>(expr)->value ? 1 : 0);
+        case NodeType::NONE_EXPR:
+        case NodeType::SUPER_EXPR:
+            return addNode(*expr);
+        case NodeType::IDENTIFIER_EXPR:
+            return addNode(*expr, intern(static_cast<const IdentifierExpression*>(expr)->name));
+        case NodeType::BINARY_EXPR: {
+            auto binary = static_cast<const BinaryExpression*>(expr);
+            uint32_t left = encode(binary->left.get());
+            uint32_t right = encode(binary->right.get());
+            return addNode(*expr, left, right, 0, static_cast<uint8_t>(binary->operator_type));
+        }
+        case NodeType::UNARY_EXPR: {
+            auto unary = static_cast<const UnaryExpression*>(expr);
+            uint32_t operand = encode(unary->operand.get());
+            return addNode(*expr, operand, 0, 0, static_cast<uint8_t>(unary->operator_type));
+        }
+        case NodeType::CALL_EXPR: {
+            auto call = static_cast<const CallExpression*>(expr);
+            uint32_t callee = encode(call->callee.get());
+            std::vector<uint32_t> arguments;
+            for (const auto& arg : call->arguments) {
+                arguments.push_back(encode(arg.get()));
+            }
+            return addNode(*expr, callee, addList(arguments));
+        }
+        case NodeType::LIST_EXPR: {
+            std::vector<uint32_t> elements;
+            for (const auto& element : static_cast<const ListExpression*>(expr)->elements) {
+                elements.push_back(encode(element.get()));
+            }
+            return addNode(*expr, addList(elements));
+        }
+        case NodeType::DICT_EXPR: {
+            std::vector<uint32_t> items;
+            for (const auto& pair : static_cast<const DictExpression*>(expr)->pairs) {
+                items.push_back(encode(pair.first.get()));
+                items.push_back(encode(pair.second.get()));
+            }
+            return addNode(*expr, addList(items));
+        }
+        case NodeType::INDEX_EXPR: {
+            auto index = static_cast<const IndexExpression*>(expr);
+            uint32_t object = encode(index->object.get());
+            uint32_t key = encode(index->index.get());
+            return addNode(*expr, object, key);
+        }
+        case NodeType::ATTRIBUTE_EXPR: {
+            auto attr = static_cast<const AttributeExpression*>(expr);
+            uint32_t object = encode(attr->object.get());
+            return addNode(*expr, object, intern(attr->attribute));
+        }
+        default:
+            throw std::runtime_error("Cannot flatten expression type " + std::to_string(static_cast<int>(expr->type)));
+    }
+}
+
+uint32_t FlatAst::encode(const Statement* stmt) {
+    if (!stmt) {
+        return NO_NODE;
+    }
+
+    switch (stmt->type) {
+        case NodeType::EXPRESSION_STMT:
+            return addNode(*stmt, encode(static_cast<const ExpressionStatement*>(stmt)->expression.get()));
+        case NodeType::ASSIGNMENT_STMT: {
+            auto assign = static_cast<const AssignmentStatement*>(stmt);
+            uint32_t value = encode(assign->value.get());
+            return addNode(*stmt, intern(assign->identifier), value, 0, assign->augmented ? 1 : 0);
+        }
+        case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+            auto assign = static_cast<const AttributeAssignmentStatement*>(stmt);
+            uint32_t object = encode(assign->object.get());
+            uint32_t value = encode(assign->value.get());
+            return addNode(*stmt, object, intern(assign->attribute), value, assign->augmented ? 1 : 0);
+        }
+        case NodeType::INDEX_ASSIGNMENT_STMT: {
+            auto assign = static_cast<const IndexAssignmentStatement*>(stmt);
+            uint32_t object = encode(assign->object.get());
+            uint32_t index = encode(assign->index.get());
+            uint32_t value = encode(assign->value.get());
+            return addNode(*stmt, object, index, value, static_cast<uint8_t>(assign->op));
+        }
+        case NodeType::BLOCK_STMT: {
+            std::vector<uint32_t> statements;
+            for (const auto& inner : static_cast<const BlockStatement*>(stmt)->statements) {
+                statements.push_back(encode(inner.get()));
+            }
+            return addNode(*stmt, addList(statements));
+        }
+        case NodeType::IF_STMT: {
+            auto if_stmt = static_cast<const IfStatement*>(stmt);
+            uint32_t condition = encode(if_stmt->condition.get());
+            uint32_t then_branch = encode(if_stmt->then_branch.get());
+            uint32_t else_branch = encode(if_stmt->else_branch.get());
+            return addNode(*stmt, condition, then_branch, else_branch);
+        }
+        case NodeType::WHILE_STMT: {
+            auto while_stmt = static_cast<const WhileStatement*>(stmt);
+            uint32_t condition = encode(while_stmt->condition.get());
+            uint32_t body = encode(while_stmt->body.get());
+            return addNode(*stmt, condition, body);
+        }
+        case NodeType::FOR_STMT: {
+            auto for_stmt = static_cast<const ForStatement*>(stmt);
+            uint32_t iterable = encode(for_stmt->iterable.get());
+            uint32_t body = encode(for_stmt->body.get());
+            return addNode(*stmt, intern(for_stmt->variable), iterable, body);
+        }
+        case NodeType::FUNCTION_DEF_STMT: {
+            auto func = static_cast<const FunctionDefStatement*>(stmt);
+            // A saved file has no token stream to parse a deferred body from later
+            Parser::parseDeferredBody(*func);
+            std::vector<uint32_t> parameters;
+            for (const auto& param : func->parameters) {
+                parameters.push_back(intern(param));
+            }
+            uint32_t body = encode(func->body.get());
+            return addNode(*stmt, intern(func->name), addList(parameters), body);
+        }
+        case NodeType::CLASS_DEF_STMT: {
+            auto class_def = static_cast<const ClassDefStatement*>(stmt);
+            uint32_t base = encode(class_def->base.get());
+            uint32_t body = encode(class_def->body.get());
+            return addNode(*stmt, intern(class_def->name), base, body);
+        }
+        case NodeType::IMPORT_STMT: {
+            auto import = static_cast<const ImportStatement*>(stmt);
+            return addNode(*stmt, intern(import->module_name), intern(import->alias));
+        }
+        case NodeType::FROM_IMPORT_STMT: {
+            auto from_import = static_cast<const FromImportStatement*>(stmt);
+            std::vector<uint32_t> names;
+            for (const auto& item : from_import->imports) {
+                names.push_back(intern(item.first));
+                names.push_back(intern(item.second));
+            }
+            return addNode(*stmt, intern(from_import->module_name), addList(names));
+        }
+        case NodeType::RETURN_STMT:
+            return addNode(*stmt, encode(static_cast<const ReturnStatement*>(stmt)->value.get()));
+        case NodeType::YIELD_STMT:
+            return addNode(*stmt, encode(static_cast<const YieldStatement*>(stmt)->value.get()));
+        case NodeType::TRY_STMT: {
+            auto try_stmt = static_cast<const TryStatement*>(stmt);
+            uint32_t body = encode(try_stmt->try_body.get());
+            std::vector<uint32_t> clauses;
+            for (const auto& clause : try_stmt->except_clauses) {
+                clauses.push_back(intern(clause.exception_type));
+                clauses.push_back(intern(clause.variable_name));
+                clauses.push_back(encode(clause.body.get()));
+            }
+            return addNode(*stmt, body, addList(clauses));
+        }
+        default:
+            throw std::runtime_error("Cannot flatten statement type " + std::to_string(static_cast<int>(stmt->type)));
+    }
+}
+
+FlatAstView FlatAst::view() const {
+    FlatAstView result;
+    result.nodes = nodes.data();
+    result.lists = lists.data();
+    result.numbers = numbers.data();
+    result.string_offsets = string_offsets.data();
+    result.string_data = string_data.data();
+    result.node_count = static_cast<uint32_t>(nodes.size());
+    result.list_size = static_cast<uint32_t>(lists.size());
+    result.number_count = static_cast<uint32_t>(numbers.size());
+    result.string_count = static_cast<uint32_t>(string_offsets.size() - 1);
+    result.root = root;
+    return result;
+}
+
+void FlatAst::write(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+    write(file);
+    if (!file) {
+        throw std::runtime_error("Could not write file: " + path);
+    }
+}
+
+void FlatAst::write(std::ostream& file) const {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.root = root;
+    header.node_count = static_cast<uint32_t>(nodes.size());
+    header.list_size = static_cast<uint32_t>(lists.size());
+    header.number_count = static_cast<uint32_t>(numbers.size());
+    header.string_count = static_cast<uint32_t>(string_offsets.size() - 1);
+    header.string_bytes = static_cast<uint32_t>(string_data.size());
+
+    static const char zeros[8] = {};
+    auto section = [&](const void* data, size_t bytes) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        file.write(zeros, static_cast<std::streamsize>(padded(bytes) - bytes));
+    };
+    section(&header, sizeof(header));
+    section(numbers.data(), numbers.size() * sizeof(double));
+    section(nodes.data(), nodes.size() * sizeof(Node));
+    section(lists.data(), lists.size() * sizeof(uint32_t));
+    section(string_offsets.data(), string_offsets.size() * sizeof(uint32_t));
+    section(string_data.data(), string_data.size());
+}
+
+MappedFlatAst::MappedFlatAst(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        close(fd);
+        corrupt(path + " is too small");
+    }
+    size = static_cast<size_t>(info.st_size);
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw std::runtime_error("Could not map file: " + path);
+    }
+
+    try {
+        // mmap'd memory is page aligned
+        contents = FlatAstView::fromBuffer(static_cast<const char*>(data), size, path);
+    } catch (...) {
+        munmap(data, size);
+        throw;
+    }
+}
+
+MappedFlatAst::~MappedFlatAst() {
+    if (data) {
+        munmap(data, size);
+    }
+}
+
+bool MappedFlatAst::isFlatAstFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+} // namespace flat
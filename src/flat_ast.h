@@ -0,0 +1,120 @@
+#pragma once
+#include "parser.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Flat, index-based encoding of a parsed Program.
+//
+// Nodes live in one contiguous array and refer to their children by 32-bit
+// index; variable-length children (arguments, block statements, parameters,
+// dict pairs, except clauses) are runs in a shared list array, and every
+// identifier and string literal is interned once in a string table. The same
+// layout is written to disk as-is, so loading a file is an mmap with no
+// parsing or per-field decoding. It is a load and storage format only: the
+// interpreter does not evaluate the flat arrays, and every consumer (running
+// a saved AST, snapshots, --emit-exe) calls inflate() to rebuild the pointer
+// AST, which resolves slots again.
+namespace flat {
+
+constexpr uint32_t NO_NODE = UINT32_MAX;
+
+// Fields a, b and c depend on the node type; see flat_ast.cpp
+struct Node {
+    uint8_t type;     // NodeType
+    uint8_t op;       // TokenType of binary/unary operators
+    uint16_t column;
+    uint32_t line;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+};
+static_assert(sizeof(Node) == 20, "flat nodes are written to disk as-is");
+
+// Read-only access to a flat AST, either owned (FlatAst) or mapped (MappedFlatAst)
+class FlatAstView {
+public:
+    const Node* nodes = nullptr;
+    const uint32_t* lists = nullptr;          // runs of [count, item...]
+    const double* numbers = nullptr;
+    const uint32_t* string_offsets = nullptr; // string_count + 1 offsets into string_data
+    const char* string_data = nullptr;
+    uint32_t node_count = 0;
+    uint32_t list_size = 0;
+    uint32_t number_count = 0;
+    uint32_t string_count = 0;
+    uint32_t root = NO_NODE;                  // the PROGRAM node
+
+    const Node& node(uint32_t index) const { return nodes[index]; }
+    uint32_t listCount(uint32_t list) const { return lists[list]; }
+    const uint32_t* listItems(uint32_t list) const { return lists + list + 1; }
+    double number(uint32_t index) const { return numbers[index]; }
+    std::string_view string(uint32_t id) const {
+        return std::string_view(string_data + string_offsets[id], string_offsets[id + 1] - string_offsets[id]);
+    }
+
+    // Rebuilds the pointer tree the interpreter executes (functions are
+    // resolved as they are rebuilt, like the parser does). If blocks is
+    // given it maps node indices to the rebuilt BlockStatements, and nodes
+    // likewise to every rebuilt node.
+    std::unique_ptr<Program> inflate(std::vector<const BlockStatement*>* blocks = nullptr,
+                                     std::vector<const ASTNode*>* nodes = nullptr) const;
+
+    // View of a flat AST file's contents held in an 8-byte aligned buffer;
+    // name is used in error messages
+    static FlatAstView fromBuffer(const char* data, size_t size, const std::string& name);
+};
+
+// A flat AST built in memory from a parsed Program
+class FlatAst {
+private:
+    std::vector<Node> nodes;
+    std::vector<uint32_t> lists;
+    std::vector<double> numbers;
+    std::vector<uint32_t> string_offsets{0};
+    std::string string_data;
+    std::unordered_map<std::string, uint32_t> interned;
+    std::unordered_map<const ASTNode*, uint32_t>* indices; // only used while encoding
+    uint32_t root = NO_NODE;
+
+public:
+    // If node_indices is given, it receives the index of every encoded node
+    explicit FlatAst(const Program& program, std::unordered_map<const ASTNode*, uint32_t>* node_indices = nullptr);
+
+    FlatAstView view() const;
+
+    // Writes the binary format read back by MappedFlatAst
+    void write(const std::string& path) const;
+    void write(std::ostream& out) const;
+
+private:
+    uint32_t intern(const std::string& text);
+    uint32_t addNode(const ASTNode& source, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0, uint8_t op = 0);
+    uint32_t addList(const std::vector<uint32_t>& items);
+    uint32_t encode(const Expression* expr);
+    uint32_t encode(const Statement* stmt);
+};
+
+// A flat AST file mapped read-only into memory
+class MappedFlatAst {
+private:
+    void* data = nullptr;
+    size_t size = 0;
+    FlatAstView contents;
+
+public:
+    explicit MappedFlatAst(const std::string& path);
+    MappedFlatAst(const MappedFlatAst&) = delete;
+    MappedFlatAst& operator=(const MappedFlatAst&) = delete;
+    ~MappedFlatAst();
+
+    const FlatAstView& view() const { return contents; }
+
+    // True if the file starts with the flat AST magic
+    static bool isFlatAstFile(const std::string& path);
+};
+
+} // namespace flat
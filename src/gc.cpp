@@ -0,0 +1,234 @@
+#include "gc.h"
+#include "interpreter.h"
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+
+GarbageCollector& GarbageCollector::instance() {
+    static GarbageCollector collector;
+    return collector;
+}
+
+void GarbageCollector::setThreshold(size_t value) {
+    threshold = std::max<size_t>(value, 1);
+    next_collection = threshold;
+    collection_due = allocations >= next_collection;
+}
+
+size_t GarbageCollector::trackedCount() {
+    prune();
+    return tracked.size();
+}
+
+void GarbageCollector::collectScheduled() {
+    if (enabled) {
+        collect();
+    } else {
+        // Still drop dead registry entries so the registry stays bounded
+        prune();
+        reschedule(tracked.size());
+    }
+}
+
+void GarbageCollector::prune() {
+    tracked.erase(std::remove_if(tracked.begin(), tracked.end(),
+                                 [](const Entry& e) { return e.ref.expired(); }),
+                  tracked.end());
+}
+
+void GarbageCollector::reschedule(size_t survivors) {
+    // Grow the interval with the live heap so collections stay amortized O(1)
+    allocations = 0;
+    next_collection = std::max(threshold, survivors);
+    collection_due = false;
+}
+
+template <typename F>
+void GarbageCollector::forEachReference(const Entry& entry, F&& visit) {
+    auto visitValue = [&visit](const Value& v) {
+        if (v) visit(v.get());
+    };
+
+    switch (entry.kind) {
+        case GCKind::VALUE: {
+            const auto* wrapper = static_cast<const ValueWrapper*>(entry.object);
+            std::visit([&](const auto& v) {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, ListType>) {
+                    for (const auto& item : v) visitValue(item);
+                } else if constexpr (std::is_same_v<T, DictType>) {
+                    for (const auto& pair : v) visitValue(pair.second);
+                } else if constexpr (std::is_same_v<T, std::shared_ptr<Function>> ||
+                                     std::is_same_v<T, std::shared_ptr<Class>> ||
+                                     std::is_same_v<T, std::shared_ptr<ClassInstance>> ||
+                                     std::is_same_v<T, std::shared_ptr<Module>> ||
+                                     std::is_same_v<T, std::shared_ptr<Generator>>) {
+                    if (v) visit(v.get());
+                }
+            }, wrapper->value);
+            break;
+        }
+        case GCKind::ENVIRONMENT: {
+            const auto* env = static_cast<const Environment*>(entry.object);
+            for (const auto& pair : env->variables) {
+                if (pair.second.cell) {
+                    visit(pair.second.cell.get());
+                } else {
+                    visitValue(pair.second.value);
+                }
+            }
+            if (env->parent) visit(env->parent.get());
+            break;
+        }
+        case GCKind::FUNCTION: {
+            const auto* function = static_cast<const Function*>(entry.object);
+            if (function->closure) visit(function->closure.get());
+            break;
+        }
+        case GCKind::CLASS: {
+            const auto* cls = static_cast<const Class*>(entry.object);
+            if (cls->closure) visit(cls->closure.get());
+            if (cls->base) visit(cls->base.get());
+            for (const auto& pair : cls->methods) visitValue(pair.second);
+            break;
+        }
+        case GCKind::INSTANCE: {
+            const auto* instance = static_cast<const ClassInstance*>(entry.object);
+            if (instance->classRef) visit(instance->classRef.get());
+            for (const auto& pair : instance->attributes) visitValue(pair.second);
+            break;
+        }
+        case GCKind::MODULE: {
+            const auto* module = static_cast<const Module*>(entry.object);
+            if (module->module_env) visit(module->module_env.get());
+            break;
+        }
+        case GCKind::CELL:
+            visitValue(static_cast<const Cell*>(entry.object)->value);
+            break;
+        case GCKind::GENERATOR: {
+            const auto* generator = static_cast<const Generator*>(entry.object);
+            if (generator->function) visit(generator->function.get());
+            if (generator->environment) visit(generator->environment.get());
+            visitValue(generator->yielded);
+            break;
+        }
+    }
+}
+
+void GarbageCollector::clearReferences(const Entry& entry) {
+    switch (entry.kind) {
+        case GCKind::VALUE:
+            const_cast<ValueWrapper*>(static_cast<const ValueWrapper*>(entry.object))->value = nullptr;
+            break;
+        case GCKind::ENVIRONMENT: {
+            auto* env = const_cast<Environment*>(static_cast<const Environment*>(entry.object));
+            env->variables.clear();
+            env->parent.reset();
+            break;
+        }
+        case GCKind::FUNCTION:
+            const_cast<Function*>(static_cast<const Function*>(entry.object))->closure.reset();
+            break;
+        case GCKind::CLASS: {
+            auto* cls = const_cast<Class*>(static_cast<const Class*>(entry.object));
+            cls->closure.reset();
+            cls->base.reset();
+            cls->methods.clear();
+            break;
+        }
+        case GCKind::INSTANCE: {
+            auto* instance = const_cast<ClassInstance*>(static_cast<const ClassInstance*>(entry.object));
+            instance->attributes.clear();
+            instance->classRef.reset();
+            break;
+        }
+        case GCKind::MODULE:
+            const_cast<Module*>(static_cast<const Module*>(entry.object))->module_env.reset();
+            break;
+        case GCKind::CELL:
+            const_cast<Cell*>(static_cast<const Cell*>(entry.object))->value.reset();
+            break;
+        case GCKind::GENERATOR: {
+            // The function stays: a suspended body is unwound after the
+            // generator is gone and still walks its statements
+            auto* generator = const_cast<Generator*>(static_cast<const Generator*>(entry.object));
+            generator->environment.reset();
+            generator->yielded.reset();
+            break;
+        }
+    }
+}
+
+size_t GarbageCollector::collect() {
+    auto start = std::chrono::steady_clock::now();
+    prune();
+
+    // Start from the strong counts and subtract every reference that
+    // originates inside the tracked heap
+    std::unordered_map<const void*, size_t> index;
+    index.reserve(tracked.size());
+    for (size_t i = 0; i < tracked.size(); ++i) {
+        index.emplace(tracked[i].object, i);
+    }
+
+    std::vector<long> refs(tracked.size());
+    for (size_t i = 0; i < tracked.size(); ++i) {
+        refs[i] = tracked[i].ref.use_count();
+    }
+    for (const auto& entry : tracked) {
+        forEachReference(entry, [&](const void* child) {
+            auto it = index.find(child);
+            if (it != index.end()) refs[it->second]--;
+        });
+    }
+
+    // Anything still referenced from outside is a root; mark what it reaches
+    std::vector<bool> reachable(tracked.size(), false);
+    std::vector<size_t> worklist;
+    for (size_t i = 0; i < tracked.size(); ++i) {
+        if (refs[i] > 0) {
+            reachable[i] = true;
+            worklist.push_back(i);
+        }
+    }
+    while (!worklist.empty()) {
+        size_t i = worklist.back();
+        worklist.pop_back();
+        forEachReference(tracked[i], [&](const void* child) {
+            auto it = index.find(child);
+            if (it != index.end() && !reachable[it->second]) {
+                reachable[it->second] = true;
+                worklist.push_back(it->second);
+            }
+        });
+    }
+
+    // Keep the garbage alive while breaking its cycles, then let it go
+    std::vector<std::shared_ptr<void>> garbage;
+    for (size_t i = 0; i < tracked.size(); ++i) {
+        if (!reachable[i]) {
+            garbage.push_back(tracked[i].ref.lock());
+        }
+    }
+    for (size_t i = 0; i < tracked.size(); ++i) {
+        if (!reachable[i]) {
+            clearReferences(tracked[i]);
+        }
+    }
+    size_t freed = garbage.size();
+    garbage.clear();
+    prune();
+
+    double pause = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    stats.collections++;
+    stats.objects_freed += freed;
+    stats.last_freed = freed;
+    stats.last_pause_ms = pause;
+    stats.max_pause_ms = std::max(stats.max_pause_ms, pause);
+    stats.total_pause_ms += pause;
+
+    reschedule(tracked.size());
+    return freed;
+}
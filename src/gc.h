@@ -0,0 +1,86 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// Kinds of runtime objects that can take part in reference cycles
+enum class GCKind : unsigned char {
+    VALUE,       // ValueWrapper holding a container, function, class, instance or module
+    ENVIRONMENT,
+    FUNCTION,
+    CLASS,
+    INSTANCE,
+    MODULE,
+    CELL,
+    GENERATOR
+};
+
+struct GCStats {
+    size_t collections = 0;
+    size_t objects_freed = 0;
+    size_t last_freed = 0;
+    double last_pause_ms = 0.0;
+    double max_pause_ms = 0.0;
+    double total_pause_ms = 0.0;
+};
+
+// Cycle collector for the shared_ptr-managed runtime heap.
+//
+// Container objects register themselves when they are created. A collection
+// uses trial deletion: every tracked object starts with its strong reference
+// count, references held by other tracked objects are subtracted, and whatever
+// still has a positive count is referenced from outside the heap (interpreter
+// state, C++ locals, including those of generator bodies suspended on their
+// own stacks). Everything not reachable from those roots is garbage
+// kept alive only by cycles; its outgoing references are cleared so the
+// reference counts drop to zero.
+class GarbageCollector {
+public:
+    static GarbageCollector& instance();
+
+    template <typename T>
+    void track(const std::shared_ptr<T>& object, GCKind kind) {
+        tracked.push_back({object, object.get(), kind});
+        if (++allocations >= next_collection) {
+            collection_due = true;
+        }
+    }
+
+    // Cheap check for the interpreter's safe points
+    bool collectionDue() const { return collection_due; }
+    void collectScheduled();
+
+    // Run a full collection, returns the number of objects freed
+    size_t collect();
+
+    void setThreshold(size_t value);
+    size_t getThreshold() const { return threshold; }
+    void setEnabled(bool value) { enabled = value; }
+    bool isEnabled() const { return enabled; }
+    size_t trackedCount();
+    const GCStats& getStats() const { return stats; }
+
+private:
+    struct Entry {
+        std::weak_ptr<void> ref;
+        const void* object;
+        GCKind kind;
+    };
+
+    std::vector<Entry> tracked;
+    GCStats stats;
+    size_t threshold = 10000;
+    size_t next_collection = 10000;
+    size_t allocations = 0;
+    bool enabled = true;
+    bool collection_due = false;
+
+    GarbageCollector() = default;
+
+    void prune();
+    void reschedule(size_t survivors);
+
+    template <typename F>
+    static void forEachReference(const Entry& entry, F&& visit);
+    static void clearReferences(const Entry& entry);
+};
@@ -1,4 +1,9 @@
 #include "interpreter.h"
+#include "coroutine.h"
+#include "jit.h"
+#include "parallel_parser.h"
+#include "pool.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
@@ -6,45 +11,94 @@
 #include <fstream>
 #include <filesystem>
 
+// Names the interpreter resolves itself, interned once
+static const Symbol INIT_METHOD("__init__");
+static const Symbol ITER_METHOD("__iter__");
+static const Symbol NEXT_METHOD("__next__");
+static const Symbol RAISE_BUILTIN("raise");
+
+// Values and environments are allocated from the size-class pools
+template <typename T>
+static Value pooledValue(T&& v) {
+    return std::allocate_shared<ValueWrapper>(PoolAllocator<ValueWrapper>(), std::forward<T>(v));
+}
+
+// Values that can reference other heap objects are registered with the cycle collector
+static Value trackedValue(Value v) {
+    GarbageCollector::instance().track(v, GCKind::VALUE);
+    return v;
+}
+
 // Convenience functions for creating values
 Value makeValue(double d) {
-    return std::make_shared<ValueWrapper>(d);
+    return pooledValue(d);
 }
 
 Value makeValue(const std::string& s) {
-    return std::make_shared<ValueWrapper>(s);
+    return pooledValue(s);
+}
+
+Value makeValue(std::string&& s) {
+    return pooledValue(std::move(s));
 }
 
 Value makeValue(bool b) {
-    return std::make_shared<ValueWrapper>(b);
+    return pooledValue(b);
 }
 
 Value makeValue(std::nullptr_t) {
-    return std::make_shared<ValueWrapper>(nullptr);
+    return pooledValue(nullptr);
 }
 
 Value makeValue(std::shared_ptr<Function> f) {
-    return std::make_shared<ValueWrapper>(f);
+    return trackedValue(pooledValue(f));
 }
 
 Value makeValue(const ListType& l) {
-    return std::make_shared<ValueWrapper>(l);
+    return trackedValue(pooledValue(l));
 }
 
 Value makeValue(const DictType& d) {
-    return std::make_shared<ValueWrapper>(d);
+    return trackedValue(pooledValue(d));
 }
 
 Value makeValue(std::shared_ptr<Class> c) {
-    return std::make_shared<ValueWrapper>(c);
+    return trackedValue(pooledValue(c));
 }
 
 Value makeValue(std::shared_ptr<ClassInstance> ci) {
-    return std::make_shared<ValueWrapper>(ci);
+    return trackedValue(pooledValue(ci));
 }
 
 Value makeValue(std::shared_ptr<Module> m) {
-    return std::make_shared<ValueWrapper>(m);
+    return trackedValue(pooledValue(m));
+}
+
+Value makeValue(const Range& r) {
+    return pooledValue(r);
+}
+
+Value makeValue(std::shared_ptr<Generator> g) {
+    return trackedValue(pooledValue(g));
+}
+
+Value makeValue(std::shared_ptr<const Builtin> b) {
+    return pooledValue(b);
+}
+
+double Range::length() const {
+    if ((step > 0 && start < stop) || (step < 0 && start > stop)) {
+        return std::ceil((stop - start) / step);
+    }
+    return 0;
+}
+
+bool Range::operator==(const Range& other) const {
+    double count = length();
+    if (count != other.length()) {
+        return false;
+    }
+    return count == 0 || (start == other.start && (count == 1 || step == other.step));
 }
 
 // Helper functions for value access
@@ -88,11 +142,23 @@ bool isModule(const Value& v) {
     return std::holds_alternative<std::shared_ptr<Module>>(v->value);
 }
 
+bool isRange(const Value& v) {
+    return std::holds_alternative<Range>(v->value);
+}
+
+bool isGenerator(const Value& v) {
+    return std::holds_alternative<std::shared_ptr<Generator>>(v->value);
+}
+
+bool isBuiltin(const Value& v) {
+    return std::holds_alternative<std::shared_ptr<const Builtin>>(v->value);
+}
+
 double getNumber(const Value& v) {
     return std::get<double>(v->value);
 }
 
-std::string getString(const Value& v) {
+const std::string& getString(const Value& v) {
     return std::get<std::string>(v->value);
 }
 
@@ -124,6 +190,18 @@ std::shared_ptr<Module> getModule(const Value& v) {
     return std::get<std::shared_ptr<Module>>(v->value);
 }
 
+const Range& getRange(const Value& v) {
+    return std::get<Range>(v->value);
+}
+
+std::shared_ptr<Generator> getGenerator(const Value& v) {
+    return std::get<std::shared_ptr<Generator>>(v->value);
+}
+
+const Builtin& getBuiltin(const Value& v) {
+    return *std::get<std::shared_ptr<const Builtin>>(v->value);
+}
+
 // Convert value to string for printing
 std::string valueToString(const Value& v) {
     if (isNumber(v)) {
@@ -169,6 +247,18 @@ std::string valueToString(const Value& v) {
     } else if (isModule(v)) {
         auto module = getModule(v);
         return "<module '" + module->name + "'>";
+    } else if (isRange(v)) {
+        const Range& range = getRange(v);
+        std::string result = "range(" + valueToString(makeValue(range.start)) + ", " +
+                             valueToString(makeValue(range.stop));
+        if (range.step != 1) {
+            result += ", " + valueToString(makeValue(range.step));
+        }
+        return result + ")";
+    } else if (isGenerator(v)) {
+        return "<generator object " + getGenerator(v)->function->name + ">";
+    } else if (isBuiltin(v)) {
+        return "builtin:" + getBuiltin(v).name;
     }
     return "<unknown>";
 }
@@ -200,6 +290,12 @@ std::string getTypeName(const Value& v) {
         return instance->classRef->name;
     } else if (isModule(v)) {
         return "module";
+    } else if (isRange(v)) {
+        return "range";
+    } else if (isGenerator(v)) {
+        return "generator";
+    } else if (isBuiltin(v)) {
+        return "builtin_function_or_method";
     }
     return "unknown";
 }
@@ -209,20 +305,51 @@ std::shared_ptr<Module> Interpreter::loadModule(const std::string& module_name)
     // Check if module is already in cache
     auto it = module_cache.find(module_name);
     if (it != module_cache.end()) {
+        if (options.watch_modules && moduleChanged(*it->second)) {
+            reloadModule(*it->second);
+        }
         return it->second;
     }
     
-    // Construct file path (look for .py file)
+    // Construct file path (look for .py file); modules built into the
+    // program have none
+    auto embedded = embedded_modules.find(module_name);
     std::string file_path = module_name + ".py";
-    if (!std::filesystem::exists(file_path)) {
+    if (embedded == embedded_modules.end() && !std::filesystem::exists(file_path)) {
         throw std::runtime_error("Module '" + module_name + "' not found");
     }
     
+    // Create module
+    auto module = std::make_shared<Module>();
+    collector.track(module, GCKind::MODULE);
+    module->name = module_name;
+    module->module_env = makeEnvironment(globals);
+    module->module_env->setModuleScope(true);
+    
+    try {
+        if (embedded != embedded_modules.end()) {
+            runModule(*module, embedded->second);
+        } else {
+            module->file_path = file_path;
+            executeModule(*module);
+        }
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Error loading module '" + module_name + "': " + e.what());
+    }
+    
+    // Cache the module
+    module_cache[module_name] = module;
+    
+    return module;
+}
+
+void Interpreter::executeModule(Module& module) {
     // Read file contents
-    std::ifstream file(file_path);
+    std::ifstream file(module.file_path);
     if (!file.is_open()) {
-        throw std::runtime_error("Could not open module file: " + file_path);
+        throw std::runtime_error("Could not open module file: " + module.file_path);
     }
+    module.mtime = std::filesystem::last_write_time(module.file_path);
     
     std::string source;
     std::string line;
@@ -231,100 +358,239 @@ std::shared_ptr<Module> Interpreter::loadModule(const std::string& module_name)
     }
     file.close();
     
-    // Create module
-    auto module = std::make_shared<Module>();
-    module->name = module_name;
-    module->file_path = file_path;
-    module->module_env = std::make_shared<Environment>(globals);
+    // Parse module
+    std::shared_ptr<Program> program;
+    if (options.parse_threads != 1) {
+        program = ParallelParser::parse(source, options.parse_threads, options.lazy_parse);
+    } else {
+        Lexer lexer(source);
+        Parser parser(lexer.tokenize());
+        parser.setDeferFunctionBodies(options.lazy_parse);
+        program = parser.parse();
+    }
+    runModule(module, std::move(program));
+}
+
+void Interpreter::runModule(Module& module, std::shared_ptr<Program> program) {
+    // Functions and classes from the previous AST keep it alive through
+    // their source pointer, so it can be replaced here
+    module.ast = program;
+    
+    // Save current environment
+    auto saved_env = environment;
+    bool saved_pending = scope_pending;
+    auto saved_source = std::move(current_source);
+    environment = module.module_env;
+    scope_pending = false;
+    current_source = program;
     
-    // Parse and execute module
+    // Execute module in its own environment
     try {
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
-        
-        Parser parser(tokens);
-        auto program = parser.parse();
-        
-        // Store the AST in the module to keep it alive
-        module->ast = std::move(program);
-        
-        // Save current environment
-        auto saved_env = environment;
-        environment = module->module_env;
-        
-        // Execute module in its own environment
-        for (const auto& stmt : module->ast->statements) {
-            execute(*stmt);
-        }
-        
-        // Restore previous environment
+        executeStatements(program->statements);
+    } catch (...) {
         environment = saved_env;
-        
-        // Cache the module
-        module_cache[module_name] = module;
-        
-        return module;
+        scope_pending = saved_pending;
+        current_source = std::move(saved_source);
+        throw;
+    }
+    
+    // Restore previous environment
+    environment = saved_env;
+    scope_pending = saved_pending;
+    current_source = std::move(saved_source);
+}
+
+void Interpreter::addModule(const std::string& name, std::shared_ptr<Program> program) {
+    embedded_modules[name] = std::move(program);
+}
+
+bool Interpreter::moduleChanged(const Module& module) {
+    if (module.file_path.empty()) {
+        return false;
+    }
+    std::error_code error;
+    auto mtime = std::filesystem::last_write_time(module.file_path, error);
+    return !error && mtime != module.mtime;
+}
+
+void Interpreter::reloadModule(Module& module) {
+    // A module built into the program is re-executed from its embedded AST
+    auto embedded = module.file_path.empty() ? embedded_modules.find(module.name) : embedded_modules.end();
+    if (module.file_path.empty() && embedded == embedded_modules.end()) {
+        throw std::runtime_error("Cannot reload built-in module '" + module.name + "'");
+    }
+    
+    // Existing bindings stay; the new source re-binds what it defines, and
+    // values taken from the old version keep working
+    try {
+        if (embedded != embedded_modules.end()) {
+            runModule(module, embedded->second);
+        } else {
+            executeModule(module);
+        }
     } catch (const std::exception& e) {
-        throw std::runtime_error("Error loading module '" + module_name + "': " + e.what());
+        throw std::runtime_error("Error reloading module '" + module.name + "': " + e.what());
+    }
+}
+
+size_t Interpreter::reloadChangedModules() {
+    size_t reloaded = 0;
+    for (auto& [name, module] : module_cache) {
+        if (moduleChanged(*module)) {
+            reloadModule(*module);
+            reloaded++;
+        }
     }
+    return reloaded;
 }
 
 Environment::Environment(std::shared_ptr<Environment> parent) : parent(parent) {}
 
-void Environment::define(const std::string& name, const Value& value) {
-    variables[name] = value;
+std::shared_ptr<Environment> makeEnvironment(std::shared_ptr<Environment> parent) {
+    auto env = std::allocate_shared<Environment>(PoolAllocator<Environment>(), std::move(parent));
+    GarbageCollector::instance().track(env, GCKind::ENVIRONMENT);
+    return env;
 }
 
-void Environment::defineBuiltin(const std::string& name, [[maybe_unused]] BuiltinFunction func) {
-    // For simplicity, store builtin function names as special string values
-    variables[name] = makeValue(std::string("builtin:" + name));
+void Environment::define(Symbol name, const Value& value) {
+    variables[name].slot() = value;
 }
 
-Value Environment::get(const std::string& name) {
-    auto var_it = variables.find(name);
-    if (var_it != variables.end()) {
-        return var_it->second;
+
+Value* Environment::lookup(Symbol name) {
+    for (Environment* env = this; env; env = env->parent.get()) {
+        auto it = env->variables.find(name);
+        if (it != env->variables.end()) {
+            Value& slot = it->second.slot();
+            // An empty cell is a captured name that is not assigned yet
+            if (slot) {
+                return &slot;
+            }
+        }
     }
-    
-    if (parent) {
-        return parent->get(name);
+    return nullptr;
+}
+
+Value Environment::tryGet(Symbol name) {
+    Value* slot = lookup(name);
+    return slot ? *slot : nullptr;
+}
+
+bool Environment::tryAssign(Symbol name, const Value& value) {
+    Value* slot = lookup(name);
+    if (!slot) {
+        return false;
     }
-    
-    throw std::runtime_error("Undefined variable '" + name + "'");
+    *slot = value;
+    return true;
 }
 
-void Environment::assign(const std::string& name, const Value& value) {
-    auto it = variables.find(name);
-    if (it != variables.end()) {
-        it->second = value;
-        return;
+Value Environment::get(Symbol name) {
+    Value* slot = lookup(name);
+    if (!slot) {
+        throw std::runtime_error("Undefined variable '" + name + "'");
     }
-    
-    if (parent) {
-        parent->assign(name, value);
-        return;
+    return *slot;
+}
+
+void Environment::assign(Symbol name, const Value& value) {
+    if (!tryAssign(name, value)) {
+        throw std::runtime_error("Undefined variable '" + name + "'");
     }
-    
-    throw std::runtime_error("Undefined variable '" + name + "'");
 }
 
-const std::unordered_map<std::string, Value>& Environment::getVariables() const {
-    return variables;
+void Environment::forEachVariable(const std::function<void(Symbol, const Value&)>& visit) {
+    for (auto& [name, binding] : variables) {
+        if (binding.slot()) {
+            visit(name, binding.slot());
+        }
+    }
+}
+
+std::shared_ptr<Cell> Environment::captureCell(Symbol name, const Environment* stop) {
+    for (Environment* env = this; env && env != stop; env = env->parent.get()) {
+        auto it = env->variables.find(name);
+        if (it != env->variables.end()) {
+            Binding& binding = it->second;
+            if (!binding.cell) {
+                binding.cell = std::make_shared<Cell>();
+                GarbageCollector::instance().track(binding.cell, GCKind::CELL);
+                binding.cell->value = std::move(binding.value);
+            }
+            return binding.cell;
+        }
+    }
+    return nullptr;
+}
+
+void Environment::bindCell(Symbol name, std::shared_ptr<Cell> cell) {
+    Binding& binding = variables[name];
+    if (!binding.cell && binding.value) {
+        cell->value = std::move(binding.value);
+    }
+    binding.cell = std::move(cell);
 }
 
-Interpreter::Interpreter() {
-    globals = std::make_shared<Environment>();
+Interpreter::Interpreter(const InterpreterOptions& options)
+    : collector(GarbageCollector::instance()), options(options) {
+    globals = makeEnvironment();
+    globals->setModuleScope(true);
     environment = globals;
+    stack.reserve(1024);
+    stop_iteration = makeValue(nullptr);
     setupBuiltins();
+    if (options.jit) {
+        jit = std::make_unique<jit::Compiler>(options.jit_log, options.jit_perf_map);
+    }
+}
+
+Interpreter::~Interpreter() {
+    // Suspended generator bodies have interpreter frames on their stacks,
+    // which have to be unwound while the interpreter is still intact
+    for (Generator* generator : suspended_generators) {
+        abandoned_generators.push_back(std::move(generator->coroutine));
+    }
+    suspended_generators.clear();
+    closeGenerators();
+    
+    // Globals and the functions defined in them reference each other, so
+    // dropping the roots is not enough to release them
+    environment.reset();
+    globals.reset();
+    stack.clear();
+    return_value.reset();
+    module_cache.clear();
+    collector.collect();
 }
 
 void Interpreter::interpret(const Program& program) {
+    try {
+        if (executeStatements(program.statements) == ExecStatus::RETURN) {
+            std::cout << "Top-level return: " << valueToString(return_value) << std::endl;
+            return_value.reset();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Runtime error: " << e.what() << std::endl;
+    }
+}
+
+void Interpreter::interpretInteractive(const Program& program) {
     try {
         for (const auto& stmt : program.statements) {
-            execute(*stmt);
+            if (stmt->type == NodeType::EXPRESSION_STMT) {
+                if (collector.collectionDue()) {
+                    collector.collectScheduled();
+                }
+                Value value = evaluate(*static_cast<const ExpressionStatement&>(*stmt).expression);
+                if (!isNone(value)) {
+                    std::cout << valueToString(value) << std::endl;
+                }
+            } else if (execute(*stmt) == ExecStatus::RETURN) {
+                std::cout << "Top-level return: " << valueToString(return_value) << std::endl;
+                return_value.reset();
+                break;
+            }
         }
-    } catch (const ReturnException& ret) {
-        std::cout << "Top-level return: " << valueToString(ret.value) << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "Runtime error: " << e.what() << std::endl;
     }
@@ -353,19 +619,40 @@ Value Interpreter::evaluate(const Expression& expr) {
         
         case NodeType::IDENTIFIER_EXPR: {
             const auto& id_expr = static_cast<const IdentifierExpression&>(expr);
+            if (id_expr.slot >= 0) {
+                return stack[frame_base + id_expr.slot];
+            }
+            if (id_expr.number_slot >= 0 && number_base != NO_NUMBER_FRAME) {
+                return makeValue(numbers[number_base + id_expr.number_slot]);
+            }
             return environment->get(id_expr.name);
         }
         
         case NodeType::BINARY_EXPR: {
             const auto& bin_expr = static_cast<const BinaryExpression&>(expr);
+            if (bin_expr.left->unboxed && bin_expr.right->unboxed && number_base != NO_NUMBER_FRAME) {
+                if (Value result = evaluateUnboxedBinary(bin_expr)) {
+                    return result;
+                }
+            }
             Value left = evaluate(*bin_expr.left);
             Value right = evaluate(*bin_expr.right);
-            return performBinaryOp(bin_expr.operator_type, left, right);
+            return applyBinary(bin_expr, left, right);
         }
         
         case NodeType::UNARY_EXPR: {
             const auto& un_expr = static_cast<const UnaryExpression&>(expr);
             Value operand = evaluate(*un_expr.operand);
+            if (un_expr.quickened == Quickened::UNSEEN) {
+                bool negate_number = un_expr.operator_type == TokenType::MINUS && isNumber(operand);
+                specialize(un_expr.quickened, negate_number ? Quickened::NEGATE_NUMBER : Quickened::GENERIC);
+            }
+            if (un_expr.quickened == Quickened::NEGATE_NUMBER) {
+                if (const double* number = std::get_if<double>(&operand->value)) {
+                    return makeValue(-*number);
+                }
+                despecialize(un_expr.quickened);
+            }
             return performUnaryOp(un_expr.operator_type, operand);
         }
         
@@ -386,299 +673,820 @@ Value Interpreter::evaluate(const Expression& expr) {
         }
         
         case NodeType::CALL_EXPR: {
-            const auto& call_expr = static_cast<const CallExpression&>(expr);
-            
-            std::vector<Value> arguments;
-            for (const auto& arg : call_expr.arguments) {
-                arguments.push_back(evaluate(*arg));
-            }
-            
-            // Check if this is a method call (obj.method())
-            Value self_object = nullptr;
-            if (call_expr.callee->type == NodeType::ATTRIBUTE_EXPR) {
-                const auto& attr_expr = static_cast<const AttributeExpression&>(*call_expr.callee);
-                Value object = evaluate(*attr_expr.object);
-                if (isClassInstance(object)) {
-                    self_object = object;
-                }
-            }
-            
-            Value callee = evaluate(*call_expr.callee);
-            
-            // Handle user-defined functions (including methods)
-            if (isFunction(callee)) {
-                auto function = getFunction(callee);
-                
-                // For method calls, prepend self to arguments
-                std::vector<Value> finalArguments = arguments;
-                if (self_object != nullptr) {
-                    finalArguments.insert(finalArguments.begin(), self_object);
-                }
-                
-                // Check argument count
-                if (finalArguments.size() != function->parameters.size()) {
-                    throw std::runtime_error("Expected " + std::to_string(function->parameters.size()) +
-                                           " arguments but got " + std::to_string(finalArguments.size()));
-                }
-                
-                // Create new environment for function execution
-                auto func_env = std::make_shared<Environment>(function->closure);
-                
-                // Bind parameters to arguments
-                for (size_t i = 0; i < function->parameters.size(); ++i) {
-                    func_env->define(function->parameters[i], finalArguments[i]);
-                }
-                
-                // Execute function body
-                std::shared_ptr<Environment> previous = environment;
-                environment = func_env;
-                
-                Value result = makeValue(nullptr);
-                try {
-                    for (const auto& stmt : function->body->statements) {
-                        execute(*stmt);
-                    }
-                } catch (const ReturnException& ret) {
-                    result = ret.value;
-                } catch (...) {
-                    environment = previous;
-                    throw;
-                }
-                
-                environment = previous;
-                return result;
-            }
-            
-            // Handle builtin functions
-            if (isString(callee)) {
-                std::string func_name = getString(callee);
-                if (func_name.substr(0, 8) == "builtin:") {
-                    std::string builtin_name = func_name.substr(8);
-                    // Try to get the builtin function from the global environment
-                    Value builtin_val = globals->get(builtin_name);
-                    if (isString(builtin_val)) {
-                        std::string builtin_str = getString(builtin_val);
-                        if (builtin_str == func_name) {
-                            // Handle built-in print function
-                            if (builtin_name == "print") {
-                                for (size_t i = 0; i < arguments.size(); ++i) {
-                                    if (i > 0) std::cout << " ";
-                                    std::cout << valueToString(arguments[i]);
-                                }
-                                std::cout << std::endl;
-                                return makeValue(nullptr);
-                            }
-                            // Handle built-in raise function
-                            else if (builtin_name == "raise") {
-                                if (arguments.empty()) {
-                                    throw RuntimeException("Exception", makeValue(nullptr), "");
-                                } else if (arguments.size() == 1) {
-                                    // raise("message") - throws a generic exception with message
-                                    if (isString(arguments[0])) {
-                                        throw RuntimeException("Exception", arguments[0], getString(arguments[0]));
-                                    } else {
-                                        throw RuntimeException("Exception", arguments[0], valueToString(arguments[0]));
-                                    }
-                                } else if (arguments.size() == 2) {
-                                    // raise("ExceptionType", "message") - throws specific exception type
-                                    if (!isString(arguments[0])) {
-                                        throw std::runtime_error("First argument to raise() must be exception type (string)");
-                                    }
-                                    std::string exc_type = getString(arguments[0]);
-                                    std::string message = isString(arguments[1]) ? getString(arguments[1]) : valueToString(arguments[1]);
-                                    throw RuntimeException(exc_type, arguments[1], message);
-                                } else {
-                                    throw std::runtime_error("raise() takes 0, 1, or 2 arguments");
-                                }
-                                
-                                return makeValue(nullptr); // Never reached
-                            }
-                            // Handle built-in len function
-                            else if (builtin_name == "len") {
-                                if (arguments.size() != 1) {
-                                    throw std::runtime_error("len() takes exactly one argument");
-                                }
-                                Value arg = arguments[0];
-                                if (isList(arg)) {
-                                    auto& list = getList(arg);
-                                    return makeValue(static_cast<double>(list.size()));
-                                } else if (isDict(arg)) {
-                                    auto& dict = getDict(arg);
-                                    return makeValue(static_cast<double>(dict.size()));
-                                } else if (isString(arg)) {
-                                    std::string str = getString(arg);
-                                    return makeValue(static_cast<double>(str.length()));
-                                } else {
-                                    throw std::runtime_error("object of type '" + getTypeName(arg) + "' has no len()");
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-            
-            // Handle class instantiation
-            if (isClass(callee)) {
-                auto cls = getClass(callee);
-                auto instance = std::make_shared<ClassInstance>(cls);
-                
-                // Call __init__ method if it exists
-                auto initIt = cls->methods.find("__init__");
-                if (initIt != cls->methods.end()) {
-                    auto initMethod = getFunction(initIt->second);
-                    
-                    // Check argument count (excluding self)
-                    if (arguments.size() + 1 != initMethod->parameters.size()) {
-                        throw std::runtime_error("__init__ expected " + std::to_string(initMethod->parameters.size() - 1) +
-                                               " arguments but got " + std::to_string(arguments.size()));
-                    }
-                    
-                    // Create new environment for method execution
-                    auto method_env = std::make_shared<Environment>(initMethod->closure);
-                    
-                    // Bind 'self' parameter
-                    method_env->define(initMethod->parameters[0], makeValue(instance));
-                    
-                    // Bind other parameters to arguments
-                    for (size_t i = 0; i < arguments.size(); ++i) {
-                        method_env->define(initMethod->parameters[i + 1], arguments[i]);
-                    }
-                    
-                    // Execute method body
-                    std::shared_ptr<Environment> previous = environment;
-                    environment = method_env;
-                    
-                    try {
-                        for (const auto& stmt : initMethod->body->statements) {
-                            execute(*stmt);
-                        }
-                    } catch (const ReturnException&) {
-                        // Ignore return value from __init__
-                    } catch (...) {
-                        environment = previous;
-                        throw;
-                    }
-                    
-                    environment = previous;
-                }
-                
-                return makeValue(instance);
-            }
-            
-            throw std::runtime_error("Can only call functions and classes");
+            return evaluateCallExpr(static_cast<const CallExpression&>(expr));
         }
         
+        case NodeType::SUPER_EXPR:
+            throw std::runtime_error("super() must be followed by an attribute");
+        
         default:
             throw std::runtime_error("Unknown expression type");
     }
 }
 
-void Interpreter::execute(const Statement& stmt) {
-    switch (stmt.type) {
-        case NodeType::EXPRESSION_STMT: {
-            const auto& expr_stmt = static_cast<const ExpressionStatement&>(stmt);
-            evaluate(*expr_stmt.expression);
-            break;
-        }
-        
-        case NodeType::ASSIGNMENT_STMT: {
-            const auto& assign_stmt = static_cast<const AssignmentStatement&>(stmt);
-            Value value = evaluate(*assign_stmt.value);
-            
-            // Try to assign to existing variable first, if that fails, define new one
-            try {
-                environment->assign(assign_stmt.identifier, value);
-            } catch (const std::runtime_error&) {
-                environment->define(assign_stmt.identifier, value);
-            }
-            break;
+Value Interpreter::evaluateCallExpr(const CallExpression& expr) {
+    // Arguments are pushed straight onto the value stack; the callee's frame
+    // is a window over them
+    size_t args_base = stack.size();
+    
+    try {
+        for (const auto& arg : expr.arguments) {
+            stack.push_back(evaluate(*arg));
         }
         
-        case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
-            const auto& attr_assign_stmt = static_cast<const AttributeAssignmentStatement&>(stmt);
-            Value object = evaluate(*attr_assign_stmt.object);
-            Value value = evaluate(*attr_assign_stmt.value);
-            
-            if (isClassInstance(object)) {
-                auto instance = getClassInstance(object);
-                instance->attributes[attr_assign_stmt.attribute] = value;
+        Value callee;
+        if (expr.callee->type == NodeType::ATTRIBUTE_EXPR) {
+            // Method call (obj.method()): the object becomes the first argument
+            const auto& attr_expr = static_cast<const AttributeExpression&>(*expr.callee);
+            Value object;
+            if (attr_expr.object->type == NodeType::SUPER_EXPR) {
+                callee = getSuperMethod(attr_expr.attribute, object);
             } else {
-                throw std::runtime_error("Can only assign attributes to class instances");
+                object = evaluate(*attr_expr.object);
+                callee = getAttribute(object, attr_expr.attribute);
             }
-            break;
+            if (isClassInstance(object) && isFunction(callee)) {
+                stack.insert(stack.begin() + args_base, object);
+            }
+        } else {
+            callee = evaluate(*expr.callee);
         }
         
-        case NodeType::IF_STMT: {
-            const auto& if_stmt = static_cast<const IfStatement&>(stmt);
-            Value condition = evaluate(*if_stmt.condition);
-            
-            if (isTruthy(condition)) {
-                executeBlock(if_stmt.then_branch->statements, environment);
-            } else if (if_stmt.else_branch) {
-                if (if_stmt.else_branch->type == NodeType::BLOCK_STMT) {
-                    const auto& else_block = static_cast<const BlockStatement&>(*if_stmt.else_branch);
-                    executeBlock(else_block.statements, environment);
-                } else {
-                    execute(*if_stmt.else_branch);
+        Value result = callValue(callee, args_base);
+        stack.resize(args_base);
+        return result;
+    } catch (...) {
+        stack.resize(args_base);
+        throw;
+    }
+}
+
+double modulo(double left, double right) {
+    if (right == 0) throw std::runtime_error("Modulo by zero");
+    double result = std::fmod(left, right);
+    if (result != 0 && (result < 0) != (right < 0)) {
+        result += right;
+    }
+    return result;
+}
+
+double Interpreter::evaluateNumber(const Expression& expr) {
+    if (expr.unboxed) {
+        switch (expr.type) {
+            case NodeType::NUMBER_EXPR:
+                return static_cast<const NumberExpression&>(expr).value;
+                
+            case NodeType::IDENTIFIER_EXPR:
+                return numbers[number_base + static_cast<const IdentifierExpression&>(expr).number_slot];
+                
+            case NodeType::UNARY_EXPR:
+                return -evaluateNumber(*static_cast<const UnaryExpression&>(expr).operand);
+                
+            case NodeType::BINARY_EXPR: {
+                const auto& bin_expr = static_cast<const BinaryExpression&>(expr);
+                double left = evaluateNumber(*bin_expr.left);
+                double right = evaluateNumber(*bin_expr.right);
+                switch (bin_expr.operator_type) {
+                    case TokenType::PLUS: return left + right;
+                    case TokenType::MINUS: return left - right;
+                    case TokenType::MULTIPLY: return left * right;
+                    case TokenType::DIVIDE:
+                        if (right == 0) throw std::runtime_error("Division by zero");
+                        return left / right;
+                    case TokenType::MODULO: return modulo(left, right);
+                    default: break;
                 }
+                break;
             }
-            break;
-        }
-        
-        case NodeType::WHILE_STMT: {
-            const auto& while_stmt = static_cast<const WhileStatement&>(stmt);
             
-            while (isTruthy(evaluate(*while_stmt.condition))) {
-                executeBlock(while_stmt.body->statements, environment);
-            }
-            break;
+            default:
+                break;
         }
-        
-        case NodeType::FOR_STMT: {
-            const auto& for_stmt = static_cast<const ForStatement&>(stmt);
-            Value iterable = evaluate(*for_stmt.iterable);
-            
-            if (isList(iterable)) {
-                // Iterate over list
-                const auto& list = getList(iterable);
-                for (const auto& item : list) {
-                    environment->define(for_stmt.variable, item);
-                    executeBlock(for_stmt.body->statements, environment);
-                }
-            } else if (isDict(iterable)) {
-                // Iterate over dictionary keys
-                const auto& dict = getDict(iterable);
-                for (const auto& pair : dict) {
-                    environment->define(for_stmt.variable, makeValue(pair.first));
-                    executeBlock(for_stmt.body->statements, environment);
-                }
-            } else {
-                throw std::runtime_error("Object is not iterable");
-            }
+    }
+    
+    // Proven to be a number, but computed from boxed values
+    return getNumber(evaluate(expr));
+}
+
+// Both operands are unboxed: arithmetic and comparisons work on the doubles;
+// null for other operators
+Value Interpreter::evaluateUnboxedBinary(const BinaryExpression& expr) {
+    if (expr.unboxed) {
+        return makeValue(evaluateNumber(expr));
+    }
+    
+    switch (expr.operator_type) {
+        case TokenType::EQUAL:
+        case TokenType::NOT_EQUAL:
+        case TokenType::LESS:
+        case TokenType::LESS_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::GREATER_EQUAL:
             break;
-        }
+        default:
+            return nullptr;
+    }
+    double left = evaluateNumber(*expr.left);
+    double right = evaluateNumber(*expr.right);
+    switch (expr.operator_type) {
+        case TokenType::EQUAL: return makeValue(left == right);
+        case TokenType::NOT_EQUAL: return makeValue(left != right);
+        case TokenType::LESS: return makeValue(left < right);
+        case TokenType::LESS_EQUAL: return makeValue(left <= right);
+        case TokenType::GREATER: return makeValue(left > right);
+        default: return makeValue(left >= right);
+    }
+}
+
+Value Interpreter::callValue(const Value& callee, size_t args_base) {
+    // Handle user-defined functions (including methods)
+    if (isFunction(callee)) {
+        return callFunction(getFunction(callee), args_base);
+    }
+    
+    // Handle builtin functions: the arguments are read where they were pushed
+    if (isBuiltin(callee)) {
+        return getBuiltin(callee).function(Arguments(stack, args_base));
+    }
+    
+    // Handle class instantiation
+    if (isClass(callee)) {
+        auto cls = getClass(callee);
+        auto instance = std::make_shared<ClassInstance>(cls);
+        collector.track(instance, GCKind::INSTANCE);
+        Value instance_value = makeValue(instance);
         
-        case NodeType::RETURN_STMT: {
-            const auto& return_stmt = static_cast<const ReturnStatement&>(stmt);
-            Value value = nullptr;
-            if (return_stmt.value) {
-                value = evaluate(*return_stmt.value);
+        // Call __init__ method if it exists
+        auto initIt = cls->methods.find(INIT_METHOD);
+        if (initIt != cls->methods.end()) {
+            auto initMethod = getFunction(initIt->second);
+            
+            // Check argument count (excluding self)
+            size_t argc = stack.size() - args_base;
+            if (argc + 1 != initMethod->parameters.size()) {
+                throw std::runtime_error("__init__ expected " + std::to_string(initMethod->parameters.size() - 1) +
+                                       " arguments but got " + std::to_string(argc));
             }
-            throw ReturnException(value);
+            
+            // Bind 'self' in front of the arguments; the return value of __init__ is ignored
+            stack.insert(stack.begin() + args_base, instance_value);
+            callFunction(initMethod, args_base);
         }
         
-        case NodeType::FUNCTION_DEF_STMT: {
-            const auto& func_stmt = static_cast<const FunctionDefStatement&>(stmt);
-            
-            // Create function object with closure
+        return instance_value;
+    }
+    
+    throw std::runtime_error("Can only call functions and classes");
+}
+
+Value Interpreter::callFunction(const std::shared_ptr<Function>& function, size_t args_base) {
+    // Check argument count
+    size_t argc = stack.size() - args_base;
+    if (argc != function->parameters.size()) {
+        throw std::runtime_error("Expected " + std::to_string(function->parameters.size()) +
+                               " arguments but got " + std::to_string(argc));
+    }
+    
+    if (function->deferred) {
+        Parser::parseDeferredBody(*function->deferred);
+        function->body = function->deferred->body.get();
+        function->uses_frame_slots = function->deferred->uses_frame_slots;
+        function->number_locals = function->deferred->number_locals;
+        function->is_generator = function->deferred->is_generator;
+        function->deferred = nullptr;
+    }
+    
+    if (function->is_generator) {
+        return makeGenerator(function, args_base);
+    }
+    
+    if (jit) {
+        Value result;
+        if (callCompiled(*function, args_base, result)) {
+            return result;
+        }
+    }
+    
+    std::shared_ptr<Environment> previous = environment;
+    bool previous_pending = scope_pending;
+    size_t previous_base = frame_base;
+    size_t previous_number_base = number_base;
+    const Function* previous_function = current_function;
+    current_function = function.get();
+    call_depth++;
+    
+    // Definitions made during the call belong to the function's source; the
+    // pointers only differ when calling across modules
+    std::shared_ptr<const Program> previous_source;
+    bool switch_source = function->source != current_source;
+    if (switch_source) {
+        previous_source = std::move(current_source);
+        current_source = function->source;
+    }
+    
+    if (function->uses_frame_slots) {
+        // Parameters stay on the value stack; locals get a scope only if defined
+        frame_base = args_base;
+        environment = function->closure;
+        scope_pending = true;
+    } else {
+        // The frame may be captured, so bind parameters in a heap environment
+        auto func_env = makeEnvironment(function->closure);
+        for (size_t i = 0; i < argc; ++i) {
+            func_env->define(function->parameters[i], stack[args_base + i]);
+        }
+        environment = func_env;
+        scope_pending = false;
+    }
+    
+    number_base = NO_NUMBER_FRAME;
+    if (!function->number_locals.empty() && numberLocalsAreFree(*function)) {
+        number_base = numbers.size();
+        numbers.resize(number_base + function->number_locals.size());
+    }
+    
+    Value result;
+    try {
+        if (executeBody(*function) == ExecStatus::RETURN) {
+            result = std::move(return_value);
+        }
+    } catch (...) {
+        if (number_base != NO_NUMBER_FRAME) numbers.resize(number_base);
+        environment = previous;
+        scope_pending = previous_pending;
+        frame_base = previous_base;
+        number_base = previous_number_base;
+        current_function = previous_function;
+        call_depth--;
+        if (switch_source) current_source = std::move(previous_source);
+        throw;
+    }
+    
+    if (number_base != NO_NUMBER_FRAME) numbers.resize(number_base);
+    environment = previous;
+    scope_pending = previous_pending;
+    frame_base = previous_base;
+    number_base = previous_number_base;
+    current_function = previous_function;
+    call_depth--;
+    if (switch_source) current_source = std::move(previous_source);
+    return result ? result : makeValue(nullptr);
+}
+
+ExecStatus Interpreter::executeBody(const Function& function) {
+    if (function.native && (function.number_locals.empty() || number_base != NO_NUMBER_FRAME)) {
+        return function.native(*native_program);
+    }
+    return executeStatements(function.body->statements);
+}
+
+namespace {
+
+// Thrown at the yield a dropped generator is suspended at, to unwind its
+// stack; deliberately not a std::exception, so except clauses ignore it
+struct GeneratorExit {};
+
+} // namespace
+
+Generator::Generator(std::shared_ptr<Function> f, std::shared_ptr<Environment> env, Interpreter* owner)
+    : function(std::move(f)), environment(std::move(env)), interpreter(owner) {}
+
+Generator::~Generator() {
+    if (coroutine && coroutine->started()) {
+        interpreter->suspended_generators.erase(this);
+        interpreter->abandoned_generators.push_back(std::move(coroutine));
+    }
+}
+
+Value Interpreter::makeGenerator(const std::shared_ptr<Function>& function, size_t args_base) {
+    // Generator functions never use frame slots (see Resolver): the frame
+    // has to outlive this call
+    auto frame = makeEnvironment(function->closure);
+    for (size_t i = 0; i < function->parameters.size(); ++i) {
+        frame->define(function->parameters[i], stack[args_base + i]);
+    }
+    auto generator = std::make_shared<Generator>(function, frame, this);
+    collector.track(generator, GCKind::GENERATOR);
+    
+    Generator* self = generator.get();
+    generator->coroutine = std::make_unique<Coroutine>([this, self]() {
+        try {
+            executeBody(*self->function);
+        } catch (const GeneratorExit&) {
+            return; // the generator may already be gone
+        }
+        // return ends the generator; a value it returns is dropped
+        return_value.reset();
+    });
+    return makeValue(generator);
+}
+
+bool Interpreter::resumeGenerator(Generator& generator, Value& item) {
+    if (!generator.coroutine) {
+        return false;
+    }
+    if (generator.running) {
+        throw std::runtime_error("generator already executing");
+    }
+    
+    // The body runs on its own stack but in this interpreter's registers,
+    // which are switched over as for a call
+    std::shared_ptr<Environment> previous = environment;
+    bool previous_pending = scope_pending;
+    size_t previous_base = frame_base;
+    size_t previous_number_base = number_base;
+    const Function* previous_function = current_function;
+    std::shared_ptr<const Program> previous_source = current_source;
+    Generator* previous_generator = current_generator;
+    
+    environment = generator.environment;
+    scope_pending = generator.scope_pending;
+    frame_base = stack.size();
+    number_base = NO_NUMBER_FRAME;
+    current_function = generator.function.get();
+    current_source = generator.function->source;
+    current_generator = &generator;
+    generator.running = true;
+    suspended_generators.erase(&generator);
+    
+    try {
+        generator.coroutine->resume();
+    } catch (...) {
+        // An exception raised by the body finishes the generator
+        generator.coroutine.reset();
+        generator.environment.reset();
+        generator.running = false;
+        environment = previous;
+        scope_pending = previous_pending;
+        frame_base = previous_base;
+        number_base = previous_number_base;
+        current_function = previous_function;
+        current_source = std::move(previous_source);
+        current_generator = previous_generator;
+        throw;
+    }
+    
+    generator.running = false;
+    environment = previous;
+    scope_pending = previous_pending;
+    frame_base = previous_base;
+    number_base = previous_number_base;
+    current_function = previous_function;
+    current_source = std::move(previous_source);
+    current_generator = previous_generator;
+    
+    if (generator.coroutine->finished()) {
+        // Drop the frame and the stack right away
+        generator.coroutine.reset();
+        generator.environment.reset();
+        return false;
+    }
+    suspended_generators.insert(&generator);
+    item = std::move(generator.yielded);
+    return true;
+}
+
+void Interpreter::yieldValue(Value value) {
+    // Only the generator function's own body yields, not code it calls
+    if (!current_generator || current_function != current_generator->function.get()) {
+        throw std::runtime_error("'yield' outside a generator function");
+    }
+    Generator& generator = *current_generator;
+    generator.yielded = std::move(value);
+    generator.environment = environment;
+    generator.scope_pending = scope_pending;
+    
+    Coroutine::suspend();
+    
+    // resumeGenerator() has set up the registers again, unless the generator
+    // was dropped and this is closeGenerators() unwinding it
+    if (closing_generators) {
+        throw GeneratorExit();
+    }
+}
+
+void Interpreter::closeGenerators() {
+    // Unwinding runs the bodies' cleanup handlers, which reset the registers
+    // to what they had saved
+    std::shared_ptr<Environment> previous = environment;
+    bool previous_pending = scope_pending;
+    size_t previous_base = frame_base;
+    size_t previous_number_base = number_base;
+    const Function* previous_function = current_function;
+    std::shared_ptr<const Program> previous_source = current_source;
+    Generator* previous_generator = current_generator;
+    
+    closing_generators = true;
+    current_generator = nullptr;
+    while (!abandoned_generators.empty()) {
+        // Unwinding may drop further generators onto the list
+        std::unique_ptr<Coroutine> coroutine = std::move(abandoned_generators.back());
+        abandoned_generators.pop_back();
+        coroutine->resume();
+    }
+    closing_generators = false;
+    
+    environment = previous;
+    scope_pending = previous_pending;
+    frame_base = previous_base;
+    number_base = previous_number_base;
+    current_function = previous_function;
+    current_source = std::move(previous_source);
+    current_generator = previous_generator;
+}
+
+bool Interpreter::numberLocalsAreFree(const Function& function) {
+    for (const auto& name : function.number_locals) {
+        if (function.closure->lookup(name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Interpreter::callCompiled(Function& function, size_t args_base, Value& result) {
+    if (!function.compiled) {
+        if (function.jit_rejected || ++function.calls < jit::CALL_THRESHOLD) {
+            return false;
+        }
+        function.compiled = jit->compile(function.name, function.parameters, *function.body);
+        if (!function.compiled) {
+            function.jit_rejected = true;
+            return false;
+        }
+    }
+    jit::CompiledFunction& code = *function.compiled;
+    if (code.deopts >= jit::MAX_DEOPTS) {
+        return false;
+    }
+    
+    // Guards: the code was compiled for numbers, locals of its own and
+    // self-calls that reach this function
+    double args[jit::MAX_PARAMS];
+    size_t argc = function.parameters.size();
+    for (size_t i = 0; i < argc; ++i) {
+        const Value& arg = stack[args_base + i];
+        if (!isNumber(arg)) {
+            jit->deoptimized(code, "argument '" + function.parameters[i] + "' is not a number");
+            return false;
+        }
+        args[i] = getNumber(arg);
+    }
+    for (const auto& local : code.locals) {
+        if (function.closure->lookup(local)) {
+            jit->deoptimized(code, "'" + local + "' is bound outside the function");
+            return false;
+        }
+    }
+    if (code.calls_self) {
+        Value self = function.closure->tryGet(function.name);
+        if (!self || !isFunction(self) || getFunction(self).get() != &function) {
+            jit->deoptimized(code, "'" + function.name + "' no longer refers to the function");
+            return false;
+        }
+    }
+    
+    double number;
+    int exit = code.entry(args, &number);
+    if (exit != jit::OK) {
+        // The code has no side effects, so the interpreter just runs the call again
+        jit->deoptimized(code, jit::Compiler::exitReason(exit));
+        return false;
+    }
+    result = makeValue(number);
+    return true;
+}
+
+// Innermost left operand of a chain of +, as in s + a + b; null if value is not a +
+static const Expression* concatenationBase(const Expression& value) {
+    const Expression* node = &value;
+    while (node->type == NodeType::BINARY_EXPR &&
+           static_cast<const BinaryExpression*>(node)->operator_type == TokenType::PLUS) {
+        node = static_cast<const BinaryExpression*>(node)->left.get();
+    }
+    return node != &value ? node : nullptr;
+}
+
+// The value of name = name + piece [+ piece ...], else null
+static const BinaryExpression* appendToName(const AssignmentStatement& stmt) {
+    const Expression* base = concatenationBase(*stmt.value);
+    if (!base || base->type != NodeType::IDENTIFIER_EXPR) {
+        return nullptr;
+    }
+    const auto& target = static_cast<const IdentifierExpression&>(*base);
+    if (target.name != stmt.identifier || target.slot != stmt.slot || target.number_slot >= 0) {
+        return nullptr;
+    }
+    return static_cast<const BinaryExpression*>(stmt.value.get());
+}
+
+// The value of name.attribute = name.attribute + piece [+ piece ...], else null
+static const BinaryExpression* appendToAttribute(const AttributeAssignmentStatement& stmt) {
+    const Expression* base = concatenationBase(*stmt.value);
+    if (!base || base->type != NodeType::ATTRIBUTE_EXPR || stmt.object->type != NodeType::IDENTIFIER_EXPR) {
+        return nullptr;
+    }
+    const auto& target = static_cast<const AttributeExpression&>(*base);
+    if (target.attribute != stmt.attribute || target.object->type != NodeType::IDENTIFIER_EXPR) {
+        return nullptr;
+    }
+    const auto& object = static_cast<const IdentifierExpression&>(*stmt.object);
+    const auto& target_object = static_cast<const IdentifierExpression&>(*target.object);
+    if (target_object.name != object.name || target_object.slot != object.slot) {
+        return nullptr;
+    }
+    return static_cast<const BinaryExpression*>(stmt.value.get());
+}
+
+// Building a string in a loop (s = s + piece) is linear rather than
+// quadratic: strings are immutable to the program, so one referenced only by
+// the binding being assigned can grow where it is. The pieces are all
+// evaluated before anything is appended, and locate() is called again after
+// them, as they may have rebound or shared the string.
+template <typename Locate>
+Value Interpreter::concatenateInPlace(const BinaryExpression& concat, Locate locate) {
+    Value* binding = locate();
+    if (!binding || !*binding || !isString(*binding)) {
+        return evaluate(concat);
+    }
+    
+    // The + nodes from the innermost out
+    std::vector<const BinaryExpression*> chain;
+    for (const Expression* node = &concat; concatenationBase(*node); ) {
+        chain.push_back(static_cast<const BinaryExpression*>(node));
+        node = chain.back()->left.get();
+    }
+    std::reverse(chain.begin(), chain.end());
+    
+    Value left = *binding;
+    std::vector<Value> pieces;
+    pieces.reserve(chain.size());
+    for (size_t i = 0; i < chain.size(); ++i) {
+        Value piece = evaluate(*chain[i]->right);
+        if (!isString(piece)) {
+            // Not all strings: finish the expression as evaluate() would
+            Value result = left;
+            for (size_t j = 0; j < i; ++j) {
+                result = applyBinary(*chain[j], result, pieces[j]);
+            }
+            result = applyBinary(*chain[i], result, piece);
+            for (size_t j = i + 1; j < chain.size(); ++j) {
+                result = applyBinary(*chain[j], result, evaluate(*chain[j]->right));
+            }
+            return result;
+        }
+        pieces.push_back(std::move(piece));
+    }
+    
+    binding = locate();
+    if (binding && binding->get() == left.get() && left.use_count() == 2) {
+        left.reset();
+        std::string& text = std::get<std::string>((*binding)->value);
+        for (const auto& piece : pieces) {
+            text += getString(piece);
+        }
+        return nullptr;
+    }
+    Value result = left;
+    for (size_t i = 0; i < chain.size(); ++i) {
+        result = applyBinary(*chain[i], result, pieces[i]);
+    }
+    return result;
+}
+
+// Augmented assignment to a name or attribute. A list is extended in place
+// (every alias sees the new items, as in Python) and a string appended to
+// when nothing else refers to it. When the operand is a literal or a name,
+// evaluating it cannot move the binding, so the binding found up front is
+// updated directly instead of being looked up again to assign it.
+template <typename Locate>
+Value Interpreter::updateInPlace(const BinaryExpression& update, Locate locate) {
+    Value* binding = locate();
+    if (!binding || !*binding) {
+        return evaluate(update);
+    }
+    if (update.operator_type == TokenType::PLUS) {
+        if (isString(*binding)) {
+            return concatenateInPlace(update, locate);
+        }
+        if (isList(*binding)) {
+            Value list = *binding;
+            extendList(list, evaluate(*update.right));
+            return list;
+        }
+    }
+    
+    switch (update.right->type) {
+        case NodeType::NUMBER_EXPR:
+        case NodeType::STRING_EXPR:
+        case NodeType::BOOLEAN_EXPR:
+        case NodeType::NONE_EXPR:
+        case NodeType::IDENTIFIER_EXPR:
+            *binding = applyBinary(update, *binding, evaluate(*update.right));
+            return nullptr;
+        default: {
+            Value left = *binding;
+            return applyBinary(update, left, evaluate(*update.right));
+        }
+    }
+}
+
+void Interpreter::extendList(const Value& list, const Value& items) {
+    if (isList(items)) {
+        ListType& target = getList(list);
+        if (items.get() == list.get()) {
+            // lst += lst: copy first, inserting from itself would read moved storage
+            ListType copy = target;
+            target.insert(target.end(), copy.begin(), copy.end());
+        } else {
+            const ListType& source = getList(items);
+            target.insert(target.end(), source.begin(), source.end());
+        }
+        return;
+    }
+    if (isNumber(items) || isString(items) || isBool(items) || isNone(items)) {
+        throw std::runtime_error("Invalid operands for +=: can only extend a list with an iterable");
+    }
+    auto iterator = makeIterator(items);
+    Value item;
+    while (iterator->next(item)) {
+        getList(list).push_back(item);
+    }
+}
+
+ExecStatus Interpreter::execute(const Statement& stmt) {
+    // Statement boundaries are safe points for cycle collection
+    if (collector.collectionDue()) {
+        collector.collectScheduled();
+    }
+    if (!abandoned_generators.empty()) {
+        closeGenerators();
+    }
+    
+    switch (stmt.type) {
+        case NodeType::EXPRESSION_STMT: {
+            const auto& expr_stmt = static_cast<const ExpressionStatement&>(stmt);
+            if (current_function == stop_iteration_function && current_function &&
+                call_depth == stop_iteration_depth && isStopIterationRaise(*expr_stmt.expression)) {
+                // A loop's __next__ is done: hand back the marker, no unwinding
+                return_value = stop_iteration;
+                return ExecStatus::RETURN;
+            }
+            evaluate(*expr_stmt.expression);
+            break;
+        }
+        
+        case NodeType::ASSIGNMENT_STMT: {
+            const auto& assign_stmt = static_cast<const AssignmentStatement&>(stmt);
+            if (assign_stmt.number_slot >= 0 && number_base != NO_NUMBER_FRAME) {
+                numbers[number_base + assign_stmt.number_slot] = evaluateNumber(*assign_stmt.value);
+                break;
+            }
+            auto binding = [&]() -> Value* {
+                return assign_stmt.slot >= 0 ? &stack[frame_base + assign_stmt.slot]
+                                             : environment->lookup(assign_stmt.identifier);
+            };
+            Value value;
+            if (assign_stmt.augmented) {
+                value = updateInPlace(static_cast<const BinaryExpression&>(*assign_stmt.value), binding);
+                if (!value) {
+                    break;
+                }
+            } else if (const BinaryExpression* concat = appendToName(assign_stmt)) {
+                value = concatenateInPlace(*concat, binding);
+                if (!value) {
+                    break;
+                }
+            } else {
+                value = evaluate(*assign_stmt.value);
+            }
+            
+            if (assign_stmt.slot >= 0) {
+                stack[frame_base + assign_stmt.slot] = std::move(value);
+                break;
+            }
+            
+            // Assign to an existing variable if there is one, otherwise define a new one
+            if (!environment->tryAssign(assign_stmt.identifier, value)) {
+                defineVariable(assign_stmt.identifier, value);
+            }
+            break;
+        }
+        
+        case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+            const auto& attr_assign_stmt = static_cast<const AttributeAssignmentStatement&>(stmt);
+            Value object = evaluate(*attr_assign_stmt.object);
+            Value value;
+            if (isClassInstance(object)) {
+                auto& attributes = getClassInstance(object)->attributes;
+                auto binding = [&]() -> Value* {
+                    auto it = attributes.find(attr_assign_stmt.attribute);
+                    return it != attributes.end() ? &it->second : nullptr;
+                };
+                if (attr_assign_stmt.augmented) {
+                    value = updateInPlace(static_cast<const BinaryExpression&>(*attr_assign_stmt.value), binding);
+                } else if (const BinaryExpression* concat = appendToAttribute(attr_assign_stmt)) {
+                    value = concatenateInPlace(*concat, binding);
+                } else {
+                    value = evaluate(*attr_assign_stmt.value);
+                }
+                if (!value) {
+                    break;
+                }
+            } else {
+                value = evaluate(*attr_assign_stmt.value);
+            }
+            
+            if (isClassInstance(object)) {
+                auto instance = getClassInstance(object);
+                instance->attributes[attr_assign_stmt.attribute] = value;
+            } else {
+                throw std::runtime_error("Can only assign attributes to class instances");
+            }
+            break;
+        }
+        
+        case NodeType::INDEX_ASSIGNMENT_STMT:
+            executeIndexAssignment(static_cast<const IndexAssignmentStatement&>(stmt));
+            break;
+        
+        case NodeType::IF_STMT: {
+            const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+            Value condition = evaluate(*if_stmt.condition);
+            
+            if (isTruthy(condition)) {
+                return executeBlock(if_stmt.then_branch->statements, environment);
+            } else if (if_stmt.else_branch) {
+                if (if_stmt.else_branch->type == NodeType::BLOCK_STMT) {
+                    const auto& else_block = static_cast<const BlockStatement&>(*if_stmt.else_branch);
+                    return executeBlock(else_block.statements, environment);
+                } else {
+                    return execute(*if_stmt.else_branch);
+                }
+            }
+            break;
+        }
+        
+        case NodeType::WHILE_STMT: {
+            const auto& while_stmt = static_cast<const WhileStatement&>(stmt);
+            
+            while (isTruthy(evaluate(*while_stmt.condition))) {
+                if (executeBlock(while_stmt.body->statements, environment) == ExecStatus::RETURN) {
+                    return ExecStatus::RETURN;
+                }
+            }
+            break;
+        }
+        
+        case NodeType::FOR_STMT: {
+            return executeFor(static_cast<const ForStatement&>(stmt));
+        }
+        
+        case NodeType::YIELD_STMT: {
+            const auto& yield_stmt = static_cast<const YieldStatement&>(stmt);
+            yieldValue(yield_stmt.value ? evaluate(*yield_stmt.value) : makeValue(nullptr));
+            break;
+        }
+        
+        case NodeType::RETURN_STMT: {
+            const auto& return_stmt = static_cast<const ReturnStatement&>(stmt);
+            return_value = return_stmt.value ? evaluate(*return_stmt.value) : makeValue(nullptr);
+            return ExecStatus::RETURN;
+        }
+        
+        case NodeType::FUNCTION_DEF_STMT: {
+            const auto& func_stmt = static_cast<const FunctionDefStatement&>(stmt);
+            
+            // The function is bound in the scope it is defined in
+            Environment& scope = currentScope();
+            
+            // Create function object with closure
             auto function = std::make_shared<Function>(
                 func_stmt.parameters,
                 func_stmt.body.get(),
-                environment
+                captureClosure(func_stmt)
             );
+            function->name = func_stmt.name;
+            function->source = current_source;
+            function->uses_frame_slots = func_stmt.uses_frame_slots;
+            function->number_locals = func_stmt.number_locals;
+            function->is_generator = func_stmt.is_generator;
+            if (func_stmt.isDeferred()) {
+                function->deferred = &func_stmt;
+            }
+            if (!native_bodies.empty()) {
+                auto native = native_bodies.find(&func_stmt);
+                if (native != native_bodies.end()) {
+                    function->native = native->second;
+                }
+            }
+            if (options.type_report) {
+                reportTypes(func_stmt);
+            }
+            collector.track(function, GCKind::FUNCTION);
             
             // Define the function in the current environment
-            environment->define(func_stmt.name, makeValue(function));
+            scope.define(func_stmt.name, makeValue(function));
             break;
         }
         
@@ -697,38 +1505,351 @@ void Interpreter::execute(const Statement& stmt) {
             break;
         }
         
-        case NodeType::BLOCK_STMT: {
-            const auto& block_stmt = static_cast<const BlockStatement&>(stmt);
-            executeBlock(block_stmt.statements, environment);
-            break;
+        case NodeType::BLOCK_STMT: {
+            const auto& block_stmt = static_cast<const BlockStatement&>(stmt);
+            return executeBlock(block_stmt.statements, environment);
+        }
+        
+        case NodeType::TRY_STMT: {
+            return executeTry(static_cast<const TryStatement&>(stmt));
+        }
+        
+        default:
+            throw std::runtime_error("Unknown statement type");
+    }
+    
+    return ExecStatus::NORMAL;
+}
+
+// Instance attribute or class method; null if there is neither
+static Value findMethod(const ClassInstance& instance, Symbol name) {
+    auto attribute = instance.attributes.find(name);
+    if (attribute != instance.attributes.end()) {
+        return attribute->second;
+    }
+    auto method = instance.classRef->methods.find(name);
+    return method != instance.classRef->methods.end() ? method->second : nullptr;
+}
+
+namespace {
+
+// Indexes the list on every step, so it may grow while the loop runs
+class ListIterator : public Iterator {
+private:
+    Value list;
+    size_t index = 0;
+
+public:
+    explicit ListIterator(Value list) : list(std::move(list)) {}
+    
+    bool next(Value& item) override {
+        const auto& items = getList(list);
+        if (index >= items.size()) {
+            return false;
+        }
+        item = items[index++];
+        return true;
+    }
+};
+
+// Iterates over the keys; map iterators stay valid as keys are added
+class DictIterator : public Iterator {
+private:
+    Value dict;
+    DictType::const_iterator position;
+
+public:
+    explicit DictIterator(Value dict) : dict(std::move(dict)), position(getDict(this->dict).begin()) {}
+    
+    bool next(Value& item) override {
+        if (position == getDict(dict).end()) {
+            return false;
+        }
+        item = makeValue(position->first);
+        ++position;
+        return true;
+    }
+};
+
+class GeneratorIterator : public Iterator {
+private:
+    Interpreter& interpreter;
+    Value generator;
+
+public:
+    GeneratorIterator(Interpreter& interpreter, Value generator)
+        : interpreter(interpreter), generator(std::move(generator)) {}
+    
+    bool next(Value& item) override {
+        return interpreter.resumeGenerator(*getGenerator(generator), item);
+    }
+};
+
+// __next__ was looked up once, when the loop started
+class InstanceIterator : public Iterator {
+private:
+    Interpreter& interpreter;
+    Value iterator;
+    std::shared_ptr<Function> next_method;
+
+public:
+    InstanceIterator(Interpreter& interpreter, Value iterator, std::shared_ptr<Function> next_method)
+        : interpreter(interpreter), iterator(std::move(iterator)), next_method(std::move(next_method)) {}
+    
+    bool next(Value& item) override {
+        return interpreter.callNext(iterator, next_method, item);
+    }
+};
+
+class RangeIterator : public Iterator {
+private:
+    Range range;
+    double index = 0;
+
+public:
+    explicit RangeIterator(const Range& range) : range(range) {}
+    
+    bool next(Value& item) override {
+        if (index >= range.length()) {
+            return false;
+        }
+        item = makeValue(range.at(index++));
+        return true;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<Iterator> Interpreter::makeIterator(const Value& iterable) {
+    if (isList(iterable)) {
+        return std::make_unique<ListIterator>(iterable);
+    } else if (isDict(iterable)) {
+        return std::make_unique<DictIterator>(iterable);
+    } else if (isRange(iterable)) {
+        return std::make_unique<RangeIterator>(getRange(iterable));
+    } else if (isGenerator(iterable)) {
+        return std::make_unique<GeneratorIterator>(*this, iterable);
+    } else if (isClassInstance(iterable)) {
+        // iter = obj.__iter__(), called once per loop
+        auto instance = getClassInstance(iterable);
+        Value iter_method = findMethod(*instance, ITER_METHOD);
+        if (!iter_method || !isFunction(iter_method)) {
+            throw std::runtime_error("'" + instance->classRef->name + "' object is not iterable");
+        }
+        size_t args_base = stack.size();
+        stack.push_back(iterable);
+        Value iterator;
+        try {
+            iterator = callFunction(getFunction(iter_method), args_base);
+        } catch (...) {
+            stack.resize(args_base);
+            throw;
+        }
+        stack.resize(args_base);
+        
+        if (!isClassInstance(iterator)) {
+            // __iter__ may also return a list, a generator, ...
+            return makeIterator(iterator);
         }
-        
-        case NodeType::TRY_STMT: {
-            executeTry(static_cast<const TryStatement&>(stmt));
-            break;
+        auto iterator_instance = getClassInstance(iterator);
+        Value next_method = findMethod(*iterator_instance, NEXT_METHOD);
+        if (!next_method || !isFunction(next_method)) {
+            throw std::runtime_error("'" + iterator_instance->classRef->name + "' object has no __next__ method");
+        }
+        return std::make_unique<InstanceIterator>(*this, iterator, getFunction(next_method));
+    }
+    throw std::runtime_error("Object is not iterable");
+}
+
+bool Interpreter::callNext(const Value& iterator, const std::shared_ptr<Function>& next_method, Value& item) {
+    size_t args_base = stack.size();
+    stack.push_back(iterator);
+    const Function* previous_stop = stop_iteration_function;
+    size_t previous_depth = stop_iteration_depth;
+    stop_iteration_function = next_method.get();
+    stop_iteration_depth = call_depth + 1;
+    try {
+        item = callFunction(next_method, args_base);
+    } catch (const RuntimeException& e) {
+        // Raised somewhere the marker could not be returned from
+        stack.resize(args_base);
+        stop_iteration_function = previous_stop;
+        stop_iteration_depth = previous_depth;
+        if (e.exception_type == "StopIteration") {
+            return false;
+        }
+        throw;
+    } catch (...) {
+        stack.resize(args_base);
+        stop_iteration_function = previous_stop;
+        stop_iteration_depth = previous_depth;
+        throw;
+    }
+    stack.resize(args_base);
+    stop_iteration_function = previous_stop;
+    stop_iteration_depth = previous_depth;
+    return item != stop_iteration;
+}
+
+// raise("StopIteration"[, message]) calling the built-in raise
+bool Interpreter::isStopIterationRaise(const Expression& expr) {
+    if (expr.type != NodeType::CALL_EXPR) {
+        return false;
+    }
+    const auto& call = static_cast<const CallExpression&>(expr);
+    if (call.callee->type != NodeType::IDENTIFIER_EXPR || call.arguments.empty() || call.arguments.size() > 2 ||
+        static_cast<const IdentifierExpression&>(*call.callee).name != RAISE_BUILTIN ||
+        call.arguments[0]->type != NodeType::STRING_EXPR ||
+        static_cast<const StringExpression&>(*call.arguments[0]).value != "StopIteration") {
+        return false;
+    }
+    Value* raise = environment->lookup(RAISE_BUILTIN);
+    return raise && *raise && isBuiltin(*raise) && getBuiltin(*raise).name == RAISE_BUILTIN;
+}
+
+ExecStatus Interpreter::executeFor(const ForStatement& stmt) {
+    Value iterable = evaluate(*stmt.iterable);
+    
+    if (isRange(iterable)) {
+        // Counted loop: each number is computed from the counter, so a loop
+        // of any length needs no storage and no iterator
+        const Range range = getRange(iterable);
+        const double count = range.length();
+        for (double i = 0; i < count; ++i) {
+            if (executeForBody(stmt, makeValue(range.at(i))) == ExecStatus::RETURN) {
+                return ExecStatus::RETURN;
+            }
+        }
+        return ExecStatus::NORMAL;
+    }
+    
+    auto iterator = makeIterator(iterable);
+    Value item;
+    while (iterator->next(item)) {
+        if (executeForBody(stmt, item) == ExecStatus::RETURN) {
+            return ExecStatus::RETURN;
+        }
+    }
+    return ExecStatus::NORMAL;
+}
+
+ExecStatus Interpreter::executeForBody(const ForStatement& stmt, const Value& item) {
+    defineVariable(stmt.variable, item);
+    return executeBlock(stmt.body->statements, environment);
+}
+
+ExecStatus Interpreter::executeStatements(const std::vector<std::unique_ptr<Statement>>& statements) {
+    for (const auto& stmt : statements) {
+        if (execute(*stmt) == ExecStatus::RETURN) {
+            return ExecStatus::RETURN;
         }
-        
-        default:
-            throw std::runtime_error("Unknown statement type");
     }
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::executeBlock(const std::vector<std::unique_ptr<Statement>>& statements, 
-                              std::shared_ptr<Environment> env) {
+ExecStatus Interpreter::executeBlock(const std::vector<std::unique_ptr<Statement>>& statements, 
+                                     std::shared_ptr<Environment> env) {
     std::shared_ptr<Environment> previous = environment;
+    bool previous_pending = scope_pending;
     
+    // The block's scope is only created if something gets defined in it
+    environment = std::move(env);
+    scope_pending = true;
+    
+    ExecStatus status;
     try {
-        environment = std::make_shared<Environment>(env);
-        
-        for (const auto& stmt : statements) {
-            execute(*stmt);
-        }
+        status = executeStatements(statements);
     } catch (...) {
         environment = previous;
+        scope_pending = previous_pending;
         throw;
     }
     
     environment = previous;
+    scope_pending = previous_pending;
+    return status;
+}
+
+Environment& Interpreter::currentScope() {
+    if (scope_pending) {
+        environment = makeEnvironment(environment);
+        scope_pending = false;
+    }
+    return *environment;
+}
+
+std::shared_ptr<Environment> Interpreter::captureClosure(const FunctionDefStatement& stmt) {
+    // Top-level definitions close over the module scope, which outlives them
+    if (environment->isModuleScope()) {
+        return environment;
+    }
+    
+    // Free names are not known until a deferred body is parsed, so keep the
+    // whole defining scope (only methods and top-level blocks defer theirs)
+    if (stmt.isDeferred()) {
+        if (options.dump_closures) {
+            std::cerr << "[closure] " << stmt.name << ": body not parsed yet, captured the defining scope" << std::endl;
+        }
+        return environment;
+    }
+    
+    std::shared_ptr<Environment> module_scope = environment;
+    while (module_scope && !module_scope->isModuleScope()) {
+        module_scope = module_scope->getParent();
+    }
+    
+    // Everything between here and the module scope belongs to calls and blocks
+    // that end; keep only the variables the function refers to, as cells
+    auto closure = makeEnvironment(module_scope);
+    std::vector<std::string> captured;
+    for (const auto& name : stmt.free_names) {
+        auto cell = environment->captureCell(name, module_scope.get());
+        if (!cell) {
+            if (module_scope && module_scope->lookup(name)) {
+                continue;
+            }
+            // Not bound yet (e.g. the function's own name): the defining scope
+            // gets an empty cell that a later definition fills in
+            cell = std::make_shared<Cell>();
+            collector.track(cell, GCKind::CELL);
+            environment->bindCell(name, cell);
+        }
+        closure->bindCell(name, cell);
+        captured.push_back(name);
+    }
+    
+    if (options.dump_closures) {
+        std::cerr << "[closure] " << stmt.name << ": captured " << captured.size()
+                  << " of " << stmt.free_names.size() << " free variable(s)";
+        for (size_t i = 0; i < captured.size(); ++i) {
+            std::cerr << (i == 0 ? ": " : ", ") << captured[i];
+        }
+        std::cerr << std::endl;
+    }
+    
+    return closure;
+}
+
+// --type-report: which locals TypeInference unboxed and why the others are not
+void Interpreter::reportTypes(const FunctionDefStatement& stmt) {
+    if (stmt.isDeferred()) {
+        std::cerr << "[types] " << stmt.name << ": body not parsed yet" << std::endl;
+        return;
+    }
+    std::cerr << "[types] " << stmt.name << ": number locals:";
+    if (stmt.number_locals.empty()) std::cerr << " none";
+    for (size_t i = 0; i < stmt.number_locals.size(); ++i) {
+        std::cerr << (i == 0 ? " " : ", ") << stmt.number_locals[i];
+    }
+    for (size_t i = 0; i < stmt.boxed_locals.size(); ++i) {
+        std::cerr << (i == 0 ? "; boxed: " : ", ") << stmt.boxed_locals[i].first << " ("
+                  << stmt.boxed_locals[i].second << ")";
+    }
+    std::cerr << std::endl;
+}
+
+void Interpreter::defineVariable(Symbol name, const Value& value) {
+    currentScope().define(name, value);
 }
 
 bool Interpreter::isTruthy(const Value& value) {
@@ -748,6 +1869,8 @@ bool Interpreter::isTruthy(const Value& value) {
             return !v.empty(); // Empty lists are falsy
         } else if constexpr (std::is_same_v<T, DictType>) {
             return !v.empty(); // Empty dicts are falsy
+        } else if constexpr (std::is_same_v<T, Range>) {
+            return v.length() > 0;
         }
         return true;
     }, value->value);
@@ -807,6 +1930,12 @@ Value Interpreter::performBinaryOp(TokenType op, const Value& left, const Value&
             }
             throw std::runtime_error("Invalid operands for /");
             
+        case TokenType::MODULO:
+            if (isNumber(left) && isNumber(right)) {
+                return makeValue(modulo(getNumber(left), getNumber(right)));
+            }
+            throw std::runtime_error("Invalid operands for %");
+            
         case TokenType::EQUAL:
             return makeValue(isEqual(left, right));
             
@@ -848,6 +1977,102 @@ Value Interpreter::performBinaryOp(TokenType op, const Value& left, const Value&
     }
 }
 
+static QuickeningStats quickening_stats;
+
+const QuickeningStats& Interpreter::quickeningStats() {
+    return quickening_stats;
+}
+
+void Interpreter::specialize(Quickened& node, Quickened variant) {
+    node = variant;
+    if (variant != Quickened::GENERIC) {
+        ++quickening_stats.specialized;
+    }
+}
+
+void Interpreter::despecialize(Quickened& node) {
+    node = Quickened::GENERIC;
+    ++quickening_stats.deoptimized;
+}
+
+Quickened Interpreter::specializeBinary(TokenType op, const Value& left, const Value& right) {
+    if (isNumber(left) && isNumber(right)) {
+        switch (op) {
+            case TokenType::PLUS: return Quickened::ADD_NUMBERS;
+            case TokenType::MINUS: return Quickened::SUBTRACT_NUMBERS;
+            case TokenType::MULTIPLY: return Quickened::MULTIPLY_NUMBERS;
+            case TokenType::DIVIDE: return Quickened::DIVIDE_NUMBERS;
+            case TokenType::EQUAL: return Quickened::EQUAL_NUMBERS;
+            case TokenType::NOT_EQUAL: return Quickened::NOT_EQUAL_NUMBERS;
+            case TokenType::LESS: return Quickened::LESS_NUMBERS;
+            case TokenType::LESS_EQUAL: return Quickened::LESS_EQUAL_NUMBERS;
+            case TokenType::GREATER: return Quickened::GREATER_NUMBERS;
+            case TokenType::GREATER_EQUAL: return Quickened::GREATER_EQUAL_NUMBERS;
+            default: return Quickened::GENERIC;
+        }
+    }
+    if (isString(left) && isString(right)) {
+        switch (op) {
+            case TokenType::PLUS: return Quickened::ADD_STRINGS;
+            case TokenType::EQUAL: return Quickened::EQUAL_STRINGS;
+            case TokenType::NOT_EQUAL: return Quickened::NOT_EQUAL_STRINGS;
+            default: return Quickened::GENERIC;
+        }
+    }
+    return Quickened::GENERIC;
+}
+
+// Specialized variants check only the operand types they were picked for,
+// then do the operation directly; anything else drops the node to generic
+Value Interpreter::evaluateQuickenedBinary(const BinaryExpression& expr, const Value& left, const Value& right) {
+    if (expr.quickened == Quickened::UNSEEN) {
+        specialize(expr.quickened, specializeBinary(expr.operator_type, left, right));
+    }
+    
+    const double* a = std::get_if<double>(&left->value);
+    const double* b = std::get_if<double>(&right->value);
+    if (a && b) {
+        switch (expr.quickened) {
+            case Quickened::ADD_NUMBERS: return makeValue(*a + *b);
+            case Quickened::SUBTRACT_NUMBERS: return makeValue(*a - *b);
+            case Quickened::MULTIPLY_NUMBERS: return makeValue(*a * *b);
+            case Quickened::DIVIDE_NUMBERS:
+                if (*b == 0) throw std::runtime_error("Division by zero");
+                return makeValue(*a / *b);
+            case Quickened::EQUAL_NUMBERS: return makeValue(*a == *b);
+            case Quickened::NOT_EQUAL_NUMBERS: return makeValue(*a != *b);
+            case Quickened::LESS_NUMBERS: return makeValue(*a < *b);
+            case Quickened::LESS_EQUAL_NUMBERS: return makeValue(*a <= *b);
+            case Quickened::GREATER_NUMBERS: return makeValue(*a > *b);
+            case Quickened::GREATER_EQUAL_NUMBERS: return makeValue(*a >= *b);
+            default: break;
+        }
+    } else {
+        const std::string* s = std::get_if<std::string>(&left->value);
+        const std::string* t = std::get_if<std::string>(&right->value);
+        if (s && t) {
+            switch (expr.quickened) {
+                case Quickened::ADD_STRINGS: return makeValue(*s + *t);
+                case Quickened::EQUAL_STRINGS: return makeValue(*s == *t);
+                case Quickened::NOT_EQUAL_STRINGS: return makeValue(*s != *t);
+                default: break;
+            }
+        }
+    }
+    
+    if (expr.quickened != Quickened::GENERIC) {
+        despecialize(expr.quickened);
+    }
+    return performBinaryOp(expr.operator_type, left, right);
+}
+
+Value Interpreter::applyBinary(const BinaryExpression& expr, const Value& left, const Value& right) {
+    if (expr.quickened != Quickened::GENERIC) {
+        return evaluateQuickenedBinary(expr, left, right);
+    }
+    return performBinaryOp(expr.operator_type, left, right);
+}
+
 Value Interpreter::performUnaryOp(TokenType op, const Value& operand) {
     switch (op) {
         case TokenType::MINUS:
@@ -864,9 +2089,14 @@ Value Interpreter::performUnaryOp(TokenType op, const Value& operand) {
     }
 }
 
+void Interpreter::defineBuiltin(const std::string& name, BuiltinFunction function) {
+    Symbol symbol(name);
+    builtins[symbol] = makeValue(std::make_shared<const Builtin>(Builtin{symbol, std::move(function)}));
+}
+
 void Interpreter::setupBuiltins() {
     // Print function
-    globals->defineBuiltin("print", [](const std::vector<Value>& args) -> Value {
+    defineBuiltin("print", [](const Arguments& args) -> Value {
         for (size_t i = 0; i < args.size(); ++i) {
             if (i > 0) std::cout << " ";
             std::cout << valueToString(args[i]);
@@ -876,15 +2106,249 @@ void Interpreter::setupBuiltins() {
     });
     
     // Raise function for throwing exceptions
-    globals->defineBuiltin("raise", [](const std::vector<Value>& /*args*/) -> Value {
-        // This lambda is not actually used, the logic is in the function call handler
-        return makeValue(nullptr);
+    defineBuiltin("raise", [](const Arguments& args) -> Value {
+        if (args.empty()) {
+            throw RuntimeException("Exception", makeValue(nullptr), "");
+        } else if (args.size() == 1) {
+            // raise("message") - throws a generic exception with message
+            if (isString(args[0]) && getString(args[0]) == "StopIteration") {
+                // Ends a for loop over an iterator (see Interpreter::callNext)
+                throw RuntimeException("StopIteration", args[0], "StopIteration");
+            } else if (isString(args[0])) {
+                throw RuntimeException("Exception", args[0], getString(args[0]));
+            } else {
+                throw RuntimeException("Exception", args[0], valueToString(args[0]));
+            }
+        } else if (args.size() == 2) {
+            // raise("ExceptionType", "message") - throws specific exception type
+            if (!isString(args[0])) {
+                throw std::runtime_error("First argument to raise() must be exception type (string)");
+            }
+            std::string exc_type = getString(args[0]);
+            std::string message = isString(args[1]) ? getString(args[1]) : valueToString(args[1]);
+            throw RuntimeException(exc_type, args[1], message);
+        }
+        throw std::runtime_error("raise() takes 0, 1, or 2 arguments");
     });
     
     // Length function
-    globals->defineBuiltin("len", [](const std::vector<Value>& /*args*/) -> Value {
+    defineBuiltin("len", [](const Arguments& args) -> Value {
+        if (args.size() != 1) {
+            throw std::runtime_error("len() takes exactly one argument");
+        }
+        const Value& arg = args[0];
+        if (isList(arg)) {
+            return makeValue(static_cast<double>(getList(arg).size()));
+        } else if (isDict(arg)) {
+            return makeValue(static_cast<double>(getDict(arg).size()));
+        } else if (isString(arg)) {
+            return makeValue(static_cast<double>(std::get<std::string>(arg->value).length()));
+        } else if (isRange(arg)) {
+            return makeValue(getRange(arg).length());
+        }
+        throw std::runtime_error("object of type '" + getTypeName(arg) + "' has no len()");
+    });
+    
+    // join(separator, items) concatenates an iterable of strings; the result
+    // is sized up front and filled in one pass
+    defineBuiltin("join", [this](const Arguments& args) -> Value {
+        if (args.size() != 2 || !isString(args[0])) {
+            throw std::runtime_error("join() takes a separator string and an iterable of strings");
+        }
+        ListType collected;
+        const ListType* items = isList(args[1]) ? &getList(args[1]) : nullptr;
+        if (!items) {
+            auto iterator = makeIterator(args[1]);
+            Value item;
+            while (iterator->next(item)) {
+                collected.push_back(item);
+            }
+            items = &collected;
+        }
+        
+        const std::string& separator = getString(args[0]);
+        size_t size = items->empty() ? 0 : separator.size() * (items->size() - 1);
+        for (const auto& item : *items) {
+            if (!isString(item)) {
+                throw std::runtime_error("join() items must be strings, not '" + getTypeName(item) + "'");
+            }
+            size += getString(item).size();
+        }
+        std::string result;
+        result.reserve(size);
+        for (size_t i = 0; i < items->size(); ++i) {
+            if (i > 0) {
+                result += separator;
+            }
+            result += getString((*items)[i]);
+        }
+        return makeValue(std::move(result));
+    });
+    
+    // next(iterator[, default]) runs a generator to its next yield or calls __next__
+    defineBuiltin("next", [this](const Arguments& args) -> Value {
+        if (args.empty() || args.size() > 2) {
+            throw std::runtime_error("next() takes an iterator and an optional default");
+        }
+        // Resuming the iterator pushes onto the stack the arguments live on
+        Value iterator = args[0];
+        Value item;
+        if (isGenerator(iterator)) {
+            if (resumeGenerator(*getGenerator(iterator), item)) {
+                return item;
+            }
+        } else {
+            Value next_method = isClassInstance(iterator) ? findMethod(*getClassInstance(iterator), NEXT_METHOD) : nullptr;
+            if (!next_method || !isFunction(next_method)) {
+                throw std::runtime_error("'" + getTypeName(iterator) + "' object is not an iterator");
+            }
+            if (callNext(iterator, getFunction(next_method), item)) {
+                return item;
+            }
+        }
+        if (args.size() == 2) {
+            return args[1];
+        }
+        throw RuntimeException("StopIteration");
+    });
+    
+    // range([start,] stop[, step]) produces its numbers lazily in for loops
+    defineBuiltin("range", [](const Arguments& args) -> Value {
+        if (args.empty() || args.size() > 3) {
+            throw std::runtime_error("range() takes 1 to 3 arguments");
+        }
+        for (const auto& arg : args) {
+            if (!isNumber(arg) || !std::isfinite(getNumber(arg)) || getNumber(arg) != std::floor(getNumber(arg))) {
+                throw std::runtime_error("range() arguments must be integers");
+            }
+        }
+        Range range;
+        if (args.size() == 1) {
+            range.stop = getNumber(args[0]);
+        } else {
+            range.start = getNumber(args[0]);
+            range.stop = getNumber(args[1]);
+        }
+        if (args.size() == 3) {
+            range.step = getNumber(args[2]);
+            if (range.step == 0) {
+                throw std::runtime_error("range() step must not be zero");
+            }
+        }
+        return makeValue(range);
+    });
+    
+    // reload(module) re-executes a module's file into its existing namespace
+    defineBuiltin("reload", [this](const Arguments& args) -> Value {
+        if (args.size() != 1 || !isModule(args[0])) {
+            throw std::runtime_error("reload() takes exactly one module argument");
+        }
+        reloadModule(*getModule(args[0]));
+        return args[0];
+    });
+    
+    for (const auto& [name, builtin] : builtins) {
+        globals->define(name, builtin);
+    }
+    
+    setupGCModule();
+}
+
+// Built-in 'gc' module exposing the cycle collector
+void Interpreter::setupGCModule() {
+    auto module = std::make_shared<Module>();
+    collector.track(module, GCKind::MODULE);
+    module->name = "gc";
+    module->module_env = makeEnvironment();
+    
+    defineBuiltin("gc.collect", [this](const Arguments& args) -> Value {
+        if (!args.empty()) {
+            throw std::runtime_error("gc.collect() takes no arguments");
+        }
+        return makeValue(static_cast<double>(collector.collect()));
+    });
+    
+    defineBuiltin("gc.stats", [this](const Arguments& args) -> Value {
+        if (!args.empty()) {
+            throw std::runtime_error("gc.stats() takes no arguments");
+        }
+        const GCStats& stats = collector.getStats();
+        DictType result;
+        result["collections"] = makeValue(static_cast<double>(stats.collections));
+        result["objects_freed"] = makeValue(static_cast<double>(stats.objects_freed));
+        result["last_freed"] = makeValue(static_cast<double>(stats.last_freed));
+        result["tracked"] = makeValue(static_cast<double>(collector.trackedCount()));
+        result["threshold"] = makeValue(static_cast<double>(collector.getThreshold()));
+        result["enabled"] = makeValue(collector.isEnabled());
+        result["last_pause_ms"] = makeValue(stats.last_pause_ms);
+        result["max_pause_ms"] = makeValue(stats.max_pause_ms);
+        result["total_pause_ms"] = makeValue(stats.total_pause_ms);
+        return makeValue(result);
+    });
+    
+    defineBuiltin("gc.set_threshold", [this](const Arguments& args) -> Value {
+        if (args.size() != 1 || !isNumber(args[0]) || getNumber(args[0]) < 1) {
+            throw std::runtime_error("gc.set_threshold() takes one positive number");
+        }
+        collector.setThreshold(static_cast<size_t>(getNumber(args[0])));
+        return makeValue(nullptr);
+    });
+    
+    defineBuiltin("gc.enable", [this](const Arguments& /*args*/) -> Value {
+        collector.setEnabled(true);
+        return makeValue(nullptr);
+    });
+    
+    defineBuiltin("gc.disable", [this](const Arguments& /*args*/) -> Value {
+        collector.setEnabled(false);
         return makeValue(nullptr);
     });
+    
+    defineBuiltin("gc.pool_stats", [](const Arguments& args) -> Value {
+        if (!args.empty()) {
+            throw std::runtime_error("gc.pool_stats() takes no arguments");
+        }
+        size_t hits = 0, misses = 0, live = 0, retained = 0;
+        ListType classes;
+        for (const PoolStats& stats : ObjectPools::instance().getStats()) {
+            hits += stats.hits;
+            misses += stats.misses;
+            live += stats.live_blocks * stats.block_size;
+            retained += stats.free_blocks * stats.block_size;
+            
+            DictType entry;
+            entry["block_size"] = makeValue(static_cast<double>(stats.block_size));
+            entry["hits"] = makeValue(static_cast<double>(stats.hits));
+            entry["misses"] = makeValue(static_cast<double>(stats.misses));
+            entry["live_blocks"] = makeValue(static_cast<double>(stats.live_blocks));
+            entry["free_blocks"] = makeValue(static_cast<double>(stats.free_blocks));
+            classes.push_back(makeValue(entry));
+        }
+        DictType result;
+        result["hits"] = makeValue(static_cast<double>(hits));
+        result["misses"] = makeValue(static_cast<double>(misses));
+        result["hit_rate"] = makeValue(hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0);
+        result["live_bytes"] = makeValue(static_cast<double>(live));
+        result["retained_bytes"] = makeValue(static_cast<double>(retained));
+        result["size_classes"] = makeValue(classes);
+        return makeValue(result);
+    });
+    
+    // Hand retained pool memory back to the system, e.g. after a script phase
+    defineBuiltin("gc.trim_pools", [](const Arguments& args) -> Value {
+        if (!args.empty()) {
+            throw std::runtime_error("gc.trim_pools() takes no arguments");
+        }
+        return makeValue(static_cast<double>(ObjectPools::instance().trim()));
+    });
+    
+    for (const char* name : {"collect", "stats", "set_threshold", "enable", "disable",
+                             "pool_stats", "trim_pools"}) {
+        module->module_env->define(Symbol(name), builtins.at(Symbol(std::string("gc.") + name)));
+    }
+    
+    // 'import gc' resolves through the module cache like any loaded module
+    module_cache["gc"] = module;
 }
 
 // New expression evaluation methods
@@ -912,76 +2376,184 @@ Value Interpreter::evaluateDictExpr(const DictExpression& expr) {
     return makeValue(dict);
 }
 
+static Value listItem(const ListType& list, double index) {
+    int idx = static_cast<int>(index);
+    
+    // Handle negative indices
+    if (idx < 0) {
+        idx += list.size();
+    }
+    
+    if (idx < 0 || idx >= static_cast<int>(list.size())) {
+        throw std::runtime_error("List index out of range");
+    }
+    
+    return list[idx];
+}
+
+static Value dictItem(const DictType& dict, const std::string& key) {
+    auto it = dict.find(key);
+    if (it == dict.end()) {
+        throw std::runtime_error("Key '" + key + "' not found in dictionary");
+    }
+    
+    return it->second;
+}
+
+Value getItem(const Value& object, const Value& index) {
+    if (isList(object)) {
+        if (!isNumber(index)) {
+            throw std::runtime_error("List indices must be integers");
+        }
+        return listItem(getList(object), getNumber(index));
+    } else if (isDict(object)) {
+        if (!isString(index)) {
+            throw std::runtime_error("Dictionary keys must be strings");
+        }
+        return dictItem(getDict(object), getString(index));
+    } else {
+        throw std::runtime_error("Object is not subscriptable");
+    }
+}
+
 Value Interpreter::evaluateIndexExpr(const IndexExpression& expr) {
     Value object = evaluate(*expr.object);
     Value index = evaluate(*expr.index);
     
+    if (expr.quickened == Quickened::UNSEEN) {
+        if (isList(object) && isNumber(index)) {
+            specialize(expr.quickened, Quickened::LIST_BY_NUMBER);
+        } else if (isDict(object) && isString(index)) {
+            specialize(expr.quickened, Quickened::DICT_BY_STRING);
+        } else {
+            specialize(expr.quickened, Quickened::GENERIC);
+        }
+    }
+    if (expr.quickened == Quickened::LIST_BY_NUMBER) {
+        const auto* list = std::get_if<ListType>(&object->value);
+        const double* number = std::get_if<double>(&index->value);
+        if (list && number) {
+            return listItem(*list, *number);
+        }
+        despecialize(expr.quickened);
+    } else if (expr.quickened == Quickened::DICT_BY_STRING) {
+        const auto* dict = std::get_if<DictType>(&object->value);
+        const std::string* key = std::get_if<std::string>(&index->value);
+        if (dict && key) {
+            return dictItem(*dict, *key);
+        }
+        despecialize(expr.quickened);
+    }
+    return getItem(object, index);
+}
+
+// object[index] = value and object[index] op= value. Like Python, the
+// operand is evaluated after the target for an augmented assignment and
+// before it for a plain one
+void Interpreter::executeIndexAssignment(const IndexAssignmentStatement& stmt) {
+    Value value;
+    if (stmt.op == TokenType::ASSIGN) {
+        value = evaluate(*stmt.value);
+    }
+    Value object = evaluate(*stmt.object);
+    Value index = evaluate(*stmt.index);
+    if (stmt.op != TokenType::ASSIGN) {
+        Value current = getItem(object, index);
+        Value operand = evaluate(*stmt.value);
+        if (stmt.op == TokenType::PLUS && isList(current)) {
+            extendList(current, operand);
+            value = current;
+        } else {
+            value = performBinaryOp(stmt.op, current, operand);
+        }
+    }
+    
+    setItem(object, index, std::move(value));
+}
+
+void setItem(const Value& object, const Value& index, Value value) {
     if (isList(object)) {
         if (!isNumber(index)) {
             throw std::runtime_error("List indices must be integers");
         }
-        
-        auto& list = getList(object);
+        ListType& list = getList(object);
         int idx = static_cast<int>(getNumber(index));
-        
-        // Handle negative indices
         if (idx < 0) {
             idx += list.size();
         }
-        
         if (idx < 0 || idx >= static_cast<int>(list.size())) {
             throw std::runtime_error("List index out of range");
         }
-        
-        return list[idx];
+        list[idx] = std::move(value);
     } else if (isDict(object)) {
         if (!isString(index)) {
             throw std::runtime_error("Dictionary keys must be strings");
         }
-        
-        auto& dict = getDict(object);
-        std::string key = getString(index);
-        
-        auto it = dict.find(key);
-        if (it == dict.end()) {
-            throw std::runtime_error("Key '" + key + "' not found in dictionary");
-        }
-        
-        return it->second;
+        getDict(object)[getString(index)] = std::move(value);
     } else {
-        throw std::runtime_error("Object is not subscriptable");
+        throw std::runtime_error("Object does not support item assignment");
     }
 }
 
 Value Interpreter::evaluateAttributeExpr(const AttributeExpression& expr) {
-    Value object = evaluate(*expr.object);
+    if (expr.object->type == NodeType::SUPER_EXPR) {
+        Value self;
+        return getSuperMethod(expr.attribute, self);
+    }
+    return getAttribute(evaluate(*expr.object), expr.attribute);
+}
+
+Value Interpreter::getSuperMethod(Symbol attribute, Value& self) {
+    // super() binds to the base of the class that defined the running method,
+    // not the class of self, so each level reaches its own parent
+    std::shared_ptr<Class> owner = current_function ? current_function->owner.lock() : nullptr;
+    if (!owner || current_function->parameters.empty()) {
+        throw std::runtime_error("super() used outside a method");
+    }
+    if (!owner->base) {
+        throw std::runtime_error("'" + owner->name + "' has no base class");
+    }
     
+    // The method's first parameter is the instance
+    if (current_function->uses_frame_slots) {
+        self = stack[frame_base];
+    } else {
+        self = environment->tryGet(current_function->parameters[0]);
+    }
+    
+    auto methodIt = owner->base->methods.find(attribute);
+    if (methodIt == owner->base->methods.end()) {
+        throw std::runtime_error("'super' object has no attribute '" + attribute + "'");
+    }
+    return methodIt->second;
+}
+
+Value Interpreter::getAttribute(const Value& object, Symbol attribute) {
     if (isModule(object)) {
         auto module = getModule(object);
         
         // Look up the attribute in the module's environment
-        try {
-            Value result = module->module_env->get(expr.attribute);
-            return result;
-        } catch (const std::runtime_error&) {
-            throw std::runtime_error("Module '" + module->name + "' has no attribute '" + expr.attribute + "'");
+        Value* slot = module->module_env->lookup(attribute);
+        if (!slot) {
+            throw std::runtime_error("Module '" + module->name + "' has no attribute '" + attribute + "'");
         }
+        return *slot;
     } else if (isClassInstance(object)) {
         auto instance = getClassInstance(object);
         
         // First check instance attributes
-        auto it = instance->attributes.find(expr.attribute);
+        auto it = instance->attributes.find(attribute);
         if (it != instance->attributes.end()) {
             return it->second;
         }
         
         // Then check class methods
-        auto methodIt = instance->classRef->methods.find(expr.attribute);
+        auto methodIt = instance->classRef->methods.find(attribute);
         if (methodIt != instance->classRef->methods.end()) {
             return methodIt->second;
         }
         
-        throw std::runtime_error("'" + instance->classRef->name + "' object has no attribute '" + expr.attribute + "'");
+        throw std::runtime_error("'" + instance->classRef->name + "' object has no attribute '" + attribute + "'");
     }
     
     throw std::runtime_error("Object has no attributes");
@@ -989,25 +2561,41 @@ Value Interpreter::evaluateAttributeExpr(const AttributeExpression& expr) {
 
 void Interpreter::executeClassDef(const ClassDefStatement& stmt) {
     // Create class object
+    Environment& scope = currentScope();
     auto cls = std::make_shared<Class>(stmt.name, stmt.body.get(), environment);
+    cls->source = current_source;
+    collector.track(cls, GCKind::CLASS);
+    
+    if (stmt.base) {
+        Value base = evaluate(*stmt.base);
+        if (!isClass(base)) {
+            throw std::runtime_error("Base of class '" + stmt.name + "' is not a class");
+        }
+        cls->base = getClass(base);
+        // Start from the parent's already flattened table
+        cls->methods = cls->base->methods;
+    }
     
     // Execute class body in a new environment to collect methods
-    auto classEnv = std::make_shared<Environment>(environment);
+    auto classEnv = makeEnvironment(environment);
     auto previous = environment;
     environment = classEnv;
+    scope_pending = false;
     
     try {
         // Execute statements directly in the class environment
-        for (const auto& statement : stmt.body->statements) {
-            execute(*statement);
-        }
+        executeStatements(stmt.body->statements);
         
-        // Collect all function definitions as methods
-        for (const auto& [name, value] : classEnv->getVariables()) {
+        // Collect all function definitions as methods, overriding inherited ones
+        classEnv->forEachVariable([&cls](Symbol name, const Value& value) {
             if (isFunction(value)) {
+                auto function = getFunction(value);
+                if (function->owner.expired()) {
+                    function->owner = cls;
+                }
                 cls->methods[name] = value;
             }
-        }
+        });
     } catch (...) {
         environment = previous;
         throw;
@@ -1016,7 +2604,7 @@ void Interpreter::executeClassDef(const ClassDefStatement& stmt) {
     environment = previous;
     
     // Define the class in the current environment
-    environment->define(stmt.name, makeValue(cls));
+    scope.define(stmt.name, makeValue(cls));
 }
 
 void Interpreter::executeImport(const ImportStatement& stmt) {
@@ -1024,8 +2612,7 @@ void Interpreter::executeImport(const ImportStatement& stmt) {
     auto module = loadModule(stmt.module_name);
     
     // Define the module in the current environment
-    std::string name = stmt.alias.empty() ? stmt.module_name : stmt.alias;
-    environment->define(name, makeValue(module));
+    defineVariable(Symbol(stmt.alias.empty() ? stmt.module_name : stmt.alias), makeValue(module));
 }
 
 void Interpreter::executeFromImport(const FromImportStatement& stmt) {
@@ -1034,69 +2621,72 @@ void Interpreter::executeFromImport(const FromImportStatement& stmt) {
     
     // Import specific symbols from the module
     for (const auto& [import_name, alias] : stmt.imports) {
-        try {
-            Value value = module->module_env->get(import_name);
-            std::string name = alias.empty() ? import_name : alias;
-            environment->define(name, value);
-        } catch (const std::runtime_error&) {
+        Value* slot = module->module_env->lookup(Symbol(import_name));
+        if (!slot) {
             throw std::runtime_error("Cannot import '" + import_name + "' from module '" + stmt.module_name + "'");
         }
+        Value value = *slot;
+        defineVariable(Symbol(alias.empty() ? import_name : alias), value);
     }
 }
 
-void Interpreter::executeTry(const TryStatement& stmt) {
+ExecStatus Interpreter::executeTry(const TryStatement& stmt) {
+    // The handler runs once the C++ catch is over, so it may yield (see Coroutine)
+    const ExceptClause* handler = nullptr;
+    Value exception_value;
+    // raise("StopIteration") in the body has to be catchable here, so it throws
+    const Function* previous_stop = stop_iteration_function;
+    stop_iteration_function = nullptr;
     try {
         // Execute the try block
-        executeBlock(stmt.try_body->statements, environment);
+        ExecStatus status = executeBlock(stmt.try_body->statements, environment);
+        stop_iteration_function = previous_stop;
+        return status;
     } catch (const RuntimeException& e) {
+        stop_iteration_function = previous_stop;
         // Handle user-defined exceptions
-        bool handled = false;
-        
         for (const auto& except_clause : stmt.except_clauses) {
             // If no exception type specified, catch all
             if (except_clause.exception_type.empty() || 
                 except_clause.exception_type == e.exception_type) {
-                
-                // If a variable name is specified, bind the exception to it
-                if (!except_clause.variable_name.empty()) {
-                    environment->define(except_clause.variable_name, e.exception_value);
-                }
-                
-                // Execute the except block
-                executeBlock(except_clause.body->statements, environment);
-                handled = true;
+                handler = &except_clause;
+                exception_value = e.exception_value;
                 break;
             }
         }
         
-        // If no except clause handled it, re-throw
-        if (!handled) {
+        // If no except clause handles it, re-throw
+        if (!handler) {
             throw;
         }
     } catch (const std::runtime_error& e) {
+        stop_iteration_function = previous_stop;
         // Handle built-in runtime errors as generic exceptions
-        bool handled = false;
-        
         for (const auto& except_clause : stmt.except_clauses) {
             // If no exception type specified or if it's a generic RuntimeError
             if (except_clause.exception_type.empty() || 
                 except_clause.exception_type == "RuntimeError") {
-                
-                // If a variable name is specified, bind the exception message to it
-                if (!except_clause.variable_name.empty()) {
-                    environment->define(except_clause.variable_name, makeValue(std::string(e.what())));
-                }
-                
-                // Execute the except block
-                executeBlock(except_clause.body->statements, environment);
-                handled = true;
+                handler = &except_clause;
+                // The exception is bound as its message
+                exception_value = makeValue(std::string(e.what()));
                 break;
             }
         }
         
-        // If no except clause handled it, re-throw
-        if (!handled) {
+        // If no except clause handles it, re-throw
+        if (!handler) {
             throw;
         }
+    } catch (...) {
+        stop_iteration_function = previous_stop;
+        throw;
+    }
+    
+    // If a variable name is specified, bind the exception to it
+    if (!handler->variable_name.empty()) {
+        defineVariable(handler->variable_name, exception_value);
     }
+    
+    // Execute the except block
+    return executeBlock(handler->body->statements, environment);
 }
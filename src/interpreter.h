@@ -1,41 +1,70 @@
 #pragma once
 #include "parser.h"
+#include "gc.h"
+#include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <functional>
 #include <memory>
 #include <vector>
 #include <map>
+#include <stdexcept>
+#include <filesystem>
 
 // Forward declarations
 struct BlockStatement;
 class Environment;
+class Snapshot;
+class Coroutine;
+class Interpreter;
+class EmittedProgram;
+namespace jit {
+class Compiler;
+struct CompiledFunction;
+}
 
 // Forward declare Value and container types
 struct Function;
 struct Class;
 struct ClassInstance;
 struct Module;
+struct Generator;
+struct Builtin;
 using ListType = std::vector<std::shared_ptr<struct ValueWrapper>>;
 using DictType = std::map<std::string, std::shared_ptr<struct ValueWrapper>>;
 
+// range(start, stop, step): the numbers are computed, never stored
+struct Range {
+    double start = 0;
+    double stop = 0;
+    double step = 1;
+    
+    double length() const;
+    double at(double index) const { return start + index * step; }
+    // Equal when they produce the same numbers, as in Python
+    bool operator==(const Range& other) const;
+};
+
 // Value wrapper for recursive types
 struct ValueWrapper {
-    std::variant<double, std::string, bool, std::nullptr_t, std::shared_ptr<Function>, ListType, DictType, std::shared_ptr<Class>, std::shared_ptr<ClassInstance>, std::shared_ptr<Module>> value;
+    std::variant<double, std::string, bool, std::nullptr_t, std::shared_ptr<Function>, ListType, DictType, std::shared_ptr<Class>, std::shared_ptr<ClassInstance>, std::shared_ptr<Module>, Range, std::shared_ptr<Generator>, std::shared_ptr<const Builtin>> value;
     
-    ValueWrapper(const std::variant<double, std::string, bool, std::nullptr_t, std::shared_ptr<Function>, ListType, DictType, std::shared_ptr<Class>, std::shared_ptr<ClassInstance>, std::shared_ptr<Module>>& v) 
+    ValueWrapper(const std::variant<double, std::string, bool, std::nullptr_t, std::shared_ptr<Function>, ListType, DictType, std::shared_ptr<Class>, std::shared_ptr<ClassInstance>, std::shared_ptr<Module>, Range, std::shared_ptr<Generator>, std::shared_ptr<const Builtin>>& v) 
         : value(v) {}
 };
 
 using Value = std::shared_ptr<ValueWrapper>;
 
-// Return exception for function returns
-class ReturnException : public std::runtime_error {
-public:
-    Value value;
-    ReturnException(Value v) : std::runtime_error("return"), value(v) {}
+// Completion of a statement; RETURN unwinds to the enclosing call
+enum class ExecStatus {
+    NORMAL,
+    RETURN
 };
 
+// A function body translated to C++ by --emit-exe (see emit_cpp.h)
+using NativeBody = ExecStatus (*)(EmittedProgram&);
+
 // Runtime exception for user-defined exceptions
 class RuntimeException : public std::runtime_error {
 public:
@@ -47,12 +76,37 @@ public:
           exception_type(type), exception_value(value) {}
 };
 
+// Arguments of a built-in call, read in place from the caller's value stack.
+// A builtin that calls back into the interpreter may grow the stack, so an
+// argument must not be held by reference across such a call.
+class Arguments {
+public:
+    Arguments(const std::vector<Value>& stack, size_t base) : stack(stack), base(base) {}
+    
+    size_t size() const { return stack.size() - base; }
+    bool empty() const { return stack.size() == base; }
+    const Value& operator[](size_t index) const { return stack[base + index]; }
+    std::vector<Value>::const_iterator begin() const { return stack.begin() + base; }
+    std::vector<Value>::const_iterator end() const { return stack.end(); }
+    
+private:
+    const std::vector<Value>& stack;
+    size_t base;
+};
+
 // Built-in function type
-using BuiltinFunction = std::function<Value(const std::vector<Value>&)>;
+using BuiltinFunction = std::function<Value(const Arguments&)>;
+
+// A built-in function as a value; calling it needs no lookup by name
+struct Builtin {
+    Symbol name;
+    BuiltinFunction function;
+};
 
 // Convenience functions for creating values
 Value makeValue(double d);
 Value makeValue(const std::string& s);
+Value makeValue(std::string&& s);
 Value makeValue(bool b);
 Value makeValue(std::nullptr_t);
 Value makeValue(std::shared_ptr<Function> f);
@@ -61,6 +115,9 @@ Value makeValue(const DictType& d);
 Value makeValue(std::shared_ptr<Class> c);
 Value makeValue(std::shared_ptr<ClassInstance> ci);
 Value makeValue(std::shared_ptr<Module> m);
+Value makeValue(const Range& r);
+Value makeValue(std::shared_ptr<Generator> g);
+Value makeValue(std::shared_ptr<const Builtin> b);
 
 // Helper functions for value access
 bool isNumber(const Value& v);
@@ -73,9 +130,12 @@ bool isDict(const Value& v);
 bool isClass(const Value& v);
 bool isClassInstance(const Value& v);
 bool isModule(const Value& v);
+bool isRange(const Value& v);
+bool isGenerator(const Value& v);
+bool isBuiltin(const Value& v);
 
 double getNumber(const Value& v);
-std::string getString(const Value& v);
+const std::string& getString(const Value& v);
 bool getBool(const Value& v);
 std::shared_ptr<Function> getFunction(const Value& v);
 ListType& getList(const Value& v);
@@ -83,6 +143,9 @@ DictType& getDict(const Value& v);
 std::shared_ptr<Class> getClass(const Value& v);
 std::shared_ptr<ClassInstance> getClassInstance(const Value& v);
 std::shared_ptr<Module> getModule(const Value& v);
+const Range& getRange(const Value& v);
+std::shared_ptr<Generator> getGenerator(const Value& v);
+const Builtin& getBuiltin(const Value& v);
 
 // Convert value to string for printing
 std::string valueToString(const Value& v);
@@ -90,14 +153,32 @@ std::string valueToString(const Value& v);
 // Helper functions for built-ins
 std::string getTypeName(const Value& v);
 int compareValues(const Value& a, const Value& b);
+// object[index] of a list or dict, and object[index] = value
+Value getItem(const Value& object, const Value& index);
+void setItem(const Value& object, const Value& index, Value value);
+// Python's %: the result takes the sign of the divisor
+double modulo(double left, double right);
 
 // Value type for the interpreter
 struct Function {
-    std::vector<std::string> parameters;
+    Symbol name;
+    std::vector<Symbol> parameters;
     const BlockStatement* body; // Store pointer to the original body
     std::shared_ptr<Environment> closure;
+    bool uses_frame_slots = false; // parameters are read from the call frame, see Resolver
+    std::weak_ptr<Class> owner;    // class whose body defined this method, for super()
+    std::shared_ptr<const Program> source; // keeps a reloaded module's old AST alive
+    const FunctionDefStatement* deferred = nullptr; // body not parsed yet, see Parser::parseDeferredBody
+    std::vector<Symbol> number_locals; // unboxed locals by number slot, see TypeInference
+    bool is_generator = false; // calls create a Generator instead of running the body
+    // JIT state: calls counted towards jit::CALL_THRESHOLD, then the code
+    // (or jit_rejected if the body cannot be compiled)
+    unsigned calls = 0;
+    jit::CompiledFunction* compiled = nullptr;
+    bool jit_rejected = false;
+    NativeBody native = nullptr; // body translated to C++, see Interpreter::executeBody
     
-    Function(std::vector<std::string> params, const BlockStatement* b, std::shared_ptr<Environment> env)
+    Function(std::vector<Symbol> params, const BlockStatement* b, std::shared_ptr<Environment> env)
         : parameters(std::move(params)), body(b), closure(env) {}
 };
 
@@ -105,7 +186,11 @@ struct Class {
     std::string name;
     const BlockStatement* body;
     std::shared_ptr<Environment> closure;
-    std::unordered_map<std::string, Value> methods;
+    std::shared_ptr<Class> base;
+    std::shared_ptr<const Program> source;
+    // Flattened at class creation: inherited methods overridden by our own,
+    // so lookup is one probe regardless of hierarchy depth
+    std::unordered_map<Symbol, Value> methods;
     
     Class(const std::string& n, const BlockStatement* b, std::shared_ptr<Environment> env)
         : name(n), body(b), closure(env) {}
@@ -113,7 +198,7 @@ struct Class {
 
 struct ClassInstance {
     std::shared_ptr<Class> classRef;
-    std::unordered_map<std::string, Value> attributes;
+    std::unordered_map<Symbol, Value> attributes;
     
     ClassInstance(std::shared_ptr<Class> c) : classRef(c) {}
 };
@@ -122,27 +207,113 @@ struct Module {
     std::string name;
     std::string file_path;
     std::shared_ptr<Environment> module_env;
-    std::unique_ptr<Program> ast; // Store the parsed AST to keep it alive
+    std::shared_ptr<Program> ast; // Current AST; functions defined from it share ownership
+    std::filesystem::file_time_type mtime{}; // of file_path when last executed
     
     Module() = default;
     Module(const std::string& n, const std::string& path, std::shared_ptr<Environment> env)
         : name(n), file_path(path), module_env(env) {}
 };
 
+// What calling a generator function returns. The body runs on a coroutine
+// of its own, up to the next yield each time an item is asked for, and its
+// frame (the environment and the C++ frames of the interpreter running it)
+// stays suspended in between. The cycle collector sees the generator's
+// function, environment and last yielded value; references held by the C++
+// frames of a suspended body count as references from outside the heap.
+struct Generator {
+    std::shared_ptr<Function> function;
+    // Scope the body was executing in when it last yielded
+    std::shared_ptr<Environment> environment;
+    bool scope_pending = false;
+    std::unique_ptr<Coroutine> coroutine;
+    Value yielded;
+    bool running = false;
+    Interpreter* interpreter;
+    
+    Generator(std::shared_ptr<Function> f, std::shared_ptr<Environment> env, Interpreter* owner);
+    // A body suspended at a yield is handed to the interpreter, which unwinds
+    // its stack at the next safe point
+    ~Generator();
+};
+
+// Shared box for a variable captured by a closure. The defining scope and the
+// closure both bind the name to the same cell; an empty cell stands for a
+// variable the defining scope has not assigned yet.
+struct Cell {
+    Value value;
+};
+
 // Environment for variable storage
 class Environment {
 private:
-    std::unordered_map<std::string, Value> variables;
+    struct Binding {
+        Value value;
+        std::shared_ptr<Cell> cell; // set once a closure captures the variable
+        
+        Value& slot() { return cell ? cell->value : value; }
+    };
+    
+    std::unordered_map<Symbol, Binding> variables;
     std::shared_ptr<Environment> parent;
+    bool module_scope = false;
+    
+    friend class GarbageCollector;
+    friend class Snapshot;
     
 public:
     Environment(std::shared_ptr<Environment> parent = nullptr);
     
-    void define(const std::string& name, const Value& value);
-    void defineBuiltin(const std::string& name, BuiltinFunction func);
-    Value get(const std::string& name);
-    void assign(const std::string& name, const Value& value);
-    const std::unordered_map<std::string, Value>& getVariables() const;
+    void define(Symbol name, const Value& value);
+    Value get(Symbol name);
+    void assign(Symbol name, const Value& value);
+    
+    // Non-throwing variants for hot paths: lookup() returns a handle to the
+    // binding (nullptr if unbound), tryGet() a null Value, tryAssign() false
+    Value* lookup(Symbol name);
+    Value tryGet(Symbol name);
+    bool tryAssign(Symbol name, const Value& value);
+    void forEachVariable(const std::function<void(Symbol, const Value&)>& visit);
+    
+    // Globals and module environments outlive any call, so closures defined
+    // there keep them whole; closures defined below capture cells instead
+    void setModuleScope(bool value) { module_scope = value; }
+    bool isModuleScope() const { return module_scope; }
+    const std::shared_ptr<Environment>& getParent() const { return parent; }
+    
+    // Cell for a variable bound in this environment or an ancestor below
+    // 'stop'; nullptr if there is no such binding
+    std::shared_ptr<Cell> captureCell(Symbol name, const Environment* stop);
+    void bindCell(Symbol name, std::shared_ptr<Cell> cell);
+};
+
+// Create an environment registered with the cycle collector
+std::shared_ptr<Environment> makeEnvironment(std::shared_ptr<Environment> parent = nullptr);
+
+// Operator nodes specialized to operand types and specializations abandoned
+// (--quickening-stats)
+struct QuickeningStats {
+    size_t specialized = 0;
+    size_t deoptimized = 0;
+};
+
+struct InterpreterOptions {
+    bool dump_closures = false; // report what each closure captures
+    bool watch_modules = false; // re-execute changed module files on import
+    unsigned parse_threads = 1; // threads for parsing a file, 0 = one per core
+    bool lazy_parse = false;    // parse function bodies on their first call
+    bool jit = true;            // compile hot numeric functions to machine code
+    bool jit_log = false;       // report JIT compilations and deoptimizations
+    bool jit_perf_map = false;  // write /tmp/perf-PID.map for compiled code
+    bool type_report = false;   // report inferred local types of each function defined
+};
+
+// One pass of a for loop over a value (see Interpreter::makeIterator)
+class Iterator {
+public:
+    virtual ~Iterator() = default;
+    // Sets item to the next element; false once the iterable is exhausted
+    virtual bool next(Value& item) = 0;
 };
 
 // Interpreter class
@@ -151,35 +322,173 @@ private:
     std::shared_ptr<Environment> globals;
     std::shared_ptr<Environment> environment;
     std::unordered_map<std::string, std::shared_ptr<Module>> module_cache;
+    // Modules built into the program, see addModule()
+    std::unordered_map<std::string, std::shared_ptr<Program>> embedded_modules;
+    // Function bodies built into the program as C++ (--emit-exe), by the
+    // definition that creates the functions, and the program they run in
+    std::unordered_map<const FunctionDefStatement*, NativeBody> native_bodies;
+    EmittedProgram* native_program = nullptr;
+    std::unordered_map<Symbol, Value> builtins;
+    GarbageCollector& collector;
+    
+    // Call frames: callers push arguments here and a frame-slot function reads
+    // its parameters at frame_base + slot
+    std::vector<Value> stack;
+    size_t frame_base = 0;
+    const Function* current_function = nullptr;
+    
+    // Unboxed number locals of the running function at number_base + slot;
+    // NO_NUMBER_FRAME when it has none or they had to stay boxed for this call
+    static constexpr size_t NO_NUMBER_FRAME = SIZE_MAX;
+    std::vector<double> numbers;
+    size_t number_base = NO_NUMBER_FRAME;
+    
+    // Module AST that functions and classes defined right now point into
+    std::shared_ptr<const Program> current_source;
+    
+    // Block scopes are created on the first definition in them
+    bool scope_pending = false;
+    
+    Value return_value;
+    
+    InterpreterOptions options;
+    std::unique_ptr<jit::Compiler> jit; // null when the JIT is off
+    
+    // Generator whose body is running; yield suspends it
+    Generator* current_generator = nullptr;
+    // Generators suspended at a yield, and bodies of dropped ones still to be
+    // unwound; closing_generators makes yield throw to unwind them
+    std::unordered_set<Generator*> suspended_generators;
+    std::vector<std::unique_ptr<Coroutine>> abandoned_generators;
+    bool closing_generators = false;
+    
+    // Number of interpreted calls in progress
+    size_t call_depth = 0;
+    
+    // The __next__ method a for loop is calling and the call depth of that
+    // frame: its raise("StopIteration") statements return the stop_iteration
+    // marker instead of throwing. Other calls of the same method, such as a
+    // recursive one, raise as usual
+    const Function* stop_iteration_function = nullptr;
+    size_t stop_iteration_depth = 0;
+    Value stop_iteration;
+    
+    friend class Snapshot;
+    friend struct Generator;
+    friend class EmittedProgram;
     
 public:
-    Interpreter();
+    Interpreter(const InterpreterOptions& options = InterpreterOptions());
+    ~Interpreter();
     void interpret(const Program& program);
+    // Like interpret, but echoes the value of top-level expression statements
+    void interpretInteractive(const Program& program);
+    
+    // Re-execute a module's file into its existing environment
+    void reloadModule(Module& module);
+    // Reload every cached module whose file changed; returns how many
+    size_t reloadChangedModules();
+    // Makes a parsed module part of the program (--emit-exe): importing name
+    // runs it instead of looking for name.py, and reload() runs it again
+    void addModule(const std::string& name, std::shared_ptr<Program> program);
+    
+    static const QuickeningStats& quickeningStats();
+    
+    // Runs a generator to its next yield and sets item to the value yielded;
+    // false once the body has returned
+    bool resumeGenerator(Generator& generator, Value& item);
+    // Calls an iterator's __next__ and sets item to the result; false once
+    // it raises StopIteration
+    bool callNext(const Value& iterator, const std::shared_ptr<Function>& next_method, Value& item);
     
 private:
     Value evaluate(const Expression& expr);
-    void execute(const Statement& stmt);
-    void executeBlock(const std::vector<std::unique_ptr<Statement>>& statements, 
-                     std::shared_ptr<Environment> env);
+    ExecStatus execute(const Statement& stmt);
+    ExecStatus executeStatements(const std::vector<std::unique_ptr<Statement>>& statements);
+    ExecStatus executeBlock(const std::vector<std::unique_ptr<Statement>>& statements, 
+                            std::shared_ptr<Environment> env);
     
     // Expression evaluation methods
     Value evaluateListExpr(const ListExpression& expr);
     Value evaluateDictExpr(const DictExpression& expr);
     Value evaluateIndexExpr(const IndexExpression& expr);
+    Value evaluateQuickenedBinary(const BinaryExpression& expr, const Value& left, const Value& right);
+    // The operation of a binary node on evaluated operands, through its
+    // quickened variant unless it has gone generic
+    Value applyBinary(const BinaryExpression& expr, const Value& left, const Value& right);
+    // Only for expressions proven to be numbers; unboxed subexpressions are
+    // computed without allocating
+    double evaluateNumber(const Expression& expr);
+    Value evaluateUnboxedBinary(const BinaryExpression& expr);
     Value evaluateAttributeExpr(const AttributeExpression& expr);
+    Value evaluateCallExpr(const CallExpression& expr);
+    Value getAttribute(const Value& object, Symbol attribute);
+    Value getSuperMethod(Symbol attribute, Value& self);
+    
+    // Calls take their arguments from stack[args_base..]
+    Value callValue(const Value& callee, size_t args_base);
+    Value callFunction(const std::shared_ptr<Function>& function, size_t args_base);
+    // Runs the call as compiled code if the function is hot and the code's
+    // assumptions hold; false leaves the call to the interpreter
+    bool callCompiled(Function& function, size_t args_base, Value& result);
+    // Number locals can be unboxed unless a closure binding of the same name
+    // exists, which assignments would have to update
+    bool numberLocalsAreFree(const Function& function);
+    Value makeGenerator(const std::shared_ptr<Function>& function, size_t args_base);
+    // Runs the body of the function whose frame is set up: its C++ code if
+    // it has one and the code's unboxed number locals are in the frame
+    ExecStatus executeBody(const Function& function);
+    void yieldValue(Value value);
+    void closeGenerators(); // unwinds abandoned_generators
     
     // Statement execution methods
     void executeClassDef(const ClassDefStatement& stmt);
     void executeImport(const ImportStatement& stmt);
     void executeFromImport(const FromImportStatement& stmt);
-    void executeTry(const TryStatement& stmt);
+    ExecStatus executeTry(const TryStatement& stmt);
+    ExecStatus executeFor(const ForStatement& stmt);
+    // Runs the loop body with the loop variable bound to item
+    ExecStatus executeForBody(const ForStatement& stmt, const Value& item);
+    // Iterator protocol of for loops; throws for values that are not iterable
+    std::unique_ptr<Iterator> makeIterator(const Value& iterable);
+    bool isStopIterationRaise(const Expression& expr);
+    
+    // Scope helpers
+    Environment& currentScope();
+    std::shared_ptr<Environment> captureClosure(const FunctionDefStatement& stmt);
+    void reportTypes(const FunctionDefStatement& stmt);
+    void defineVariable(Symbol name, const Value& value);
     
     // Helper methods
     bool isTruthy(const Value& value);
     bool isEqual(const Value& a, const Value& b);
     Value performBinaryOp(TokenType op, const Value& left, const Value& right);
+    // Evaluates concat (target + piece [+ ...]) for an assignment to target.
+    // Appends to the string in place and returns nullptr when the binding
+    // locate() finds holds its only reference
+    template <typename Locate>
+    Value concatenateInPlace(const BinaryExpression& concat, Locate locate);
+    // Evaluates update (target op value) for an augmented assignment to
+    // target. Returns nullptr when the binding was updated in place
+    template <typename Locate>
+    Value updateInPlace(const BinaryExpression& update, Locate locate);
+    // list += items: appends to the list itself, so aliases see the items
+    void extendList(const Value& list, const Value& items);
+    void executeIndexAssignment(const IndexAssignmentStatement& stmt);
     Value performUnaryOp(TokenType op, const Value& operand);
+    
+    // Quickening: a node's specialization is picked once and dropped to
+    // generic when its guard fails
+    static Quickened specializeBinary(TokenType op, const Value& left, const Value& right);
+    static void specialize(Quickened& node, Quickened variant);
+    static void despecialize(Quickened& node);
     std::shared_ptr<Module> loadModule(const std::string& module_name);
+    void executeModule(Module& module);
+    // Executes program into the module's environment as its current AST
+    void runModule(Module& module, std::shared_ptr<Program> program);
+    bool moduleChanged(const Module& module);
     
     void setupBuiltins();
+    void setupGCModule();
+    void defineBuiltin(const std::string& name, BuiltinFunction function);
 };
@@ -0,0 +1,575 @@
+#include "jit.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <unordered_set>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#define JIT_X86 1
+#endif
+
+namespace jit {
+namespace {
+
+// Thrown while generating code for anything outside the compiled subset
+struct Unsupported {
+    std::string reason;
+};
+
+// Condition codes of jcc
+enum class Cond : uint8_t {
+    B = 0x2,
+    AE = 0x3,
+    E = 0x4,
+    NE = 0x5,
+    BE = 0x6,
+    A = 0x7,
+    P = 0xA
+};
+
+// Just enough of an x86-64 assembler: scalar double arithmetic on xmm0-xmm2
+// and 8-byte frame slots addressed off rbp
+class Assembler {
+public:
+    struct Label {
+        size_t position = SIZE_MAX;
+        std::vector<size_t> fixups; // rel32 fields waiting for the position
+    };
+
+    std::vector<uint8_t> code;
+
+    void emit(std::initializer_list<uint8_t> bytes) { code.insert(code.end(), bytes); }
+    void emit32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    void emit64(uint64_t value) {
+        for (int i = 0; i < 8; ++i) code.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+    void patch32(size_t at, uint32_t value) {
+        for (int i = 0; i < 4; ++i) code[at + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    void bind(Label& label) {
+        label.position = code.size();
+        for (size_t fixup : label.fixups) {
+            patch32(fixup, static_cast<uint32_t>(label.position - (fixup + 4)));
+        }
+        label.fixups.clear();
+    }
+    void rel32(Label& label) {
+        if (label.position != SIZE_MAX) {
+            emit32(static_cast<uint32_t>(label.position - (code.size() + 4)));
+        } else {
+            label.fixups.push_back(code.size());
+            emit32(0);
+        }
+    }
+    void jmp(Label& label) { emit({0xE9}); rel32(label); }
+    void jcc(Cond cond, Label& label) { emit({0x0F, static_cast<uint8_t>(0x80 | static_cast<uint8_t>(cond))}); rel32(label); }
+    // call to the start of the code being assembled
+    void callSelf() { emit({0xE8}); emit32(static_cast<uint32_t>(0 - (code.size() + 4))); }
+
+    // movsd xmm, [rbp + offset] and back
+    void load(int xmm, int32_t offset) { emit({0xF2, 0x0F, 0x10, static_cast<uint8_t>(0x85 | xmm << 3)}); emit32(offset); }
+    void store(int32_t offset, int xmm) { emit({0xF2, 0x0F, 0x11, static_cast<uint8_t>(0x85 | xmm << 3)}); emit32(offset); }
+    // lea reg, [rbp + offset]
+    void lea(int reg, int32_t offset) { emit({0x48, 0x8D, static_cast<uint8_t>(0x85 | reg << 3)}); emit32(offset); }
+    // mov rax, bits; movq xmm, rax
+    void constant(int xmm, double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        emit({0x48, 0xB8});
+        emit64(bits);
+        emit({0x66, 0x48, 0x0F, 0x6E, static_cast<uint8_t>(0xC0 | xmm << 3)});
+    }
+    // Register to register SSE2 instruction: prefix 0F opcode /r
+    void sse(uint8_t prefix, uint8_t opcode, int dst, int src) {
+        emit({prefix, 0x0F, opcode, static_cast<uint8_t>(0xC0 | dst << 3 | src)});
+    }
+    void movapd(int dst, int src) { sse(0x66, 0x28, dst, src); }
+    void xorpd(int dst, int src) { sse(0x66, 0x57, dst, src); }
+    void ucomisd(int a, int b) { sse(0x66, 0x2E, a, b); }
+    void movEax(uint32_t value) { emit({0xB8}); emit32(value); }
+};
+
+constexpr int RDI = 7;
+constexpr int RSI = 6;
+
+// Generates code for one function. Parameters and locals live in frame slots
+// 0..fixed_slots-1, expression temporaries in the slots above them. Every
+// value is a number; conditions compile to jumps and are never materialized.
+class CodeGenerator {
+private:
+    Assembler as;
+    Symbol name;
+    std::unordered_map<Symbol, int> slots;
+    std::unordered_set<Symbol> assigned; // definitely assigned at this point
+    size_t param_count;
+    int fixed_slots = 0;
+    int used_slots = 0;
+    Assembler::Label epilogue;
+    Assembler::Label division_by_zero;
+
+public:
+    std::vector<Symbol> locals;
+    bool calls_self = false;
+
+    CodeGenerator(Symbol function_name, const std::vector<Symbol>& parameters,
+                  const BlockStatement& body)
+        : name(function_name), param_count(parameters.size()) {
+        for (const auto& param : parameters) {
+            slots.emplace(param, static_cast<int>(slots.size()));
+            assigned.insert(param);
+        }
+        collectLocals(body.statements);
+        fixed_slots = used_slots = static_cast<int>(slots.size());
+
+        // push rbp; mov rbp, rsp; push r12; push rbx (keeps rsp 16-byte
+        // aligned for self-calls); sub rsp, frame; mov r12, rsi
+        as.emit({0x55, 0x48, 0x89, 0xE5, 0x41, 0x54, 0x53, 0x48, 0x81, 0xEC});
+        size_t frame_size = as.code.size();
+        as.emit32(0);
+        as.emit({0x49, 0x89, 0xF4});
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            // movsd xmm0, [rdi + 8 * i]
+            as.emit({0xF2, 0x0F, 0x10, 0x87});
+            as.emit32(static_cast<uint32_t>(8 * i));
+            as.store(slot(static_cast<int>(i)), 0);
+        }
+
+        for (const auto& stmt : body.statements) {
+            statement(*stmt);
+        }
+        as.movEax(NO_RETURN_VALUE);
+        as.jmp(epilogue);
+        as.bind(division_by_zero);
+        as.movEax(DIVISION_BY_ZERO);
+        // lea rsp, [rbp - 16]; pop rbx; pop r12; pop rbp; ret
+        as.bind(epilogue);
+        as.emit({0x48, 0x8D, 0x65, 0xF0, 0x5B, 0x41, 0x5C, 0x5D, 0xC3});
+
+        as.patch32(frame_size, static_cast<uint32_t>((8 * used_slots + 15) & ~15));
+    }
+
+    const std::vector<uint8_t>& code() const { return as.code; }
+
+private:
+    static int32_t slot(int index) { return -24 - 8 * index; }
+
+    int temporary(int depth) {
+        used_slots = std::max(used_slots, fixed_slots + depth + 1);
+        return fixed_slots + depth;
+    }
+
+
+    void collectLocals(const std::vector<std::unique_ptr<Statement>>& statements) {
+        for (const auto& stmt : statements) {
+            switch (stmt->type) {
+                case NodeType::ASSIGNMENT_STMT: {
+                    const auto& identifier = static_cast<const AssignmentStatement&>(*stmt).identifier;
+                    if (slots.emplace(identifier, static_cast<int>(slots.size())).second) {
+                        locals.push_back(identifier);
+                    }
+                    break;
+                }
+                case NodeType::IF_STMT:
+                    collectLocalsOf(*stmt);
+                    break;
+                case NodeType::WHILE_STMT:
+                    collectLocals(static_cast<const WhileStatement&>(*stmt).body->statements);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    void collectLocalsOf(const Statement& stmt) {
+        if (stmt.type == NodeType::IF_STMT) {
+            const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+            collectLocals(if_stmt.then_branch->statements);
+            if (if_stmt.else_branch) collectLocalsOf(*if_stmt.else_branch);
+        } else if (stmt.type == NodeType::BLOCK_STMT) {
+            collectLocals(static_cast<const BlockStatement&>(stmt).statements);
+        }
+    }
+
+    // Names first defined in a block go out of scope with it
+    void block(const std::vector<std::unique_ptr<Statement>>& statements) {
+        auto outer = assigned;
+        for (const auto& stmt : statements) {
+            statement(*stmt);
+        }
+        assigned = std::move(outer);
+    }
+
+    void statement(const Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::ASSIGNMENT_STMT: {
+                const auto& assign_stmt = static_cast<const AssignmentStatement&>(stmt);
+                expression(*assign_stmt.value, 0);
+                as.store(slot(slots.at(assign_stmt.identifier)), 0);
+                assigned.insert(assign_stmt.identifier);
+                break;
+            }
+
+            case NodeType::IF_STMT: {
+                const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+                Assembler::Label otherwise, done;
+                condition(*if_stmt.condition, false, otherwise, 0);
+                block(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) {
+                    as.jmp(done);
+                    as.bind(otherwise);
+                    if (if_stmt.else_branch->type == NodeType::BLOCK_STMT) {
+                        block(static_cast<const BlockStatement&>(*if_stmt.else_branch).statements);
+                    } else {
+                        statement(*if_stmt.else_branch);
+                    }
+                } else {
+                    as.bind(otherwise);
+                }
+                as.bind(done);
+                break;
+            }
+
+            case NodeType::WHILE_STMT: {
+                const auto& while_stmt = static_cast<const WhileStatement&>(stmt);
+                Assembler::Label top, done;
+                as.bind(top);
+                condition(*while_stmt.condition, false, done, 0);
+                block(while_stmt.body->statements);
+                as.jmp(top);
+                as.bind(done);
+                break;
+            }
+
+            case NodeType::RETURN_STMT: {
+                const auto& return_stmt = static_cast<const ReturnStatement&>(stmt);
+                if (return_stmt.value) {
+                    expression(*return_stmt.value, 0);
+                    // movsd [r12], xmm0; xor eax, eax
+                    as.emit({0xF2, 0x41, 0x0F, 0x11, 0x04, 0x24, 0x31, 0xC0});
+                } else {
+                    as.movEax(NO_RETURN_VALUE);
+                }
+                as.jmp(epilogue);
+                break;
+            }
+
+            default:
+                throw Unsupported{"statement not supported"};
+        }
+    }
+
+    // Evaluates a number into xmm0, using temporaries from depth up
+    void expression(const Expression& expr, int depth) {
+        switch (expr.type) {
+            case NodeType::NUMBER_EXPR:
+                as.constant(0, static_cast<const NumberExpression&>(expr).value);
+                break;
+
+            case NodeType::IDENTIFIER_EXPR: {
+                const auto& identifier = static_cast<const IdentifierExpression&>(expr).name;
+                auto it = slots.find(identifier);
+                if (it == slots.end() || !assigned.count(identifier)) {
+                    throw Unsupported{"reads '" + identifier + "', which is not a local"};
+                }
+                as.load(0, slot(it->second));
+                break;
+            }
+
+            case NodeType::UNARY_EXPR: {
+                const auto& un_expr = static_cast<const UnaryExpression&>(expr);
+                if (un_expr.operator_type != TokenType::MINUS) {
+                    throw Unsupported{"'not' used as a value"};
+                }
+                expression(*un_expr.operand, depth);
+                as.constant(1, -0.0);
+                as.xorpd(0, 1);
+                break;
+            }
+
+            case NodeType::BINARY_EXPR: {
+                const auto& bin_expr = static_cast<const BinaryExpression&>(expr);
+                uint8_t opcode;
+                switch (bin_expr.operator_type) {
+                    case TokenType::PLUS: opcode = 0x58; break;
+                    case TokenType::MINUS: opcode = 0x5C; break;
+                    case TokenType::MULTIPLY: opcode = 0x59; break;
+                    case TokenType::DIVIDE: opcode = 0x5E; break;
+                    default: throw Unsupported{"operator not supported in a value"};
+                }
+                operands(bin_expr, depth);
+                if (bin_expr.operator_type == TokenType::DIVIDE) {
+                    // The interpreter raises on a zero divisor (but not on NaN)
+                    Assembler::Label nonzero;
+                    as.xorpd(2, 2);
+                    as.ucomisd(1, 2);
+                    as.jcc(Cond::P, nonzero);
+                    as.jcc(Cond::E, division_by_zero);
+                    as.bind(nonzero);
+                }
+                as.sse(0xF2, opcode, 0, 1);
+                break;
+            }
+
+            case NodeType::CALL_EXPR:
+                selfCall(static_cast<const CallExpression&>(expr), depth);
+                break;
+
+            default:
+                throw Unsupported{"expression not supported"};
+        }
+    }
+
+    // Left operand into xmm0, right into xmm1
+    void operands(const BinaryExpression& expr, int depth) {
+        expression(*expr.left, depth);
+        as.store(slot(temporary(depth)), 0);
+        expression(*expr.right, depth + 1);
+        as.movapd(1, 0);
+        as.load(0, slot(temporary(depth)));
+    }
+
+    void selfCall(const CallExpression& call, int depth) {
+        if (call.callee->type != NodeType::IDENTIFIER_EXPR ||
+            static_cast<const IdentifierExpression&>(*call.callee).name != name || slots.count(name)) {
+            throw Unsupported{"calls a function other than itself"};
+        }
+        int argc = static_cast<int>(call.arguments.size());
+        if (call.arguments.size() != param_count) {
+            throw Unsupported{"calls itself with the wrong number of arguments"};
+        }
+        // The arguments array grows upwards in memory, frame slots downwards
+        for (int i = 0; i < argc; ++i) {
+            expression(*call.arguments[i], depth + argc);
+            as.store(slot(temporary(depth + argc - 1 - i)), 0);
+        }
+        as.lea(RDI, slot(temporary(depth + std::max(argc - 1, 0))));
+        as.lea(RSI, slot(temporary(depth)));
+        as.callSelf();
+        // test eax, eax; a deoptimizing callee deoptimizes the caller
+        as.emit({0x85, 0xC0});
+        as.jcc(Cond::NE, epilogue);
+        as.load(0, slot(temporary(depth)));
+        calls_self = true;
+    }
+
+    // True if evaluating expr cannot deoptimize (or recurse)
+    static bool total(const Expression& expr) {
+        switch (expr.type) {
+            case NodeType::UNARY_EXPR:
+                return total(*static_cast<const UnaryExpression&>(expr).operand);
+            case NodeType::BINARY_EXPR: {
+                const auto& bin_expr = static_cast<const BinaryExpression&>(expr);
+                return bin_expr.operator_type != TokenType::DIVIDE && total(*bin_expr.left) && total(*bin_expr.right);
+            }
+            case NodeType::CALL_EXPR:
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    // Jumps to target if the truthiness of expr is jump_when
+    void condition(const Expression& expr, bool jump_when, Assembler::Label& target, int depth) {
+        if (expr.type == NodeType::BOOLEAN_EXPR) {
+            if (static_cast<const BooleanExpression&>(expr).value == jump_when) {
+                as.jmp(target);
+            }
+            return;
+        }
+        if (expr.type == NodeType::UNARY_EXPR &&
+            static_cast<const UnaryExpression&>(expr).operator_type == TokenType::NOT) {
+            condition(*static_cast<const UnaryExpression&>(expr).operand, !jump_when, target, depth);
+            return;
+        }
+        if (expr.type != NodeType::BINARY_EXPR) {
+            expression(expr, depth);
+            as.xorpd(1, 1);
+            compare(TokenType::NOT_EQUAL, jump_when, target);
+            return;
+        }
+
+        const auto& bin_expr = static_cast<const BinaryExpression&>(expr);
+        switch (bin_expr.operator_type) {
+            case TokenType::AND:
+            case TokenType::OR: {
+                // The interpreter evaluates both operands; short-circuiting
+                // is only equivalent when neither can fail
+                if (!total(*bin_expr.left) || !total(*bin_expr.right)) {
+                    throw Unsupported{"and/or operand may raise"};
+                }
+                bool is_and = bin_expr.operator_type == TokenType::AND;
+                if (is_and != jump_when) {
+                    // Either operand alone decides
+                    condition(*bin_expr.left, jump_when, target, depth);
+                    condition(*bin_expr.right, jump_when, target, depth);
+                } else {
+                    Assembler::Label skip;
+                    condition(*bin_expr.left, !jump_when, skip, depth);
+                    condition(*bin_expr.right, jump_when, target, depth);
+                    as.bind(skip);
+                }
+                break;
+            }
+
+            case TokenType::EQUAL:
+            case TokenType::NOT_EQUAL:
+            case TokenType::LESS:
+            case TokenType::LESS_EQUAL:
+            case TokenType::GREATER:
+            case TokenType::GREATER_EQUAL:
+                operands(bin_expr, depth);
+                compare(bin_expr.operator_type, jump_when, target);
+                break;
+
+            default:
+                expression(expr, depth);
+                as.xorpd(1, 1);
+                compare(TokenType::NOT_EQUAL, jump_when, target);
+                break;
+        }
+    }
+
+    // Compares xmm0 with xmm1. An unordered result (NaN) sets ZF, PF and CF,
+    // so the jumps are picked to make every comparison with NaN false except !=
+    void compare(TokenType op, bool jump_when, Assembler::Label& target) {
+        switch (op) {
+            case TokenType::LESS:
+                as.ucomisd(1, 0);
+                as.jcc(jump_when ? Cond::A : Cond::BE, target);
+                break;
+            case TokenType::LESS_EQUAL:
+                as.ucomisd(1, 0);
+                as.jcc(jump_when ? Cond::AE : Cond::B, target);
+                break;
+            case TokenType::GREATER:
+                as.ucomisd(0, 1);
+                as.jcc(jump_when ? Cond::A : Cond::BE, target);
+                break;
+            case TokenType::GREATER_EQUAL:
+                as.ucomisd(0, 1);
+                as.jcc(jump_when ? Cond::AE : Cond::B, target);
+                break;
+            default: {
+                as.ucomisd(0, 1);
+                if ((op == TokenType::EQUAL) == jump_when) {
+                    // Equal: ZF set and PF clear
+                    Assembler::Label unordered;
+                    as.jcc(Cond::P, unordered);
+                    as.jcc(Cond::E, target);
+                    as.bind(unordered);
+                } else {
+                    as.jcc(Cond::NE, target);
+                    as.jcc(Cond::P, target);
+                }
+                break;
+            }
+        }
+    }
+};
+
+} // namespace
+
+Compiler::Compiler(bool log, bool perf_map) : log(log) {
+    if (perf_map) {
+        std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+        this->perf_map = std::fopen(path.c_str(), "w");
+        if (!this->perf_map) {
+            std::cerr << "[jit] could not open " << path << std::endl;
+        }
+    }
+}
+
+Compiler::~Compiler() {
+    for (const auto& region : regions) {
+        munmap(region.address, region.size);
+    }
+    if (perf_map) std::fclose(perf_map);
+}
+
+CompiledFunction* Compiler::compile(Symbol name, const std::vector<Symbol>& parameters,
+                                    const BlockStatement& body) {
+    auto cached = compiled.find(&body);
+    if (cached != compiled.end()) {
+        return cached->second.get();
+    }
+    auto& entry = compiled[&body];
+
+    auto reject = [&](const std::string& reason) -> CompiledFunction* {
+        if (log) std::cerr << "[jit] " << name << ": not compiled, " << reason << std::endl;
+        return nullptr;
+    };
+    if (parameters.size() > MAX_PARAMS) {
+        return reject("more than " + std::to_string(MAX_PARAMS) + " parameters");
+    }
+
+    auto code = std::make_unique<CompiledFunction>();
+    std::vector<uint8_t> bytes;
+    try {
+        CodeGenerator generator(name, parameters, body);
+        bytes = generator.code();
+        code->locals = std::move(generator.locals);
+        code->calls_self = generator.calls_self;
+    } catch (const Unsupported& unsupported) {
+        return reject(unsupported.reason);
+    }
+
+#ifdef JIT_X86
+    // Written while writable, then made executable (never both)
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (bytes.size() + page - 1) / page * page;
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED) {
+        return reject("could not map code memory");
+    }
+    std::memcpy(address, bytes.data(), bytes.size());
+    if (mprotect(address, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(address, size);
+        return reject("could not make code executable");
+    }
+    regions.push_back({address, size});
+
+    code->name = name;
+    code->entry = reinterpret_cast<EntryPoint>(address);
+    code->code_size = bytes.size();
+    if (log) {
+        std::cerr << "[jit] " << name << ": compiled " << bytes.size() << " bytes at " << address << std::endl;
+    }
+    if (perf_map) {
+        std::fprintf(perf_map, "%lx %zx jit:%s\n", reinterpret_cast<unsigned long>(address), bytes.size(),
+                     name.str().c_str());
+        std::fflush(perf_map);
+    }
+    entry = std::move(code);
+    return entry.get();
+#else
+    return reject("not supported on this platform");
+#endif
+}
+
+void Compiler::deoptimized(CompiledFunction& code, const std::string& reason) {
+    ++code.deopts;
+    if (log) {
+        std::cerr << "[jit] " << code.name << ": deoptimized, " << reason;
+        if (code.deopts == MAX_DEOPTS) std::cerr << " (giving up on compiled code)";
+        std::cerr << std::endl;
+    }
+}
+
+const char* Compiler::exitReason(int exit) {
+    switch (exit) {
+        case DIVISION_BY_ZERO: return "division by zero";
+        case NO_RETURN_VALUE: return "no return value";
+        default: return "unknown exit";
+    }
+}
+
+} // namespace jit
@@ -0,0 +1,82 @@
+#pragma once
+#include "parser.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Baseline method JIT for numeric functions (x86-64).
+//
+// A function is compiled to machine code once it has been called
+// CALL_THRESHOLD times, provided its body stays within a numeric subset:
+// parameters and locals holding numbers, + - * / and unary minus,
+// comparisons, and/or/not and number truthiness in conditions, if/else,
+// while, return and calls to the function itself. Anything else (globals,
+// other calls, strings, containers, ...) leaves the function interpreted.
+//
+// Compiled code has no effects besides its result, so deoptimizing is just
+// running the call again in the interpreter. The interpreter checks the
+// assumptions the code was compiled under before entering it (see
+// CompiledFunction), and the code bails out itself wherever the interpreter
+// would do something it does not: raising "Division by zero" or returning None.
+namespace jit {
+
+constexpr unsigned CALL_THRESHOLD = 100;
+constexpr unsigned MAX_DEOPTS = 20;   // compiled code is abandoned after this many
+constexpr size_t MAX_PARAMS = 16;
+
+// Why compiled code gave control back; OK means *result was set
+enum Exit : int {
+    OK = 0,
+    DIVISION_BY_ZERO = 1,
+    NO_RETURN_VALUE = 2
+};
+
+using EntryPoint = int (*)(const double* args, double* result);
+
+struct CompiledFunction {
+    std::string name;
+    EntryPoint entry = nullptr;
+    size_t code_size = 0;
+    // Assigned names the code keeps in its frame. Only valid while none of
+    // them is bound in the closure: the interpreter would assign that binding.
+    std::vector<Symbol> locals;
+    // Self-calls are direct, valid while the name resolves to the function
+    bool calls_self = false;
+    unsigned deopts = 0;
+};
+
+class Compiler {
+private:
+    struct CodeRegion {
+        void* address;
+        size_t size;
+    };
+    std::vector<CodeRegion> regions;
+    // Keyed by body so closures of one definition share their code; null for
+    // bodies that cannot be compiled
+    std::unordered_map<const BlockStatement*, std::unique_ptr<CompiledFunction>> compiled;
+    bool log;
+    FILE* perf_map = nullptr;
+
+public:
+    // log reports compilations and deoptimizations on stderr; perf_map
+    // writes /tmp/perf-PID.map so perf can symbolize compiled code
+    Compiler(bool log, bool perf_map);
+    Compiler(const Compiler&) = delete;
+    Compiler& operator=(const Compiler&) = delete;
+    ~Compiler();
+
+    // Code for a function body, compiled on the first request; nullptr if the
+    // body is outside the compiled subset
+    CompiledFunction* compile(Symbol name, const std::vector<Symbol>& parameters,
+                              const BlockStatement& body);
+
+    // Records that code could not be used for a call; reason is for the log
+    void deoptimized(CompiledFunction& code, const std::string& reason);
+
+    static const char* exitReason(int exit);
+};
+
+} // namespace jit
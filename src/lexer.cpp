@@ -1,15 +1,19 @@
 #include "lexer.h"
-#include <unordered_map>
-#include <cctype>
+#include "scan.h"
+#include "char_class.h"
+#include <array>
+#include <cstdint>
+#include <algorithm>
 #include <iostream>
 
-Lexer::Lexer(const std::string& source) 
-    : source(source), current(0), line(1), column(1), at_line_start(true) {
+Lexer::Lexer(const std::string& source, int start_line) 
+    : source(source), current(0), line(start_line), column(1), at_line_start(true) {
     indent_stack.push_back(0); // Start with no indentation
 }
 
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
+    tokens.reserve(source.size() / 4); // typical source has a token every few bytes
     
     while (!isAtEnd()) {
         if (at_line_start) {
@@ -25,6 +29,7 @@ std::vector<Token> Lexer::tokenize() {
             case '\r':
             case '\t':
                 // Skip whitespace (except at line start)
+                skipSpan(scan::blankRun(cursor(), sourceEnd()));
                 break;
                 
             case '\n':
@@ -36,7 +41,7 @@ std::vector<Token> Lexer::tokenize() {
                 
             case '#':
                 // Skip comments
-                while (peek() != '\n' && !isAtEnd()) advance();
+                skipSpan(scan::findLineEnd(cursor(), sourceEnd()));
                 break;
                 
             case '+':
@@ -61,17 +66,30 @@ std::vector<Token> Lexer::tokenize() {
                 if (peek() == '*') {
                     advance();
                     tokens.push_back(makeToken(TokenType::POWER, "**"));
+                } else if (peek() == '=') {
+                    advance();
+                    tokens.push_back(makeToken(TokenType::MULTIPLY_ASSIGN, "*="));
                 } else {
                     tokens.push_back(makeToken(TokenType::MULTIPLY, "*"));
                 }
                 break;
                 
             case '/':
-                tokens.push_back(makeToken(TokenType::DIVIDE, "/"));
+                if (peek() == '=') {
+                    advance();
+                    tokens.push_back(makeToken(TokenType::DIVIDE_ASSIGN, "/="));
+                } else {
+                    tokens.push_back(makeToken(TokenType::DIVIDE, "/"));
+                }
                 break;
                 
             case '%':
-                tokens.push_back(makeToken(TokenType::MODULO, "%"));
+                if (peek() == '=') {
+                    advance();
+                    tokens.push_back(makeToken(TokenType::MODULO_ASSIGN, "%="));
+                } else {
+                    tokens.push_back(makeToken(TokenType::MODULO, "%"));
+                }
                 break;
                 
             case '=':
@@ -157,10 +175,10 @@ std::vector<Token> Lexer::tokenize() {
                 break;
                 
             default:
-                if (std::isdigit(c)) {
+                if (charclass::isDigit(c)) {
                     current--; // Back up to include digit
                     tokens.push_back(number());
-                } else if (std::isalpha(c) || c == '_') {
+                } else if (charclass::isIdentifierStart(c)) {
                     current--; // Back up to include first character
                     tokens.push_back(identifier());
                 } else {
@@ -170,6 +188,14 @@ std::vector<Token> Lexer::tokenize() {
         }
     }
     
+    // The last real token opens a block, or the last line is still indented
+    auto last = std::find_if(tokens.rbegin(), tokens.rend(), [](const Token& token) {
+        return token.type != TokenType::NEWLINE && token.type != TokenType::INDENT &&
+               token.type != TokenType::DEDENT;
+    });
+    ends_inside_block = indent_stack.size() > 1 ||
+                        (last != tokens.rend() && last->type == TokenType::COLON);
+    
     // Handle final dedents
     while (indent_stack.size() > 1) {
         indent_stack.pop_back();
@@ -199,33 +225,39 @@ char Lexer::peekNext() {
     return source[current + 1];
 }
 
-Token Lexer::makeToken(TokenType type, const std::string& value) {
-    return Token(type, value, line, column);
+Token Lexer::makeToken(TokenType type, std::string value) {
+    return Token(type, std::move(value), line, column, static_cast<int>(current));
+}
+
+void Lexer::skipSpan(size_t length) {
+    current += length;
+    column += static_cast<int>(length);
 }
 
 Token Lexer::number() {
-    std::string value;
-    
-    while (std::isdigit(peek())) {
-        value += advance();
-    }
+    size_t start = current;
+    skipSpan(scan::digitRun(cursor(), sourceEnd()));
     
     // Look for decimal point
-    if (peek() == '.' && std::isdigit(peekNext())) {
-        value += advance(); // Consume '.'
-        while (std::isdigit(peek())) {
-            value += advance();
-        }
+    if (peek() == '.' && charclass::isDigit(peekNext())) {
+        advance(); // Consume '.'
+        skipSpan(scan::digitRun(cursor(), sourceEnd()));
     }
     
-    return makeToken(TokenType::NUMBER, value);
+    return makeToken(TokenType::NUMBER, source.substr(start, current - start));
 }
 
 Token Lexer::string() {
     char quote = advance(); // Consume opening quote
     std::string value;
     
-    while (peek() != quote && !isAtEnd()) {
+    while (!isAtEnd()) {
+        // Copy the plain run up to the next quote, backslash or newline
+        size_t run = scan::findStringStop(cursor(), sourceEnd(), quote);
+        value.append(cursor(), run);
+        skipSpan(run);
+        
+        if (isAtEnd() || peek() == quote) break;
         if (peek() == '\n') line++;
         if (peek() == '\\') {
             advance(); // Consume backslash
@@ -249,49 +281,107 @@ Token Lexer::string() {
     }
     
     advance(); // Consume closing quote
-    return makeToken(TokenType::STRING, value);
+    return makeToken(TokenType::STRING, std::move(value));
 }
 
 Token Lexer::identifier() {
-    std::string value;
+    size_t start = current;
+    skipSpan(scan::identifierRun(cursor(), sourceEnd()));
+    std::string_view text(source.data() + start, current - start);
     
-    while (std::isalnum(peek()) || peek() == '_') {
-        value += advance();
-    }
-    
-    TokenType type = identifierType(value);
-    return makeToken(type, value);
+    return makeToken(identifierType(text), std::string(text));
 }
 
-TokenType Lexer::identifierType(const std::string& text) {
-    static std::unordered_map<std::string, TokenType> keywords = {
-        {"if", TokenType::IF},
-        {"elif", TokenType::ELIF},
-        {"else", TokenType::ELSE},
-        {"while", TokenType::WHILE},
-        {"for", TokenType::FOR},
-        {"in", TokenType::IN},
-        {"def", TokenType::DEF},
-        {"return", TokenType::RETURN},
-        {"class", TokenType::CLASS},
-        {"import", TokenType::IMPORT},
-        {"from", TokenType::FROM},
-        {"as", TokenType::AS},
-        {"try", TokenType::TRY},
-        {"except", TokenType::EXCEPT},
-        {"True", TokenType::TRUE},
-        {"False", TokenType::FALSE},
-        {"None", TokenType::NONE},
-        {"and", TokenType::AND},
-        {"or", TokenType::OR},
-        {"not", TokenType::NOT}
-    };
+namespace {
+
+// Keywords are found with a perfect hash chosen at compile time: a hash of
+// the first and last character and the length that maps every keyword to
+// its own slot, so a lookup is one table load and one compare.
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword keywords[] = {
+    {"if", TokenType::IF},
+    {"elif", TokenType::ELIF},
+    {"else", TokenType::ELSE},
+    {"while", TokenType::WHILE},
+    {"for", TokenType::FOR},
+    {"in", TokenType::IN},
+    {"def", TokenType::DEF},
+    {"return", TokenType::RETURN},
+    {"class", TokenType::CLASS},
+    {"import", TokenType::IMPORT},
+    {"from", TokenType::FROM},
+    {"as", TokenType::AS},
+    {"try", TokenType::TRY},
+    {"except", TokenType::EXCEPT},
+    {"True", TokenType::TRUE},
+    {"False", TokenType::FALSE},
+    {"None", TokenType::NONE},
+    {"and", TokenType::AND},
+    {"or", TokenType::OR},
+    {"not", TokenType::NOT},
+    {"yield", TokenType::YIELD}
+};
+
+constexpr size_t KEYWORD_COUNT = sizeof(keywords) / sizeof(keywords[0]);
+constexpr unsigned KEYWORD_SLOTS = 32; // power of two
+
+struct KeywordHash {
+    unsigned first_multiplier;
+    unsigned last_multiplier;
     
-    auto it = keywords.find(text);
-    if (it != keywords.end()) {
-        return it->second;
+    constexpr unsigned operator()(std::string_view text) const {
+        unsigned first = static_cast<unsigned char>(text.front());
+        unsigned last = static_cast<unsigned char>(text.back());
+        return (first * first_multiplier + last * last_multiplier +
+                static_cast<unsigned>(text.size())) & (KEYWORD_SLOTS - 1);
+    }
+};
+
+constexpr KeywordHash findKeywordHash() {
+    for (unsigned a = 1; a < 64; ++a) {
+        for (unsigned b = 0; b < 64; ++b) {
+            KeywordHash hash{a, b};
+            uint32_t used = 0;
+            bool collision = false;
+            for (const auto& keyword : keywords) {
+                uint32_t bit = 1u << hash(keyword.text);
+                collision = collision || (used & bit);
+                used |= bit;
+            }
+            if (!collision) return hash;
+        }
+    }
+    return {0, 0};
+}
+
+constexpr KeywordHash keyword_hash = findKeywordHash();
+static_assert(keyword_hash.first_multiplier != 0, "no perfect hash for the keyword set");
+
+constexpr std::array<int8_t, KEYWORD_SLOTS> makeKeywordSlots() {
+    std::array<int8_t, KEYWORD_SLOTS> slots{};
+    for (auto& slot : slots) slot = -1;
+    for (size_t i = 0; i < KEYWORD_COUNT; ++i) {
+        slots[keyword_hash(keywords[i].text)] = static_cast<int8_t>(i);
+    }
+    return slots;
+}
+
+constexpr std::array<int8_t, KEYWORD_SLOTS> keyword_slots = makeKeywordSlots();
+
+} // namespace
+
+TokenType Lexer::identifierType(std::string_view text) {
+    if (text.empty()) {
+        return TokenType::IDENTIFIER;
+    }
+    int index = keyword_slots[keyword_hash(text)];
+    if (index >= 0 && keywords[index].text == text) {
+        return keywords[index].type;
     }
-    
     return TokenType::IDENTIFIER;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 enum class TokenType {
@@ -29,6 +31,7 @@ enum class TokenType {
     AND,
     OR,
     NOT,
+    YIELD,
     
     // Operators
     PLUS,
@@ -40,6 +43,9 @@ enum class TokenType {
     ASSIGN,
     PLUS_ASSIGN,
     MINUS_ASSIGN,
+    MULTIPLY_ASSIGN,
+    DIVIDE_ASSIGN,
+    MODULO_ASSIGN,
     
     // Comparison
     EQUAL,
@@ -76,9 +82,10 @@ struct Token {
     std::string value;
     int line;
     int column;
+    int offset; // byte offset in the source just past the token
     
-    Token(TokenType t, const std::string& v, int l, int c)
-        : type(t), value(v), line(l), column(c) {}
+    Token(TokenType t, std::string v, int l, int c, int o = 0)
+        : type(t), value(std::move(v)), line(l), column(c), offset(o) {}
 };
 
 class Lexer {
@@ -89,21 +96,32 @@ private:
     int column;
     std::vector<int> indent_stack;
     bool at_line_start;
+    bool ends_inside_block = false;
     
 public:
-    Lexer(const std::string& source);
+    // start_line numbers the tokens of a fragment taken from a larger file
+    Lexer(const std::string& source, int start_line = 1);
     std::vector<Token> tokenize();
     
+    // After tokenize(): true if the source stops after a ':' or inside an
+    // indented block, i.e. an interactive reader should ask for more lines
+    bool endsInsideBlock() const { return ends_inside_block; }
+    
+    // Keyword token type for an identifier, or IDENTIFIER
+    static TokenType identifierType(std::string_view text);
+    
 private:
     bool isAtEnd();
     char advance();
     char peek();
     char peekNext();
+    const char* cursor() const { return source.data() + current; }
+    const char* sourceEnd() const { return source.data() + source.size(); }
+    void skipSpan(size_t length);
     void skipWhitespace();
-    Token makeToken(TokenType type, const std::string& value = "");
+    Token makeToken(TokenType type, std::string value = "");
     Token number();
     Token string();
     Token identifier();
-    TokenType identifierType(const std::string& text);
     std::vector<Token> handleIndentation();
 };
@@ -2,9 +2,14 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <unistd.h>
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "parallel_parser.h"
+#include "flat_ast.h"
+#include "snapshot.h"
+#include "emit_cpp.h"
 
 std::string readFile(const std::string& filename) {
     std::ifstream file(filename);
@@ -17,53 +22,269 @@ std::string readFile(const std::string& filename) {
     return buffer.str();
 }
 
-void runInterpreter(const std::string& source) {
+// Function bodies parsed at load time versus on first call (--lazy-parse)
+void printLazyParseStats() {
+    const LazyParseStats& stats = Parser::lazyStats();
+    size_t never = stats.deferred_functions - stats.parsed_on_call;
+    std::cerr << "[lazy-parse] eager: " << stats.eager_functions << " function(s), "
+              << stats.eager_bytes << " bytes; deferred: " << stats.deferred_functions << " function(s), "
+              << stats.deferred_bytes << " bytes, of which parsed on first call: " << stats.parsed_on_call
+              << " function(s), " << stats.parsed_on_call_bytes << " bytes; never parsed: " << never
+              << " function(s), " << stats.deferred_bytes - stats.parsed_on_call_bytes << " bytes" << std::endl;
+}
+
+// Operator nodes that specialized to their operand types (--quickening-stats)
+void printQuickeningStats() {
+    const QuickeningStats& stats = Interpreter::quickeningStats();
+    std::cerr << "[quickening] " << stats.specialized << " node(s) specialized, " << stats.deoptimized
+              << " deoptimized back to generic" << std::endl;
+}
+
+// Files read or written around a run, as opposed to interpreter behaviour
+struct RunFiles {
+    std::string save_ast;      // --save-ast
+    std::string snapshot;      // --snapshot: heap to restore before running
+    std::string save_snapshot; // --save-snapshot: heap to save after running
+    std::string emit_cpp;      // --emit-cpp: C++ source to generate instead of running
+    std::string emit_exe;      // --emit-exe: executable to build instead of running
+    std::string source_name = "<demo>";
+};
+
+// Writes the program as C++ (and builds it) if asked to; true if it should not run
+bool emitNative(const Program& program, const RunFiles& files) {
+    if (files.emit_cpp.empty() && files.emit_exe.empty()) {
+        return false;
+    }
+    std::string cpp_path = files.emit_cpp.empty() ? files.emit_exe + ".cpp" : files.emit_cpp;
+    CppEmitter::write(program, files.source_name, cpp_path);
+    if (!files.emit_exe.empty()) {
+        CppEmitter::compile(cpp_path, files.emit_exe);
+    }
+    return true;
+}
+
+void runInterpreter(const std::string& source, const InterpreterOptions& options = InterpreterOptions(),
+                    const RunFiles& files = RunFiles()) {
     try {
-        // Lexical analysis
-        Lexer lexer(source);
-        auto tokens = lexer.tokenize();
-        
-        std::cout << "=== Tokens ===" << std::endl;
-        for (const auto& token : tokens) {
-            std::cout << "Type: " << static_cast<int>(token.type) 
-                      << ", Value: '" << token.value << "'" 
-                      << ", Line: " << token.line << std::endl;
+        std::unique_ptr<Program> program;
+        if (options.parse_threads != 1) {
+            // Chunks are lexed on worker threads, so there is no token listing
+            program = ParallelParser::parse(source, options.parse_threads, options.lazy_parse);
+        } else {
+            // Lexical analysis
+            Lexer lexer(source);
+            auto tokens = lexer.tokenize();
+            
+            std::cout << "=== Tokens ===" << std::endl;
+            for (const auto& token : tokens) {
+                std::cout << "Type: " << static_cast<int>(token.type) 
+                          << ", Value: '" << token.value << "'" 
+                          << ", Line: " << token.line << std::endl;
+            }
+            std::cout << std::endl;
+            
+            // Parsing
+            Parser parser(std::move(tokens));
+            parser.setDeferFunctionBodies(options.lazy_parse);
+            program = parser.parse();
         }
+        
+        std::cout << "=== Parsing completed ===" << std::endl;
+        std::cout << "Statements: " << program->statements.size() << std::endl;
         std::cout << std::endl;
         
-        // Parsing
-        Parser parser(std::move(tokens));
-        auto program = parser.parse();
+        if (!files.save_ast.empty()) {
+            flat::FlatAst(*program).write(files.save_ast);
+        }
         
-        std::cout << "=== Parsing completed ===" << std::endl;
+        if (!emitNative(*program, files)) {
+            // Interpretation
+            std::cout << "=== Execution ===" << std::endl;
+            Interpreter interpreter(options);
+            if (!files.snapshot.empty()) {
+                Snapshot::restore(interpreter, files.snapshot);
+            }
+            interpreter.interpret(*program);
+            if (!files.save_snapshot.empty()) {
+                Snapshot::save(interpreter, files.save_snapshot, *program);
+            }
+        }
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+    
+    if (options.lazy_parse) {
+        printLazyParseStats();
+    }
+}
+
+// Runs a program saved with --save-ast; the file is mapped, not lexed or parsed
+void runFlatAst(const std::string& filename, const InterpreterOptions& options, const RunFiles& files) {
+    try {
+        flat::MappedFlatAst mapped(filename);
+        auto program = mapped.view().inflate();
+        
+        std::cout << "=== Loaded flat AST ===" << std::endl;
         std::cout << "Statements: " << program->statements.size() << std::endl;
         std::cout << std::endl;
         
-        // Interpretation
+        if (emitNative(*program, files)) {
+            return;
+        }
+        
         std::cout << "=== Execution ===" << std::endl;
-        Interpreter interpreter;
+        Interpreter interpreter(options);
+        if (!files.snapshot.empty()) {
+            Snapshot::restore(interpreter, files.snapshot);
+        }
         interpreter.interpret(*program);
+        if (!files.save_snapshot.empty()) {
+            Snapshot::save(interpreter, files.save_snapshot, *program);
+        }
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
 }
 
+bool isBlank(const std::string& line) {
+    return line.find_first_not_of(" \t\r") == std::string::npos;
+}
+
+void runRepl(const InterpreterOptions& options, const RunFiles& files) {
+    // One interpreter for the whole session, so definitions persist
+    Interpreter interpreter(options);
+    if (!files.snapshot.empty()) {
+        try {
+            Snapshot::restore(interpreter, files.snapshot);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    }
+    
+    // Functions and classes point into their AST, so every parsed block is kept
+    std::vector<std::unique_ptr<Program>> programs;
+    
+    bool interactive = isatty(STDIN_FILENO);
+    std::string block;
+    std::string line;
+    
+    while (true) {
+        if (interactive) {
+            std::cout << (block.empty() ? ">>> " : "... ") << std::flush;
+        }
+        if (!std::getline(std::cin, line)) {
+            if (block.empty()) break;
+            line.clear(); // end of input completes a pending block
+        } else if (block.empty() && isBlank(line)) {
+            continue;
+        }
+        
+        // Only the block being entered is lexed and parsed
+        block += line + "\n";
+        Lexer lexer(block);
+        auto tokens = lexer.tokenize();
+        
+        // An indented block ends with a blank line
+        if (lexer.endsInsideBlock() && !isBlank(line)) {
+            continue;
+        }
+        
+        try {
+            // Pick up edited modules before running the next query
+            if (options.watch_modules) {
+                interpreter.reloadChangedModules();
+            }
+            Parser parser(std::move(tokens));
+            parser.setDeferFunctionBodies(options.lazy_parse);
+            programs.push_back(parser.parse());
+            interpreter.interpretInteractive(*programs.back());
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+        block.clear();
+        
+        if (std::cin.eof()) break;
+    }
+    
+    if (interactive) {
+        std::cout << std::endl;
+    }
+    
+    if (options.lazy_parse) {
+        printLazyParseStats();
+    }
+}
+
 int main(int argc, char* argv[]) {
     std::cout << "Python-like Language Parser and Interpreter" << std::endl;
     std::cout << "============================================" << std::endl;
     
-    if (argc > 1) {
+    InterpreterOptions options;
+    std::string filename;
+    RunFiles files;
+    bool demo = false;
+    bool quickening_stats = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--demo") {
+            demo = true;
+        } else if (arg == "--parallel-parse") {
+            options.parse_threads = 0;
+        } else if (arg.rfind("--parallel-parse=", 0) == 0) {
+            options.parse_threads = static_cast<unsigned>(std::stoul(arg.substr(17)));
+        } else if (arg.rfind("--save-ast=", 0) == 0) {
+            files.save_ast = arg.substr(11);
+        } else if (arg.rfind("--snapshot=", 0) == 0) {
+            files.snapshot = arg.substr(11);
+        } else if (arg.rfind("--save-snapshot=", 0) == 0) {
+            files.save_snapshot = arg.substr(16);
+        } else if (arg.rfind("--emit-cpp=", 0) == 0) {
+            files.emit_cpp = arg.substr(11);
+        } else if (arg.rfind("--emit-exe=", 0) == 0) {
+            files.emit_exe = arg.substr(11);
+        } else if (arg == "--lazy-parse") {
+            options.lazy_parse = true;
+        } else if (arg == "--jit") {
+            options.jit = true;
+        } else if (arg == "--no-jit") {
+            options.jit = false;
+        } else if (arg == "--jit-log") {
+            options.jit_log = true;
+        } else if (arg == "--jit-perf-map") {
+            options.jit_perf_map = true;
+        } else if (arg == "--type-report") {
+            options.type_report = true;
+        } else if (arg == "--quickening-stats") {
+            quickening_stats = true;
+        } else if (arg == "--watch") {
+            options.watch_modules = true;
+        } else if (arg == "--dump-closures") {
+            options.dump_closures = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            filename = arg;
+            files.source_name = arg;
+        }
+    }
+    
+    if (!filename.empty()) {
         // Run file
         try {
-            std::string source = readFile(argv[1]);
-            runInterpreter(source);
+            if (flat::MappedFlatAst::isFlatAstFile(filename)) {
+                runFlatAst(filename, options, files);
+            } else {
+                std::string source = readFile(filename);
+                runInterpreter(source, options, files);
+            }
         } catch (const std::exception& e) {
             std::cerr << "Error reading file: " << e.what() << std::endl;
             return 1;
         }
-    } else {
-        // Interactive mode / demo
+    } else if (demo) {
         std::cout << "Running demo program..." << std::endl << std::endl;
         
         std::string demo_code = R"(
@@ -88,8 +309,14 @@ while counter < 3:
 print("Done!")
 )";
         
-        runInterpreter(demo_code);
+        runInterpreter(demo_code, options, files);
+    } else {
+        // Interactive mode
+        runRepl(options, files);
     }
     
+    if (quickening_stats) {
+        printQuickeningStats();
+    }
     return 0;
 }
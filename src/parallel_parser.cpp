@@ -0,0 +1,178 @@
+#include "parallel_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+// Below this size splitting costs more than it saves
+constexpr size_t MIN_PARALLEL_SIZE = 256 * 1024;
+
+// Chunks per thread, so uneven chunks still balance out
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+bool isWordChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool startsWithKeyword(const std::string& source, size_t pos, const char* keyword) {
+    size_t length = std::char_traits<char>::length(keyword);
+    return source.compare(pos, length, keyword) == 0 &&
+           (pos + length >= source.size() || !isWordChar(source[pos + length]));
+}
+
+// A column-0 line that begins a new top-level statement
+bool startsStatement(const std::string& source, size_t pos) {
+    char c = source[pos];
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#') {
+        return false;
+    }
+    // These continue the if/try statement above them
+    return !startsWithKeyword(source, pos, "else") &&
+           !startsWithKeyword(source, pos, "elif") &&
+           !startsWithKeyword(source, pos, "except");
+}
+
+struct Chunk {
+    size_t begin;
+    size_t end;
+    int start_line;
+    std::unique_ptr<Program> program;
+    std::vector<std::string> errors;
+    std::exception_ptr failure;
+};
+
+void parseChunk(const std::string& source, Chunk& chunk, bool defer_bodies) {
+    try {
+        Lexer lexer(source.substr(chunk.begin, chunk.end - chunk.begin), chunk.start_line);
+        Parser parser(lexer.tokenize());
+        parser.setReportErrors(false);
+        parser.setDeferFunctionBodies(defer_bodies);
+        chunk.program = parser.parse();
+        chunk.errors = parser.getErrors();
+    } catch (...) {
+        chunk.failure = std::current_exception();
+    }
+}
+
+} // namespace
+
+std::vector<size_t> ParallelParser::findTopLevelBoundaries(const std::string& source) {
+    std::vector<size_t> boundaries{0};
+    int depth = 0;
+    char quote = 0;
+    bool line_start = true;
+
+    for (size_t i = 0; i < source.size(); ++i) {
+        char c = source[i];
+
+        // Strings may span lines, like in the lexer
+        if (quote) {
+            if (c == '\\') {
+                ++i;
+            } else if (c == quote) {
+                quote = 0;
+            }
+            continue;
+        }
+
+        if (line_start) {
+            line_start = false;
+            if (depth == 0 && i > 0 && startsStatement(source, i)) {
+                boundaries.push_back(i);
+            }
+        }
+
+        switch (c) {
+            case '\n':
+                line_start = true;
+                break;
+            case '#': {
+                size_t newline = source.find('\n', i);
+                i = (newline == std::string::npos ? source.size() : newline) - 1;
+                break;
+            }
+            case '"':
+            case '\'':
+                quote = c;
+                break;
+            case '(':
+            case '[':
+            case '{':
+                depth++;
+                break;
+            case ')':
+            case ']':
+            case '}':
+                if (depth > 0) depth--;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return boundaries;
+}
+
+std::unique_ptr<Program> ParallelParser::parse(const std::string& source, unsigned threads, bool defer_bodies) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (threads == 1 || source.size() < MIN_PARALLEL_SIZE) {
+        Lexer lexer(source);
+        Parser parser(lexer.tokenize());
+        parser.setDeferFunctionBodies(defer_bodies);
+        return parser.parse();
+    }
+
+    // Group statement boundaries into chunks of roughly equal size
+    std::vector<size_t> boundaries = findTopLevelBoundaries(source);
+    size_t target = std::max<size_t>(1, source.size() / (threads * CHUNKS_PER_THREAD));
+    std::vector<Chunk> chunks;
+    int line = 1;
+    size_t begin = 0;
+    for (size_t i = 1; i <= boundaries.size(); ++i) {
+        size_t end = i < boundaries.size() ? boundaries[i] : source.size();
+        if (end - begin >= target || end == source.size()) {
+            chunks.push_back({begin, end, line, nullptr, {}, nullptr});
+            line += static_cast<int>(std::count(source.begin() + begin, source.begin() + end, '\n'));
+            begin = end;
+        }
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < chunks.size(); i = next++) {
+            parseChunk(source, chunks[i], defer_bodies);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    size_t workers = std::min<size_t>(threads, chunks.size());
+    for (size_t i = 1; i < workers; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    // Stitch the chunks back together in source order
+    std::vector<std::unique_ptr<Statement>> statements;
+    for (auto& chunk : chunks) {
+        if (chunk.failure) {
+            std::rethrow_exception(chunk.failure);
+        }
+        for (const auto& error : chunk.errors) {
+            std::cerr << "Parse error: " << error << std::endl;
+        }
+        for (auto& stmt : chunk.program->statements) {
+            statements.push_back(std::move(stmt));
+        }
+    }
+
+    return std::make_unique<Program>(std::move(statements));
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "parser.h"
+#include <string>
+#include <vector>
+
+// Parses one large source file on several threads.
+//
+// Top-level statements are independent as far as the lexer and parser are
+// concerned, so the source is split at lines that start a new top-level
+// statement: column 0, outside any string or bracket, and not a clause that
+// continues the previous statement (else, elif, except). Each chunk is lexed
+// from its own starting line number and parsed on a worker thread; the
+// statement lists are concatenated in source order, and parse errors are
+// reported in source order once all chunks are done.
+class ParallelParser {
+public:
+    // threads == 0 uses the hardware concurrency. Small inputs are parsed
+    // serially. defer_bodies is passed on to every chunk's Parser.
+    static std::unique_ptr<Program> parse(const std::string& source, unsigned threads = 0,
+                                          bool defer_bodies = false);
+
+    // Byte offsets of lines that may start a chunk (always includes 0)
+    static std::vector<size_t> findTopLevelBoundaries(const std::string& source);
+};
@@ -1,8 +1,28 @@
 #include "parser.h"
+#include "resolver.h"
 #include <stdexcept>
 #include <iostream>
+#include <array>
+#include <cstdint>
 
-Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens)), current(0) {}
+namespace {
+
+// Bodies with fewer tokens are parsed eagerly; skipping them saves little
+constexpr size_t MIN_DEFERRED_TOKENS = 32;
+
+} // namespace
+
+Parser::Parser(std::vector<Token> tokens)
+    : token_list(std::make_shared<const std::vector<Token>>(std::move(tokens))),
+      tokens(token_list->data()), current(0) {}
+
+Parser::Parser(std::shared_ptr<const std::vector<Token>> tokens, size_t start)
+    : token_list(std::move(tokens)), tokens(token_list->data()), current(start) {}
+
+LazyParseStats& Parser::lazyStats() {
+    static LazyParseStats stats;
+    return stats;
+}
 
 std::unique_ptr<Program> Parser::parse() {
     std::vector<std::unique_ptr<Statement>> statements;
@@ -20,7 +40,10 @@ std::unique_ptr<Program> Parser::parse() {
                 statements.push_back(std::move(stmt));
             }
         } catch (const std::exception& e) {
-            std::cerr << "Parse error: " << e.what() << std::endl;
+            errors.push_back(e.what());
+            if (report_errors) {
+                std::cerr << "Parse error: " << e.what() << std::endl;
+            }
             synchronize();
         }
     }
@@ -28,29 +51,29 @@ std::unique_ptr<Program> Parser::parse() {
     return std::make_unique<Program>(std::move(statements));
 }
 
-bool Parser::isAtEnd() {
+bool Parser::isAtEnd() const {
     return peek().type == TokenType::EOF_TOKEN;
 }
 
-Token Parser::peek() {
+const Token& Parser::peek() const {
     return tokens[current];
 }
 
-Token Parser::previous() {
+const Token& Parser::previous() const {
     return tokens[current - 1];
 }
 
-Token Parser::advance() {
+const Token& Parser::advance() {
     if (!isAtEnd()) current++;
     return previous();
 }
 
-bool Parser::check(TokenType type) {
+bool Parser::check(TokenType type) const {
     if (isAtEnd()) return false;
     return peek().type == type;
 }
 
-bool Parser::match(std::vector<TokenType> types) {
+bool Parser::match(std::initializer_list<TokenType> types) {
     for (TokenType type : types) {
         if (check(type)) {
             advance();
@@ -69,6 +92,34 @@ void Parser::consume(TokenType type, const std::string& message) {
     throw std::runtime_error(message + " at line " + std::to_string(peek().line));
 }
 
+bool Parser::checkAssignment() const {
+    switch (peek().type) {
+        case TokenType::ASSIGN:
+        case TokenType::PLUS_ASSIGN:
+        case TokenType::MINUS_ASSIGN:
+        case TokenType::MULTIPLY_ASSIGN:
+        case TokenType::DIVIDE_ASSIGN:
+        case TokenType::MODULO_ASSIGN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+TokenType Parser::assignmentOperator(const std::string& message) {
+    if (!checkAssignment()) {
+        throw std::runtime_error(message + " at line " + std::to_string(peek().line));
+    }
+    switch (advance().type) {
+        case TokenType::PLUS_ASSIGN: return TokenType::PLUS;
+        case TokenType::MINUS_ASSIGN: return TokenType::MINUS;
+        case TokenType::MULTIPLY_ASSIGN: return TokenType::MULTIPLY;
+        case TokenType::DIVIDE_ASSIGN: return TokenType::DIVIDE;
+        case TokenType::MODULO_ASSIGN: return TokenType::MODULO;
+        default: return TokenType::ASSIGN;
+    }
+}
+
 void Parser::synchronize() {
     advance();
     
@@ -82,6 +133,7 @@ void Parser::synchronize() {
             case TokenType::WHILE:
             case TokenType::FOR:
             case TokenType::RETURN:
+            case TokenType::YIELD:
                 return;
             default:
                 break;
@@ -101,22 +153,23 @@ std::unique_ptr<Statement> Parser::statement() {
     if (match({TokenType::FROM})) return fromImportStatement();
     if (match({TokenType::TRY})) return tryStatement();
     if (match({TokenType::RETURN})) return returnStatement();
+    if (match({TokenType::YIELD})) return yieldStatement();
     
     // Check for assignment (both simple and attribute)
     if (check(TokenType::IDENTIFIER)) {
         size_t saved = current;
         advance(); // consume identifier
         
-        if (check(TokenType::ASSIGN)) {
-            // Simple assignment: identifier = value
+        if (checkAssignment()) {
+            // Simple assignment: identifier = value (or op= value)
             current = saved; // reset
             return assignmentStatement();
         } else if (check(TokenType::DOT)) {
             advance(); // consume dot
             if (check(TokenType::IDENTIFIER)) {
                 advance(); // consume attribute
-                if (check(TokenType::ASSIGN)) {
-                    // Attribute assignment: obj.attr = value
+                if (checkAssignment()) {
+                    // Attribute assignment: obj.attr = value (or op= value)
                     current = saved; // reset
                     return attributeAssignmentStatement();
                 }
@@ -132,6 +185,18 @@ std::unique_ptr<Statement> Parser::statement() {
 std::unique_ptr<Statement> Parser::expressionStatement() {
     auto expr = expression();
     
+    // Subscript assignment: object[index] = value (or op= value)
+    if (expr->type == NodeType::INDEX_EXPR && checkAssignment()) {
+        auto& target = static_cast<IndexExpression&>(*expr);
+        TokenType op = assignmentOperator("Expected '=' after subscript");
+        auto value = expression();
+        if (check(TokenType::NEWLINE)) {
+            advance();
+        }
+        return std::make_unique<IndexAssignmentStatement>(std::move(target.object), std::move(target.index), op,
+                                                          std::move(value), expr->line, expr->column);
+    }
+    
     // Consume optional newline
     if (check(TokenType::NEWLINE)) {
         advance();
@@ -142,16 +207,23 @@ std::unique_ptr<Statement> Parser::expressionStatement() {
 
 std::unique_ptr<Statement> Parser::assignmentStatement() {
     Token name = advance(); // consume identifier
-    consume(TokenType::ASSIGN, "Expected '=' after variable name");
+    TokenType op = assignmentOperator("Expected '=' after variable name");
     
     auto value = expression();
+    if (op != TokenType::ASSIGN) {
+        // name op= value is evaluated as name = name op value
+        value = std::make_unique<BinaryExpression>(std::make_unique<IdentifierExpression>(name.value, name.line, name.column),
+                                                   op, std::move(value), name.line, name.column);
+    }
     
     // Consume optional newline
     if (check(TokenType::NEWLINE)) {
         advance();
     }
     
-    return std::make_unique<AssignmentStatement>(name.value, std::move(value));
+    auto assignment = std::make_unique<AssignmentStatement>(name.value, std::move(value));
+    assignment->augmented = op != TokenType::ASSIGN;
+    return assignment;
 }
 
 std::unique_ptr<Statement> Parser::attributeAssignmentStatement() {
@@ -163,16 +235,25 @@ std::unique_ptr<Statement> Parser::attributeAssignmentStatement() {
     }
     Token attribute = advance(); // consume attribute
     
-    consume(TokenType::ASSIGN, "Expected '=' after attribute name");
+    TokenType op = assignmentOperator("Expected '=' after attribute name");
     
     auto value = expression();
+    if (op != TokenType::ASSIGN) {
+        // obj.attr op= value is evaluated as obj.attr = obj.attr op value
+        auto target = std::make_unique<AttributeExpression>(
+            std::make_unique<IdentifierExpression>(object->name.str(), object->line, object->column),
+            attribute.value, attribute.line, attribute.column);
+        value = std::make_unique<BinaryExpression>(std::move(target), op, std::move(value), attribute.line, attribute.column);
+    }
     
     // Consume optional newline
     if (check(TokenType::NEWLINE)) {
         advance();
     }
     
-    return std::make_unique<AttributeAssignmentStatement>(std::move(object), attribute.value, std::move(value));
+    auto assignment = std::make_unique<AttributeAssignmentStatement>(std::move(object), attribute.value, std::move(value));
+    assignment->augmented = op != TokenType::ASSIGN;
+    return assignment;
 }
 
 std::unique_ptr<Statement> Parser::ifStatement() {
@@ -239,20 +320,104 @@ std::unique_ptr<Statement> Parser::functionDefStatement() {
     consume(TokenType::NEWLINE, "Expected newline after ':'");
     consume(TokenType::INDENT, "Expected indentation after function definition");
     
-    auto body = blockStatement();
+    if (defer_bodies && function_depth == 0) {
+        size_t start = current;
+        int bytes = skipDeferredBody();
+        if (bytes >= 0) {
+            auto function = std::make_unique<FunctionDefStatement>(name.value, std::move(parameters), nullptr);
+            function->deferred_tokens = token_list;
+            function->deferred_start = start;
+            function->deferred_bytes = bytes;
+            lazyStats().deferred_functions++;
+            lazyStats().deferred_bytes += static_cast<size_t>(bytes);
+            return function;
+        }
+    }
+    
+    int body_offset = previous().offset;
+    function_depth++;
+    std::unique_ptr<BlockStatement> body;
+    try {
+        body = blockStatement();
+    } catch (...) {
+        function_depth--;
+        throw;
+    }
+    function_depth--;
     
-    return std::make_unique<FunctionDefStatement>(name.value, std::move(parameters), std::move(body));
+    if (defer_bodies && function_depth == 0) {
+        lazyStats().eager_functions++;
+        lazyStats().eager_bytes += static_cast<size_t>(previous().offset - body_offset);
+    }
+    
+    auto function = std::make_unique<FunctionDefStatement>(name.value, std::move(parameters), std::move(body));
+    Resolver::resolveFunction(*function);
+    return function;
+}
+
+int Parser::skipDeferredBody() {
+    // The INDENT has been consumed; find the DEDENT that matches it
+    size_t start = current;
+    int depth = 1;
+    while (!isAtEnd() && depth > 0) {
+        TokenType type = advance().type;
+        if (type == TokenType::INDENT) {
+            depth++;
+        } else if (type == TokenType::DEDENT) {
+            depth--;
+        }
+    }
+    
+    if (depth > 0 || current - start < MIN_DEFERRED_TOKENS) {
+        current = start;
+        return -1;
+    }
+    return previous().offset - tokens[start - 1].offset;
+}
+
+void Parser::parseDeferredBody(const FunctionDefStatement& function) {
+    if (!function.isDeferred()) {
+        return;
+    }
+    
+    Parser parser(function.deferred_tokens, function.deferred_start);
+    parser.function_depth = 1;
+    std::unique_ptr<BlockStatement> body;
+    try {
+        body = parser.blockStatement();
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Parse error in body of '" + function.name + "': " + e.what());
+    }
+    
+    // Filling in the body is the one change made to an AST after parsing
+    auto& target = const_cast<FunctionDefStatement&>(function);
+    target.body = std::move(body);
+    target.deferred_tokens.reset();
+    Resolver::resolveFunction(target);
+    
+    lazyStats().parsed_on_call++;
+    lazyStats().parsed_on_call_bytes += static_cast<size_t>(function.deferred_bytes);
 }
 
 std::unique_ptr<Statement> Parser::classDefStatement() {
     Token name = advance();
+    
+    // Optional base class: class Name(Base):
+    std::unique_ptr<Expression> base;
+    if (match({TokenType::LEFT_PAREN})) {
+        if (!check(TokenType::RIGHT_PAREN)) {
+            base = expression();
+        }
+        consume(TokenType::RIGHT_PAREN, "Expected ')' after base class");
+    }
+    
     consume(TokenType::COLON, "Expected ':' after class name");
     consume(TokenType::NEWLINE, "Expected newline after ':'");
     consume(TokenType::INDENT, "Expected indentation after class definition");
     
     auto body = blockStatement();
     
-    return std::make_unique<ClassDefStatement>(name.value, std::move(body));
+    return std::make_unique<ClassDefStatement>(name.value, std::move(base), std::move(body));
 }
 
 std::unique_ptr<Statement> Parser::importStatement() {
@@ -329,6 +494,21 @@ std::unique_ptr<Statement> Parser::returnStatement() {
     return std::make_unique<ReturnStatement>(std::move(value));
 }
 
+std::unique_ptr<Statement> Parser::yieldStatement() {
+    std::unique_ptr<Expression> value = nullptr;
+    
+    if (!check(TokenType::NEWLINE) && !isAtEnd()) {
+        value = expression();
+    }
+    
+    // Consume optional newline
+    if (check(TokenType::NEWLINE)) {
+        advance();
+    }
+    
+    return std::make_unique<YieldStatement>(std::move(value));
+}
+
 std::unique_ptr<Statement> Parser::tryStatement() {
     // Parse try block
     consume(TokenType::COLON, "Expected ':' after 'try'");
@@ -392,88 +572,72 @@ std::unique_ptr<BlockStatement> Parser::blockStatement() {
     return std::make_unique<BlockStatement>(std::move(statements));
 }
 
-std::unique_ptr<Expression> Parser::expression() {
-    return logicalOr();
-}
-
-std::unique_ptr<Expression> Parser::logicalOr() {
-    auto expr = logicalAnd();
-    
-    while (match({TokenType::OR})) {
-        TokenType operator_type = previous().type;
-        auto right = logicalAnd();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
-    }
-    
-    return expr;
-}
-
-std::unique_ptr<Expression> Parser::logicalAnd() {
-    auto expr = equality();
-    
-    while (match({TokenType::AND})) {
-        TokenType operator_type = previous().type;
-        auto right = equality();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
-    }
-    
-    return expr;
-}
-
-std::unique_ptr<Expression> Parser::equality() {
-    auto expr = comparison();
-    
-    while (match({TokenType::NOT_EQUAL, TokenType::EQUAL})) {
-        TokenType operator_type = previous().type;
-        auto right = comparison();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
-    }
-    
-    return expr;
-}
+namespace {
+
+// Binding power of each binary operator; higher binds tighter. Tokens with
+// PREC_NONE end an expression. Unary operators bind tighter than any binary
+// operator, so -a ** b is (-a) ** b.
+enum Precedence : uint8_t {
+    PREC_NONE,
+    PREC_OR,          // or
+    PREC_AND,         // and
+    PREC_EQUALITY,    // == !=
+    PREC_COMPARISON,  // < <= > >=
+    PREC_TERM,        // + -
+    PREC_FACTOR,      // * / %
+    PREC_POWER,       // ** (right associative)
+    PREC_UNARY        // not -
+};
+
+constexpr size_t TOKEN_TYPE_COUNT = static_cast<size_t>(TokenType::INVALID) + 1;
+
+constexpr std::array<uint8_t, TOKEN_TYPE_COUNT> makeBindingPowers() {
+    std::array<uint8_t, TOKEN_TYPE_COUNT> table{};
+    auto set = [&table](TokenType type, Precedence precedence) {
+        table[static_cast<size_t>(type)] = precedence;
+    };
+    set(TokenType::OR, PREC_OR);
+    set(TokenType::AND, PREC_AND);
+    set(TokenType::EQUAL, PREC_EQUALITY);
+    set(TokenType::NOT_EQUAL, PREC_EQUALITY);
+    set(TokenType::LESS, PREC_COMPARISON);
+    set(TokenType::LESS_EQUAL, PREC_COMPARISON);
+    set(TokenType::GREATER, PREC_COMPARISON);
+    set(TokenType::GREATER_EQUAL, PREC_COMPARISON);
+    set(TokenType::PLUS, PREC_TERM);
+    set(TokenType::MINUS, PREC_TERM);
+    set(TokenType::MULTIPLY, PREC_FACTOR);
+    set(TokenType::DIVIDE, PREC_FACTOR);
+    set(TokenType::MODULO, PREC_FACTOR);
+    set(TokenType::POWER, PREC_POWER);
+    return table;
+}
+
+constexpr std::array<uint8_t, TOKEN_TYPE_COUNT> binding_powers = makeBindingPowers();
+
+constexpr uint8_t bindingPower(TokenType type) {
+    return binding_powers[static_cast<size_t>(type)];
+}
+
+} // namespace
 
-std::unique_ptr<Expression> Parser::comparison() {
-    auto expr = term();
-    
-    while (match({TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL})) {
-        TokenType operator_type = previous().type;
-        auto right = term();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
-    }
-    
-    return expr;
-}
-
-std::unique_ptr<Expression> Parser::term() {
-    auto expr = factor();
-    
-    while (match({TokenType::MINUS, TokenType::PLUS})) {
-        TokenType operator_type = previous().type;
-        auto right = factor();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
-    }
-    
-    return expr;
-}
-
-std::unique_ptr<Expression> Parser::factor() {
-    auto expr = power();
-    
-    while (match({TokenType::DIVIDE, TokenType::MULTIPLY, TokenType::MODULO})) {
-        TokenType operator_type = previous().type;
-        auto right = power();
-        expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
-    }
-    
-    return expr;
+std::unique_ptr<Expression> Parser::expression() {
+    return parsePrecedence(PREC_OR);
 }
 
-std::unique_ptr<Expression> Parser::power() {
+std::unique_ptr<Expression> Parser::parsePrecedence(int min_precedence) {
     auto expr = unary();
     
-    if (match({TokenType::POWER})) {
-        TokenType operator_type = previous().type;
-        auto right = power(); // Right associative
+    while (true) {
+        int precedence = bindingPower(peek().type);
+        if (precedence == PREC_NONE || precedence < min_precedence) {
+            break;
+        }
+        TokenType operator_type = advance().type;
+        
+        // Left-associative operators parse their right side one level tighter
+        int right_precedence = operator_type == TokenType::POWER ? precedence : precedence + 1;
+        auto right = parsePrecedence(right_precedence);
         expr = std::make_unique<BinaryExpression>(std::move(expr), operator_type, std::move(right));
     }
     
@@ -539,6 +703,13 @@ std::unique_ptr<Expression> Parser::primary() {
     }
     
     if (match({TokenType::IDENTIFIER})) {
+        // super() takes no arguments; it is resolved against the method's class
+        if (previous().value == "super" && check(TokenType::LEFT_PAREN) &&
+            tokens[current + 1].type == TokenType::RIGHT_PAREN) {
+            advance();
+            advance();
+            return std::make_unique<SuperExpression>();
+        }
         return std::make_unique<IdentifierExpression>(previous().value);
     }
     
@@ -1,7 +1,12 @@
 #pragma once
 #include "lexer.h"
+#include "symbol.h"
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <utility>
 #include <vector>
+#include <initializer_list>
 
 // Forward declarations
 struct ASTNode;
@@ -23,6 +28,7 @@ enum class NodeType {
     DICT_EXPR,
     INDEX_EXPR,
     ATTRIBUTE_EXPR,
+    SUPER_EXPR,
     
     // Statements
     EXPRESSION_STMT,
@@ -38,6 +44,8 @@ enum class NodeType {
     IMPORT_STMT,
     FROM_IMPORT_STMT,
     TRY_STMT,
+    YIELD_STMT,
+    INDEX_ASSIGNMENT_STMT,
     
     // Program
     PROGRAM
@@ -54,7 +62,33 @@ struct ASTNode {
 };
 
 // Expression nodes
+// Specialized variant an operator node has rewritten itself to after
+// observing its operand types (quickening). Nodes start UNSEEN; the
+// interpreter picks a variant on first evaluation and falls back to GENERIC
+// for good when a variant's type guard fails.
+enum class Quickened : uint8_t {
+    UNSEEN,
+    GENERIC,
+    ADD_NUMBERS,
+    SUBTRACT_NUMBERS,
+    MULTIPLY_NUMBERS,
+    DIVIDE_NUMBERS,
+    EQUAL_NUMBERS,
+    NOT_EQUAL_NUMBERS,
+    LESS_NUMBERS,
+    LESS_EQUAL_NUMBERS,
+    GREATER_NUMBERS,
+    GREATER_EQUAL_NUMBERS,
+    ADD_STRINGS,
+    EQUAL_STRINGS,
+    NOT_EQUAL_STRINGS,
+    NEGATE_NUMBER,
+    LIST_BY_NUMBER,
+    DICT_BY_STRING
+};
+
 struct Expression : public ASTNode {
+    bool unboxed = false;  // a number computed from literals and number locals only, see TypeInference
     Expression(NodeType t, int l = 0, int c = 0) : ASTNode(t, l, c) {}
 };
 
@@ -82,7 +116,9 @@ struct NoneExpression : public Expression {
 };
 
 struct IdentifierExpression : public Expression {
-    std::string name;
+    Symbol name;
+    int slot = -1;  // frame slot of a parameter, set by the resolver (-1: look up by name)
+    int number_slot = -1;  // unboxed number local, set by TypeInference
     IdentifierExpression(const std::string& n, int l = 0, int c = 0)
         : Expression(NodeType::IDENTIFIER_EXPR, l, c), name(n) {}
 };
@@ -91,6 +127,7 @@ struct BinaryExpression : public Expression {
     std::unique_ptr<Expression> left;
     TokenType operator_type;
     std::unique_ptr<Expression> right;
+    mutable Quickened quickened = Quickened::UNSEEN;
     
     BinaryExpression(std::unique_ptr<Expression> l, TokenType op, std::unique_ptr<Expression> r, int line = 0, int col = 0)
         : Expression(NodeType::BINARY_EXPR, line, col), left(std::move(l)), operator_type(op), right(std::move(r)) {}
@@ -99,6 +136,7 @@ struct BinaryExpression : public Expression {
 struct UnaryExpression : public Expression {
     TokenType operator_type;
     std::unique_ptr<Expression> operand;
+    mutable Quickened quickened = Quickened::UNSEEN;
     
     UnaryExpression(TokenType op, std::unique_ptr<Expression> expr, int l = 0, int c = 0)
         : Expression(NodeType::UNARY_EXPR, l, c), operator_type(op), operand(std::move(expr)) {}
@@ -129,6 +167,7 @@ struct DictExpression : public Expression {
 struct IndexExpression : public Expression {
     std::unique_ptr<Expression> object;
     std::unique_ptr<Expression> index;
+    mutable Quickened quickened = Quickened::UNSEEN;
     
     IndexExpression(std::unique_ptr<Expression> obj, std::unique_ptr<Expression> idx, int l = 0, int c = 0)
         : Expression(NodeType::INDEX_EXPR, l, c), object(std::move(obj)), index(std::move(idx)) {}
@@ -136,12 +175,17 @@ struct IndexExpression : public Expression {
 
 struct AttributeExpression : public Expression {
     std::unique_ptr<Expression> object;
-    std::string attribute;
+    Symbol attribute;
     
     AttributeExpression(std::unique_ptr<Expression> obj, const std::string& attr, int l = 0, int c = 0)
         : Expression(NodeType::ATTRIBUTE_EXPR, l, c), object(std::move(obj)), attribute(attr) {}
 };
 
+// super() inside a method; only valid as the object of an attribute access
+struct SuperExpression : public Expression {
+    SuperExpression(int l = 0, int c = 0) : Expression(NodeType::SUPER_EXPR, l, c) {}
+};
+
 // Statement nodes
 struct Statement : public ASTNode {
     Statement(NodeType t, int l = 0, int c = 0) : ASTNode(t, l, c) {}
@@ -155,8 +199,13 @@ struct ExpressionStatement : public Statement {
 };
 
 struct AssignmentStatement : public Statement {
-    std::string identifier;
+    Symbol identifier;
     std::unique_ptr<Expression> value;
+    int slot = -1;  // frame slot of a parameter, set by the resolver (-1: assign by name)
+    int number_slot = -1;  // unboxed number local, set by TypeInference
+    // From name op= operand: value is name op operand, and a list is
+    // extended in place rather than replaced by a copy
+    bool augmented = false;
     
     AssignmentStatement(const std::string& id, std::unique_ptr<Expression> val, int l = 0, int c = 0)
         : Statement(NodeType::ASSIGNMENT_STMT, l, c), identifier(id), value(std::move(val)) {}
@@ -164,8 +213,9 @@ struct AssignmentStatement : public Statement {
 
 struct AttributeAssignmentStatement : public Statement {
     std::unique_ptr<Expression> object;
-    std::string attribute;
+    Symbol attribute;
     std::unique_ptr<Expression> value;
+    bool augmented = false;  // from obj.attr op= operand, as in AssignmentStatement
     
     AttributeAssignmentStatement(std::unique_ptr<Expression> obj, const std::string& attr, 
                                 std::unique_ptr<Expression> val, int l = 0, int c = 0)
@@ -173,6 +223,20 @@ struct AttributeAssignmentStatement : public Statement {
           object(std::move(obj)), attribute(attr), value(std::move(val)) {}
 };
 
+// object[index] = value, or object[index] op= value; object and index are
+// evaluated once
+struct IndexAssignmentStatement : public Statement {
+    std::unique_ptr<Expression> object;
+    std::unique_ptr<Expression> index;
+    TokenType op;  // ASSIGN, or the operator of an augmented assignment (PLUS for +=)
+    std::unique_ptr<Expression> value;
+    
+    IndexAssignmentStatement(std::unique_ptr<Expression> obj, std::unique_ptr<Expression> idx, TokenType o,
+                             std::unique_ptr<Expression> val, int l = 0, int c = 0)
+        : Statement(NodeType::INDEX_ASSIGNMENT_STMT, l, c), object(std::move(obj)), index(std::move(idx)),
+          op(o), value(std::move(val)) {}
+};
+
 struct BlockStatement : public Statement {
     std::vector<std::unique_ptr<Statement>> statements;
     
@@ -200,7 +264,7 @@ struct WhileStatement : public Statement {
 };
 
 struct ForStatement : public Statement {
-    std::string variable;
+    Symbol variable;
     std::unique_ptr<Expression> iterable;
     std::unique_ptr<BlockStatement> body;
     
@@ -209,21 +273,38 @@ struct ForStatement : public Statement {
 };
 
 struct FunctionDefStatement : public Statement {
-    std::string name;
-    std::vector<std::string> parameters;
+    Symbol name;
+    std::vector<Symbol> parameters;
     std::unique_ptr<BlockStatement> body;
+    bool uses_frame_slots = false;  // parameters live in the caller's value stack window
+    bool is_generator = false;      // the body yields, so calls return a generator
+    std::vector<Symbol> free_names;  // names the body uses but does not bind as parameters
+    // Locals proven to always hold numbers, in number slot order, and the
+    // other assigned locals with the reason they stay boxed (TypeInference)
+    std::vector<Symbol> number_locals;
+    std::vector<std::pair<std::string, std::string>> boxed_locals;
     
-    FunctionDefStatement(const std::string& n, std::vector<std::string> params, 
+    // Deferred body (lazy parsing): body stays null and the tokens after the
+    // INDENT are kept until Parser::parseDeferredBody() is called
+    std::shared_ptr<const std::vector<Token>> deferred_tokens;
+    size_t deferred_start = 0;
+    int deferred_bytes = 0;
+    
+    bool isDeferred() const { return !body; }
+    
+    FunctionDefStatement(const std::string& n, const std::vector<std::string>& params, 
                         std::unique_ptr<BlockStatement> b, int l = 0, int c = 0)
-        : Statement(NodeType::FUNCTION_DEF_STMT, l, c), name(n), parameters(std::move(params)), body(std::move(b)) {}
+        : Statement(NodeType::FUNCTION_DEF_STMT, l, c), name(n), parameters(params.begin(), params.end()), body(std::move(b)) {}
 };
 
 struct ClassDefStatement : public Statement {
-    std::string name;
+    Symbol name;
+    std::unique_ptr<Expression> base;  // nullptr if no base class
     std::unique_ptr<BlockStatement> body;
     
-    ClassDefStatement(const std::string& n, std::unique_ptr<BlockStatement> b, int l = 0, int c = 0)
-        : Statement(NodeType::CLASS_DEF_STMT, l, c), name(n), body(std::move(b)) {}
+    ClassDefStatement(const std::string& n, std::unique_ptr<Expression> base_expr,
+                      std::unique_ptr<BlockStatement> b, int l = 0, int c = 0)
+        : Statement(NodeType::CLASS_DEF_STMT, l, c), name(n), base(std::move(base_expr)), body(std::move(b)) {}
 };
 
 struct ImportStatement : public Statement {
@@ -249,10 +330,18 @@ struct ReturnStatement : public Statement {
         : Statement(NodeType::RETURN_STMT, l, c), value(std::move(val)) {}
 };
 
+// yield [value]: suspends the generator the enclosing function's calls create
+struct YieldStatement : public Statement {
+    std::unique_ptr<Expression> value;
+    
+    YieldStatement(std::unique_ptr<Expression> val = nullptr, int l = 0, int c = 0)
+        : Statement(NodeType::YIELD_STMT, l, c), value(std::move(val)) {}
+};
+
 // Exception handler for try/except
 struct ExceptClause {
     std::string exception_type; // Optional exception type (empty means catch all)
-    std::string variable_name;  // Optional variable to bind the exception (empty if not used)
+    Symbol variable_name;       // Optional variable to bind the exception (empty if not used)
     std::unique_ptr<BlockStatement> body;
     
     ExceptClause(const std::string& type = "", const std::string& var = "", 
@@ -278,26 +367,68 @@ struct Program : public ASTNode {
         : ASTNode(NodeType::PROGRAM), statements(std::move(stmts)) {}
 };
 
+// Function bodies parsed while loading versus deferred to their first call
+struct LazyParseStats {
+    std::atomic<size_t> eager_functions{0};
+    std::atomic<size_t> eager_bytes{0};
+    std::atomic<size_t> deferred_functions{0};
+    std::atomic<size_t> deferred_bytes{0};
+    std::atomic<size_t> parsed_on_call{0};        // deferred bodies parsed later
+    std::atomic<size_t> parsed_on_call_bytes{0};
+};
+
 // Parser class
 class Parser {
 private:
-    std::vector<Token> tokens;
+    std::shared_ptr<const std::vector<Token>> token_list; // shared with deferred bodies
+    const Token* tokens;
     size_t current;
+    std::vector<std::string> errors;
+    bool report_errors = true;
+    bool defer_bodies = false;
+    int function_depth = 0;
     
 public:
     Parser(std::vector<Token> tokens);
     std::unique_ptr<Program> parse();
     
+    // Parse errors are printed as they are found unless reporting is off;
+    // either way they are collected in source order
+    void setReportErrors(bool value) { report_errors = value; }
+    const std::vector<std::string>& getErrors() const { return errors; }
+    
+    // Lazy parsing: bodies of top-level functions and methods are skimmed for
+    // their matching DEDENT and parsed on first use. Nested functions are
+    // always parsed with their enclosing body, which needs their free names.
+    void setDeferFunctionBodies(bool value) { defer_bodies = value; }
+    
+    // Parses a deferred body in place; a no-op if it was already parsed.
+    // Syntax errors in the body surface here rather than at load time.
+    static void parseDeferredBody(const FunctionDefStatement& function);
+    
+    static LazyParseStats& lazyStats();
+    
 private:
+    Parser(std::shared_ptr<const std::vector<Token>> tokens, size_t start);
+    
+    // Skips a function body, returning its size in bytes, or -1 (with the
+    // position unchanged) if it is too small to be worth deferring
+    int skipDeferredBody();
+    
+
     // Utility methods
-    bool isAtEnd();
-    Token peek();
-    Token previous();
-    Token advance();
-    bool check(TokenType type);
-    bool match(std::vector<TokenType> types);
+    bool isAtEnd() const;
+    const Token& peek() const;
+    const Token& previous() const;
+    const Token& advance();
+    bool check(TokenType type) const;
+    bool match(std::initializer_list<TokenType> types);
     void consume(TokenType type, const std::string& message);
     void synchronize();
+    // '=' or an augmented assignment operator such as '+='
+    bool checkAssignment() const;
+    // Consumes one of them: ASSIGN, or the operator of op=
+    TokenType assignmentOperator(const std::string& message);
     
     // Parsing methods
     std::unique_ptr<Statement> statement();
@@ -313,16 +444,12 @@ private:
     std::unique_ptr<Statement> fromImportStatement();
     std::unique_ptr<Statement> tryStatement();
     std::unique_ptr<Statement> returnStatement();
+    std::unique_ptr<Statement> yieldStatement();
     std::unique_ptr<BlockStatement> blockStatement();
     
     std::unique_ptr<Expression> expression();
-    std::unique_ptr<Expression> logicalOr();
-    std::unique_ptr<Expression> logicalAnd();
-    std::unique_ptr<Expression> equality();
-    std::unique_ptr<Expression> comparison();
-    std::unique_ptr<Expression> term();
-    std::unique_ptr<Expression> factor();
-    std::unique_ptr<Expression> power();
+    // Binary operators by binding power (Pratt parsing)
+    std::unique_ptr<Expression> parsePrecedence(int min_precedence);
     std::unique_ptr<Expression> unary();
     std::unique_ptr<Expression> call();
     std::unique_ptr<Expression> primary();
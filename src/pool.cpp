@@ -0,0 +1,45 @@
+#include "pool.h"
+
+size_t FreeListPool::trim() {
+    size_t released = 0;
+    while (free_list) {
+        FreeBlock* block = free_list;
+        free_list = block->next;
+        ::operator delete(block);
+        released += stats.block_size;
+    }
+    stats.free_blocks = 0;
+    return released;
+}
+
+ObjectPools::ObjectPools() {
+    for (size_t size = GRANULE; size <= MAX_POOLED_SIZE; size += GRANULE) {
+        pools.push_back(new FreeListPool(size));
+    }
+}
+
+ObjectPools& ObjectPools::instance() {
+    // Never destroyed: shared_ptrs released during static destruction may
+    // still hand blocks back to the pools
+    static ObjectPools* pools = new ObjectPools();
+    return *pools;
+}
+
+size_t ObjectPools::trim() {
+    size_t released = 0;
+    for (auto* pool : pools) {
+        released += pool->trim();
+    }
+    return released;
+}
+
+std::vector<PoolStats> ObjectPools::getStats() const {
+    std::vector<PoolStats> result;
+    for (const auto* pool : pools) {
+        const PoolStats& stats = pool->getStats();
+        if (stats.hits + stats.misses > 0) {
+            result.push_back(stats);
+        }
+    }
+    return result;
+}
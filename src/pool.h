@@ -0,0 +1,114 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+struct PoolStats {
+    size_t block_size = 0;
+    size_t hits = 0;         // allocations served from the freelist
+    size_t misses = 0;       // allocations that had to go to the system allocator
+    size_t live_blocks = 0;
+    size_t free_blocks = 0;  // retained for reuse
+};
+
+// Fixed-size block pool with an intrusive freelist. Freed blocks are kept for
+// reuse until trim() hands them back to the system allocator.
+class FreeListPool {
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* free_list = nullptr;
+    PoolStats stats;
+
+public:
+    explicit FreeListPool(size_t block_size) { stats.block_size = block_size; }
+    FreeListPool(const FreeListPool&) = delete;
+    FreeListPool& operator=(const FreeListPool&) = delete;
+    ~FreeListPool() { trim(); }
+
+    void* allocate() {
+        stats.live_blocks++;
+        if (free_list) {
+            FreeBlock* block = free_list;
+            free_list = block->next;
+            stats.free_blocks--;
+            stats.hits++;
+            return block;
+        }
+        stats.misses++;
+        return ::operator new(stats.block_size);
+    }
+
+    void deallocate(void* p) {
+        auto* block = static_cast<FreeBlock*>(p);
+        block->next = free_list;
+        free_list = block;
+        stats.live_blocks--;
+        stats.free_blocks++;
+    }
+
+    // Release every retained block, returns the number of bytes released
+    size_t trim();
+
+    const PoolStats& getStats() const { return stats; }
+};
+
+// Size-class pools for the interpreter's hot, fixed-size objects (values and
+// environments together with their shared_ptr control blocks). Requests are
+// rounded up to 16-byte classes; larger requests bypass the pools. The pools
+// are not thread-safe: runtime objects are only created on the interpreter
+// thread.
+class ObjectPools {
+public:
+    static constexpr size_t GRANULE = 16;
+    static constexpr size_t MAX_POOLED_SIZE = 256;
+
+    static ObjectPools& instance();
+
+    void* allocate(size_t bytes) {
+        if (bytes > MAX_POOLED_SIZE) return ::operator new(bytes);
+        return pools[sizeClass(bytes)]->allocate();
+    }
+
+    void deallocate(void* p, size_t bytes) {
+        if (bytes > MAX_POOLED_SIZE) {
+            ::operator delete(p);
+            return;
+        }
+        pools[sizeClass(bytes)]->deallocate(p);
+    }
+
+    size_t trim();
+    std::vector<PoolStats> getStats() const;
+
+private:
+    std::vector<FreeListPool*> pools;
+
+    ObjectPools();
+    static size_t sizeClass(size_t bytes) { return (bytes + GRANULE - 1) / GRANULE - 1; }
+};
+
+// Allocator for std::allocate_shared that draws from ObjectPools
+template <typename T>
+struct PoolAllocator {
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(ObjectPools::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        ObjectPools::instance().deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
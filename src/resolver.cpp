@@ -0,0 +1,407 @@
+#include "resolver.h"
+#include "type_inference.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Collects the names a block of code reads or assigns. Nested functions
+// contribute their own free names, which are already resolved because inner
+// definitions are parsed first.
+class NameCollector {
+public:
+    SymbolSet names;
+    bool yields = false;
+
+    void statements(const std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (const auto& stmt : stmts) statement(*stmt);
+    }
+
+    void statement(const Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::EXPRESSION_STMT:
+                expression(*static_cast<const ExpressionStatement&>(stmt).expression);
+                break;
+            case NodeType::ASSIGNMENT_STMT: {
+                const auto& assign = static_cast<const AssignmentStatement&>(stmt);
+                // Assignment updates an enclosing binding when one exists
+                names.insert(assign.identifier);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+                const auto& assign = static_cast<const AttributeAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::INDEX_ASSIGNMENT_STMT: {
+                const auto& assign = static_cast<const IndexAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.index);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+                expression(*if_stmt.condition);
+                statements(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) statement(*if_stmt.else_branch);
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                const auto& while_stmt = static_cast<const WhileStatement&>(stmt);
+                expression(*while_stmt.condition);
+                statements(while_stmt.body->statements);
+                break;
+            }
+            case NodeType::FOR_STMT: {
+                const auto& for_stmt = static_cast<const ForStatement&>(stmt);
+                expression(*for_stmt.iterable);
+                statements(for_stmt.body->statements);
+                break;
+            }
+            case NodeType::FUNCTION_DEF_STMT: {
+                const auto& def = static_cast<const FunctionDefStatement&>(stmt);
+                names.insert(def.free_names.begin(), def.free_names.end());
+                break;
+            }
+            case NodeType::CLASS_DEF_STMT: {
+                const auto& class_def = static_cast<const ClassDefStatement&>(stmt);
+                if (class_def.base) expression(*class_def.base);
+                statements(class_def.body->statements);
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                const auto& return_stmt = static_cast<const ReturnStatement&>(stmt);
+                if (return_stmt.value) expression(*return_stmt.value);
+                break;
+            }
+            case NodeType::YIELD_STMT: {
+                const auto& yield_stmt = static_cast<const YieldStatement&>(stmt);
+                yields = true;
+                if (yield_stmt.value) expression(*yield_stmt.value);
+                break;
+            }
+            case NodeType::BLOCK_STMT:
+                statements(static_cast<const BlockStatement&>(stmt).statements);
+                break;
+            case NodeType::TRY_STMT: {
+                const auto& try_stmt = static_cast<const TryStatement&>(stmt);
+                statements(try_stmt.try_body->statements);
+                for (const auto& clause : try_stmt.except_clauses) {
+                    statements(clause.body->statements);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void expression(const Expression& expr) {
+        switch (expr.type) {
+            case NodeType::IDENTIFIER_EXPR:
+                names.insert(static_cast<const IdentifierExpression&>(expr).name);
+                break;
+            case NodeType::BINARY_EXPR: {
+                const auto& bin = static_cast<const BinaryExpression&>(expr);
+                expression(*bin.left);
+                expression(*bin.right);
+                break;
+            }
+            case NodeType::UNARY_EXPR:
+                expression(*static_cast<const UnaryExpression&>(expr).operand);
+                break;
+            case NodeType::CALL_EXPR: {
+                const auto& call = static_cast<const CallExpression&>(expr);
+                expression(*call.callee);
+                for (const auto& arg : call.arguments) expression(*arg);
+                break;
+            }
+            case NodeType::LIST_EXPR:
+                for (const auto& elem : static_cast<const ListExpression&>(expr).elements) expression(*elem);
+                break;
+            case NodeType::DICT_EXPR:
+                for (const auto& pair : static_cast<const DictExpression&>(expr).pairs) {
+                    expression(*pair.first);
+                    expression(*pair.second);
+                }
+                break;
+            case NodeType::INDEX_EXPR: {
+                const auto& index = static_cast<const IndexExpression&>(expr);
+                expression(*index.object);
+                expression(*index.index);
+                break;
+            }
+            case NodeType::ATTRIBUTE_EXPR:
+                expression(*static_cast<const AttributeExpression&>(expr).object);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+// Checks whether a function body keeps its parameters private: no nested
+// function or class refers to them and no statement re-binds them in an
+// inner block scope (which would shadow the parameter there).
+class FrameEligibility {
+public:
+    explicit FrameEligibility(const std::unordered_map<Symbol, int>& params) : params(params) {}
+
+    bool eligible = true;
+
+    void statements(const std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (const auto& stmt : stmts) {
+            if (!eligible) return;
+            statement(*stmt);
+        }
+    }
+
+private:
+    const std::unordered_map<Symbol, int>& params;
+
+    void binds(Symbol name) {
+        if (params.count(name)) eligible = false;
+    }
+
+    template <typename Names>
+    void captures(const Names& names) {
+        for (Symbol name : names) binds(name);
+    }
+
+    void statement(const Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::FUNCTION_DEF_STMT: {
+                // A closure that refers to a parameter needs the frame on the heap
+                const auto& def = static_cast<const FunctionDefStatement&>(stmt);
+                binds(def.name);
+                captures(def.free_names);
+                break;
+            }
+            case NodeType::CLASS_DEF_STMT: {
+                const auto& class_def = static_cast<const ClassDefStatement&>(stmt);
+                binds(class_def.name);
+                NameCollector collector;
+                collector.statements(class_def.body->statements);
+                captures(collector.names);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+                statements(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) statement(*if_stmt.else_branch);
+                break;
+            }
+            case NodeType::WHILE_STMT:
+                statements(static_cast<const WhileStatement&>(stmt).body->statements);
+                break;
+            case NodeType::FOR_STMT: {
+                const auto& for_stmt = static_cast<const ForStatement&>(stmt);
+                binds(for_stmt.variable);
+                statements(for_stmt.body->statements);
+                break;
+            }
+            case NodeType::BLOCK_STMT:
+                statements(static_cast<const BlockStatement&>(stmt).statements);
+                break;
+            case NodeType::IMPORT_STMT: {
+                const auto& import_stmt = static_cast<const ImportStatement&>(stmt);
+                binds(Symbol(import_stmt.alias.empty() ? import_stmt.module_name : import_stmt.alias));
+                break;
+            }
+            case NodeType::FROM_IMPORT_STMT:
+                for (const auto& [name, alias] : static_cast<const FromImportStatement&>(stmt).imports) {
+                    binds(Symbol(alias.empty() ? name : alias));
+                }
+                break;
+            case NodeType::TRY_STMT: {
+                const auto& try_stmt = static_cast<const TryStatement&>(stmt);
+                statements(try_stmt.try_body->statements);
+                for (const auto& clause : try_stmt.except_clauses) {
+                    if (!clause.variable_name.empty()) binds(clause.variable_name);
+                    statements(clause.body->statements);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+};
+
+// Rewrites parameter references into frame slot accesses
+class SlotBinder {
+public:
+    explicit SlotBinder(const std::unordered_map<Symbol, int>& params) : params(params) {}
+
+    void statements(const std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (const auto& stmt : stmts) statement(*stmt);
+    }
+
+private:
+    const std::unordered_map<Symbol, int>& params;
+
+    int slotOf(Symbol name) const {
+        auto it = params.find(name);
+        return it == params.end() ? -1 : it->second;
+    }
+
+    void statement(Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::EXPRESSION_STMT:
+                expression(*static_cast<ExpressionStatement&>(stmt).expression);
+                break;
+            case NodeType::ASSIGNMENT_STMT: {
+                auto& assign = static_cast<AssignmentStatement&>(stmt);
+                assign.slot = slotOf(assign.identifier);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+                auto& assign = static_cast<AttributeAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::INDEX_ASSIGNMENT_STMT: {
+                auto& assign = static_cast<IndexAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.index);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                auto& if_stmt = static_cast<IfStatement&>(stmt);
+                expression(*if_stmt.condition);
+                statements(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) statement(*if_stmt.else_branch);
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                auto& while_stmt = static_cast<WhileStatement&>(stmt);
+                expression(*while_stmt.condition);
+                statements(while_stmt.body->statements);
+                break;
+            }
+            case NodeType::FOR_STMT: {
+                auto& for_stmt = static_cast<ForStatement&>(stmt);
+                expression(*for_stmt.iterable);
+                statements(for_stmt.body->statements);
+                break;
+            }
+            case NodeType::CLASS_DEF_STMT: {
+                // The body cannot see parameters (see FrameEligibility), but
+                // the base class expression is evaluated in this frame
+                auto& class_def = static_cast<ClassDefStatement&>(stmt);
+                if (class_def.base) expression(*class_def.base);
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                auto& return_stmt = static_cast<ReturnStatement&>(stmt);
+                if (return_stmt.value) expression(*return_stmt.value);
+                break;
+            }
+            case NodeType::BLOCK_STMT:
+                statements(static_cast<BlockStatement&>(stmt).statements);
+                break;
+            case NodeType::TRY_STMT: {
+                auto& try_stmt = static_cast<TryStatement&>(stmt);
+                statements(try_stmt.try_body->statements);
+                for (auto& clause : try_stmt.except_clauses) {
+                    statements(clause.body->statements);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void expression(Expression& expr) {
+        switch (expr.type) {
+            case NodeType::IDENTIFIER_EXPR: {
+                auto& id = static_cast<IdentifierExpression&>(expr);
+                id.slot = slotOf(id.name);
+                break;
+            }
+            case NodeType::BINARY_EXPR: {
+                auto& bin = static_cast<BinaryExpression&>(expr);
+                expression(*bin.left);
+                expression(*bin.right);
+                break;
+            }
+            case NodeType::UNARY_EXPR:
+                expression(*static_cast<UnaryExpression&>(expr).operand);
+                break;
+            case NodeType::CALL_EXPR: {
+                auto& call = static_cast<CallExpression&>(expr);
+                expression(*call.callee);
+                for (auto& arg : call.arguments) expression(*arg);
+                break;
+            }
+            case NodeType::LIST_EXPR:
+                for (auto& elem : static_cast<ListExpression&>(expr).elements) expression(*elem);
+                break;
+            case NodeType::DICT_EXPR:
+                for (auto& pair : static_cast<DictExpression&>(expr).pairs) {
+                    expression(*pair.first);
+                    expression(*pair.second);
+                }
+                break;
+            case NodeType::INDEX_EXPR: {
+                auto& index = static_cast<IndexExpression&>(expr);
+                expression(*index.object);
+                expression(*index.index);
+                break;
+            }
+            case NodeType::ATTRIBUTE_EXPR:
+                expression(*static_cast<AttributeExpression&>(expr).object);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+} // namespace
+
+void Resolver::resolveFunction(FunctionDefStatement& function) {
+    std::unordered_map<Symbol, int> params;
+    for (size_t i = 0; i < function.parameters.size(); ++i) {
+        // A repeated parameter name binds to the last argument, as before
+        params[function.parameters[i]] = static_cast<int>(i);
+    }
+
+    NameCollector collector;
+    collector.statements(function.body->statements);
+    
+    // def and class always bind in the current scope, so names they introduce
+    // at the top of the body are local to every call
+    std::unordered_set<Symbol> locals;
+    for (const auto& stmt : function.body->statements) {
+        if (stmt->type == NodeType::FUNCTION_DEF_STMT) {
+            locals.insert(static_cast<const FunctionDefStatement&>(*stmt).name);
+        } else if (stmt->type == NodeType::CLASS_DEF_STMT) {
+            locals.insert(static_cast<const ClassDefStatement&>(*stmt).name);
+        }
+    }
+    
+    function.free_names.clear();
+    for (const auto& name : collector.names) {
+        if (!params.count(name) && !locals.count(name)) function.free_names.emplace_back(name);
+    }
+
+    // A generator's frame outlives the call that creates it
+    function.is_generator = collector.yields;
+    FrameEligibility eligibility(params);
+    eligibility.statements(function.body->statements);
+    function.uses_frame_slots = eligibility.eligible && !function.is_generator;
+
+    if (function.uses_frame_slots) {
+        SlotBinder(params).statements(function.body->statements);
+    }
+    
+    TypeInference::inferFunction(function);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "parser.h"
+
+// Static scope analysis for function bodies.
+//
+// A function whose parameters can never be captured or shadowed keeps them in
+// its call frame: a window over the interpreter's value stack with each
+// parameter at a fixed offset. The resolver decides whether that is safe and,
+// if so, rewrites every reference to a parameter into a slot access.
+//
+// It also records each function's free names (everything the body reads or
+// assigns that is not a parameter, including the free names of nested
+// functions) so a closure can capture just those variables, and finally runs
+// type inference over the body (see TypeInference).
+class Resolver {
+public:
+    static void resolveFunction(FunctionDefStatement& function);
+};
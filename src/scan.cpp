@@ -0,0 +1,275 @@
+#include "scan.h"
+#include "char_class.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace scan {
+namespace {
+
+// Scalar fallback, also used for the tail shorter than one vector
+
+template <typename Pred>
+size_t scalarRun(const char* begin, const char* end, Pred pred) {
+    const char* p = begin;
+    while (p < end && pred(*p)) ++p;
+    return static_cast<size_t>(p - begin);
+}
+
+size_t identifierRunScalar(const char* begin, const char* end) {
+    return scalarRun(begin, end, charclass::isIdentifierChar);
+}
+
+size_t digitRunScalar(const char* begin, const char* end) {
+    return scalarRun(begin, end, charclass::isDigit);
+}
+
+size_t blankRunScalar(const char* begin, const char* end) {
+    return scalarRun(begin, end, charclass::isBlank);
+}
+
+size_t findLineEndScalar(const char* begin, const char* end) {
+    return scalarRun(begin, end, [](char c) { return c != '\n'; });
+}
+
+size_t findStringStopScalar(const char* begin, const char* end, char quote) {
+    return scalarRun(begin, end, [quote](char c) { return c != quote && c != '\\' && c != '\n'; });
+}
+
+#ifdef SCAN_X86
+
+// Each vector step builds a bitmask with one bit per byte that is still in
+// the span; the first zero bit is the span boundary.
+
+// SSE2 is part of x86-64, so these need no target attribute
+inline __m128i inRange16(__m128i v, char lo, char hi) {
+    // Signed compares are fine: all bounds are ASCII, bytes >= 0x80 are negative
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), v));
+}
+
+template <typename Classify, typename Tail>
+size_t runSSE2(const char* begin, const char* end, Classify classify, Tail tail) {
+    const char* p = begin;
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(classify(v))) ^ 0xFFFFu;
+        if (mask) {
+            return static_cast<size_t>(p - begin) + static_cast<size_t>(__builtin_ctz(mask));
+        }
+        p += 16;
+    }
+    return static_cast<size_t>(p - begin) + tail(p, end);
+}
+
+size_t identifierRunSSE2(const char* begin, const char* end) {
+    return runSSE2(begin, end, [](__m128i v) {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i word = _mm_or_si128(inRange16(lower, 'a', 'z'), inRange16(v, '0', '9'));
+        return _mm_or_si128(word, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }, identifierRunScalar);
+}
+
+size_t digitRunSSE2(const char* begin, const char* end) {
+    return runSSE2(begin, end, [](__m128i v) { return inRange16(v, '0', '9'); }, digitRunScalar);
+}
+
+size_t blankRunSSE2(const char* begin, const char* end) {
+    return runSSE2(begin, end, [](__m128i v) {
+        __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+        __m128i tab = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+        return _mm_or_si128(_mm_or_si128(space, tab), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    }, blankRunScalar);
+}
+
+size_t findLineEndSSE2(const char* begin, const char* end) {
+    return runSSE2(begin, end, [](__m128i v) {
+        // In the span unless it is a newline
+        return _mm_xor_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_set1_epi8(-1));
+    }, findLineEndScalar);
+}
+
+size_t findStringStopSSE2(const char* begin, const char* end, char quote) {
+    return runSSE2(begin, end, [quote](__m128i v) {
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote)),
+                                    _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        return _mm_xor_si128(stop, _mm_set1_epi8(-1));
+    }, [quote](const char* p, const char* e) { return findStringStopScalar(p, e, quote); });
+}
+
+#define SCAN_AVX2 __attribute__((target("avx2")))
+
+SCAN_AVX2 inline __m256i inRange32(__m256i v, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(static_cast<char>(lo - 1))),
+                            _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), v));
+}
+
+SCAN_AVX2 inline __m256i notMask32(__m256i v) {
+    return _mm256_xor_si256(v, _mm256_set1_epi8(-1));
+}
+
+// Classifiers are function objects rather than lambdas: a lambda body does
+// not inherit the avx2 target of the function it is written in
+struct IdentifierClass32 {
+    SCAN_AVX2 __m256i operator()(__m256i v) const {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i word = _mm256_or_si256(inRange32(lower, 'a', 'z'), inRange32(v, '0', '9'));
+        return _mm256_or_si256(word, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    }
+};
+
+struct DigitClass32 {
+    SCAN_AVX2 __m256i operator()(__m256i v) const { return inRange32(v, '0', '9'); }
+};
+
+struct BlankClass32 {
+    SCAN_AVX2 __m256i operator()(__m256i v) const {
+        __m256i space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+        __m256i tab = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'));
+        return _mm256_or_si256(_mm256_or_si256(space, tab), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    }
+};
+
+struct LineClass32 {
+    SCAN_AVX2 __m256i operator()(__m256i v) const {
+        return notMask32(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    }
+};
+
+struct StringClass32 {
+    char quote;
+    SCAN_AVX2 __m256i operator()(__m256i v) const {
+        __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(quote)),
+                                       _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+        return notMask32(_mm256_or_si256(stop, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+    }
+};
+
+// Same shape as runSSE2; the remainder goes through the 16-byte path
+template <typename Classify, typename Tail>
+SCAN_AVX2 size_t runAVX2(const char* begin, const char* end, Classify classify, Tail tail) {
+    const char* p = begin;
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(classify(v)));
+        if (mask) {
+            return static_cast<size_t>(p - begin) + static_cast<size_t>(__builtin_ctz(mask));
+        }
+        p += 32;
+    }
+    return static_cast<size_t>(p - begin) + tail(p, end);
+}
+
+SCAN_AVX2 size_t identifierRunAVX2(const char* begin, const char* end) {
+    return runAVX2(begin, end, IdentifierClass32(), identifierRunSSE2);
+}
+
+SCAN_AVX2 size_t digitRunAVX2(const char* begin, const char* end) {
+    return runAVX2(begin, end, DigitClass32(), digitRunSSE2);
+}
+
+SCAN_AVX2 size_t blankRunAVX2(const char* begin, const char* end) {
+    return runAVX2(begin, end, BlankClass32(), blankRunSSE2);
+}
+
+SCAN_AVX2 size_t findLineEndAVX2(const char* begin, const char* end) {
+    return runAVX2(begin, end, LineClass32(), findLineEndSSE2);
+}
+
+SCAN_AVX2 size_t findStringStopAVX2(const char* begin, const char* end, char quote) {
+    return runAVX2(begin, end, StringClass32{quote},
+                   [quote](const char* p, const char* e) { return findStringStopSSE2(p, e, quote); });
+}
+
+#undef SCAN_AVX2
+
+#endif // SCAN_X86
+
+struct Scanners {
+    SimdLevel level;
+    size_t (*identifierRun)(const char*, const char*);
+    size_t (*digitRun)(const char*, const char*);
+    size_t (*blankRun)(const char*, const char*);
+    size_t (*findLineEnd)(const char*, const char*);
+    size_t (*findStringStop)(const char*, const char*, char);
+};
+
+const Scanners scalar_scanners = {
+    SimdLevel::SCALAR, identifierRunScalar, digitRunScalar, blankRunScalar,
+    findLineEndScalar, findStringStopScalar
+};
+
+#ifdef SCAN_X86
+const Scanners sse2_scanners = {
+    SimdLevel::SSE2, identifierRunSSE2, digitRunSSE2, blankRunSSE2,
+    findLineEndSSE2, findStringStopSSE2
+};
+
+const Scanners avx2_scanners = {
+    SimdLevel::AVX2, identifierRunAVX2, digitRunAVX2, blankRunAVX2,
+    findLineEndAVX2, findStringStopAVX2
+};
+#endif
+
+SimdLevel supportedLevel() {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+const Scanners* scannersFor(SimdLevel level) {
+#ifdef SCAN_X86
+    if (level == SimdLevel::AVX2) return &avx2_scanners;
+    if (level == SimdLevel::SSE2) return &sse2_scanners;
+#endif
+    return &scalar_scanners;
+}
+
+const Scanners* active = scannersFor(supportedLevel());
+
+} // namespace
+
+size_t identifierRun(const char* begin, const char* end) {
+    return active->identifierRun(begin, end);
+}
+
+size_t digitRun(const char* begin, const char* end) {
+    return active->digitRun(begin, end);
+}
+
+size_t blankRun(const char* begin, const char* end) {
+    return active->blankRun(begin, end);
+}
+
+size_t findLineEnd(const char* begin, const char* end) {
+    return active->findLineEnd(begin, end);
+}
+
+size_t findStringStop(const char* begin, const char* end, char quote) {
+    return active->findStringStop(begin, end, quote);
+}
+
+SimdLevel simdLevel() {
+    return active->level;
+}
+
+void setSimdLevel(SimdLevel level) {
+    SimdLevel supported = supportedLevel();
+    active = scannersFor(static_cast<int>(level) < static_cast<int>(supported) ? level : supported);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+} // namespace scan
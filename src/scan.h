@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+
+// Vectorized character-class scans for the lexer.
+//
+// Each scan takes [begin, end) and returns the length of the leading span
+// that belongs to the class (or, for the "find" scans, the offset of the
+// first stop character; end - begin if there is none). The implementation
+// is picked once at startup: AVX2 or SSE2 on x86 when the CPU has them,
+// a scalar loop everywhere else.
+namespace scan {
+
+enum class SimdLevel {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// [A-Za-z0-9_]*
+size_t identifierRun(const char* begin, const char* end);
+// [0-9]*
+size_t digitRun(const char* begin, const char* end);
+// [ \t\r]*
+size_t blankRun(const char* begin, const char* end);
+// Offset of the next '\n'
+size_t findLineEnd(const char* begin, const char* end);
+// Offset of the next quote, backslash or '\n' inside a string literal
+size_t findStringStop(const char* begin, const char* end, char quote);
+
+SimdLevel simdLevel();
+// Forces a lower level (for testing and benchmarks); levels the CPU does not
+// support are clamped to the best available one
+void setSimdLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+} // namespace scan
@@ -0,0 +1,777 @@
+#include "snapshot.h"
+#include "flat_ast.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+// File layout (host byte order):
+//
+//   Header
+//   program_count x { u64 size, flat AST file padded to 8 bytes }
+//   object_count x kind (u8), followed by the name for BUILTIN_MODULE
+//   object_count x payload, in id order
+//   u32 module count, then { name, module id } per cached module
+//
+// Objects are numbered from 1 in the order they are first reached from the
+// roots; 0 stands for no object. Programs are numbered from 1 the same way.
+// Strings are a u32 length followed by the bytes.
+
+namespace {
+
+constexpr char MAGIC[8] = {'L', 'P', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t VERSION = 6;
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t program_count;
+    uint32_t object_count;
+};
+static_assert(sizeof(Header) % 8 == 0, "flat ASTs after the header stay aligned");
+
+enum class ObjectKind : uint8_t {
+    VALUE,
+    ENVIRONMENT,
+    GLOBALS,        // the interpreter's global environment
+    CELL,
+    FUNCTION,
+    CLASS,
+    INSTANCE,
+    MODULE,
+    BUILTIN_MODULE  // restored by name from the new interpreter's module cache
+};
+
+// Value payload tags, in the order of ValueWrapper's variant
+enum class ValueTag : uint8_t {
+    NUMBER,
+    STRING,
+    BOOL,
+    NONE,
+    FUNCTION,
+    LIST,
+    DICT,
+    CLASS,
+    INSTANCE,
+    MODULE,
+    RANGE,
+    GENERATOR,  // never written: a suspended frame cannot be saved
+    BUILTIN     // restored by name from the new interpreter's builtins
+};
+
+class Output {
+public:
+    std::string bytes;
+
+    void u8(uint8_t v) { bytes.push_back(static_cast<char>(v)); }
+    void u32(uint32_t v) { raw(&v, sizeof(v)); }
+    void u64(uint64_t v) { raw(&v, sizeof(v)); }
+    void f64(double v) { raw(&v, sizeof(v)); }
+    void str(const std::string& v) {
+        u32(static_cast<uint32_t>(v.size()));
+        bytes += v;
+    }
+    void raw(const void* data, size_t size) { bytes.append(static_cast<const char*>(data), size); }
+    void pad() { bytes.resize((bytes.size() + 7) & ~static_cast<size_t>(7), '\0'); }
+};
+
+class Input {
+private:
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+    const std::string& path;
+
+public:
+    Input(const char* d, size_t s, const std::string& p) : data(d), size(s), path(p) {}
+
+    [[noreturn]] void invalid(const std::string& detail) const {
+        throw std::runtime_error("Invalid snapshot " + path + ": " + detail);
+    }
+
+    const char* take(size_t count) {
+        if (count > size - pos) {
+            invalid("unexpected end of file");
+        }
+        const char* result = data + pos;
+        pos += count;
+        return result;
+    }
+
+    uint8_t u8() { return static_cast<uint8_t>(*take(1)); }
+    uint32_t u32() { return read<uint32_t>(); }
+    uint64_t u64() { return read<uint64_t>(); }
+    double f64() { return read<double>(); }
+    std::string str() {
+        uint32_t length = u32();
+        return std::string(take(length), length);
+    }
+    void pad() { take(((pos + 7) & ~static_cast<size_t>(7)) - pos); }
+    bool atEnd() const { return pos == size; }
+
+private:
+    template <typename T>
+    T read() {
+        T value;
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+};
+
+} // namespace
+
+class Snapshot::Writer {
+private:
+    Interpreter& interpreter;
+    const Program& main_program;
+
+    struct SavedProgram {
+        std::unordered_map<const ASTNode*, uint32_t> indices;
+        std::string bytes;
+    };
+    std::unordered_map<const Program*, uint32_t> program_ids;
+    std::vector<SavedProgram> programs;
+
+    std::unordered_map<const void*, uint32_t> ids;
+    std::vector<const void*> objects;
+    std::vector<ObjectKind> kinds;
+    Output kind_table;
+    Output payloads;
+
+public:
+    Writer(Interpreter& interp, const Program& main) : interpreter(interp), main_program(main) {}
+
+    void write(const std::string& path) {
+        // The globals are always object 1
+        object(interpreter.globals.get(), ObjectKind::GLOBALS);
+
+        Output roots;
+        uint32_t module_count = 0;
+        for (const auto& [name, module] : interpreter.module_cache) {
+            roots.str(name);
+            roots.u32(moduleId(module.get()));
+            module_count++;
+        }
+
+        // Objects reached while writing payloads are appended and written in turn
+        for (size_t i = 0; i < objects.size(); ++i) {
+            writePayload(objects[i], kinds[i]);
+        }
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.program_count = static_cast<uint32_t>(programs.size());
+        header.object_count = static_cast<uint32_t>(objects.size());
+
+        Output out;
+        out.raw(&header, sizeof(header));
+        for (const auto& program : programs) {
+            out.u64(program.bytes.size());
+            out.raw(program.bytes.data(), program.bytes.size());
+            out.pad();
+        }
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Could not write file: " + path);
+        }
+        file.write(out.bytes.data(), static_cast<std::streamsize>(out.bytes.size()));
+        file.write(kind_table.bytes.data(), static_cast<std::streamsize>(kind_table.bytes.size()));
+        file.write(payloads.bytes.data(), static_cast<std::streamsize>(payloads.bytes.size()));
+        file.write(reinterpret_cast<const char*>(&module_count), sizeof(module_count));
+        file.write(roots.bytes.data(), static_cast<std::streamsize>(roots.bytes.size()));
+        if (!file) {
+            throw std::runtime_error("Could not write file: " + path);
+        }
+    }
+
+private:
+    uint32_t object(const void* ptr, ObjectKind kind) {
+        if (!ptr) {
+            return 0;
+        }
+        auto [it, inserted] = ids.emplace(ptr, static_cast<uint32_t>(objects.size() + 1));
+        if (inserted) {
+            objects.push_back(ptr);
+            kinds.push_back(kind);
+            kind_table.u8(static_cast<uint8_t>(kind));
+            if (kind == ObjectKind::BUILTIN_MODULE) {
+                kind_table.str(static_cast<const Module*>(ptr)->name);
+            }
+        }
+        return it->second;
+    }
+
+    uint32_t moduleId(const Module* module) {
+        if (!module) {
+            return 0;
+        }
+        return object(module, module->file_path.empty() ? ObjectKind::BUILTIN_MODULE : ObjectKind::MODULE);
+    }
+
+    uint32_t programId(const Program* program) {
+        // Functions defined by the main program have no source pointer
+        if (!program) {
+            program = &main_program;
+        }
+        auto it = program_ids.find(program);
+        if (it != program_ids.end()) {
+            return it->second;
+        }
+
+        // Flattening parses any deferred function bodies first
+        SavedProgram saved;
+        flat::FlatAst flat(*program, &saved.indices);
+        std::ostringstream bytes;
+        flat.write(bytes);
+        saved.bytes = bytes.str();
+        programs.push_back(std::move(saved));
+        uint32_t id = static_cast<uint32_t>(programs.size());
+        program_ids.emplace(program, id);
+        return id;
+    }
+
+    void code(const Program* source, const ASTNode* node, const std::string& owner) {
+        uint32_t program = programId(source);
+        const auto& indices = programs[program - 1].indices;
+        auto it = indices.find(node);
+        if (it == indices.end()) {
+            throw std::runtime_error("Cannot snapshot " + owner + ": its code is not part of a saved program");
+        }
+        payloads.u32(program);
+        payloads.u32(it->second);
+    }
+
+    uint32_t value(const Value& v) {
+        return object(v.get(), ObjectKind::VALUE);
+    }
+
+    void writePayload(const void* ptr, ObjectKind kind) {
+        switch (kind) {
+            case ObjectKind::VALUE:
+                writeValue(*static_cast<const ValueWrapper*>(ptr));
+                break;
+            case ObjectKind::ENVIRONMENT:
+            case ObjectKind::GLOBALS: {
+                auto env = static_cast<const Environment*>(ptr);
+                payloads.u32(kind == ObjectKind::GLOBALS ? 0 : object(env->parent.get(), ObjectKind::ENVIRONMENT));
+                payloads.u8(env->module_scope ? 1 : 0);
+                payloads.u32(static_cast<uint32_t>(env->variables.size()));
+                for (const auto& [name, binding] : env->variables) {
+                    payloads.str(name);
+                    payloads.u32(object(binding.cell.get(), ObjectKind::CELL));
+                    payloads.u32(value(binding.value));
+                }
+                break;
+            }
+            case ObjectKind::CELL:
+                payloads.u32(value(static_cast<const Cell*>(ptr)->value));
+                break;
+            case ObjectKind::FUNCTION: {
+                auto function = static_cast<const Function*>(ptr);
+                payloads.str(function->name);
+                payloads.u32(static_cast<uint32_t>(function->parameters.size()));
+                for (const auto& param : function->parameters) {
+                    payloads.str(param);
+                }
+                // Flattening the program first parses a deferred body
+                programId(function->source.get());
+                const BlockStatement* body = function->deferred ? function->deferred->body.get() : function->body;
+                code(function->source.get(), body, "a function");
+                payloads.u32(object(function->closure.get(), ObjectKind::ENVIRONMENT));
+                payloads.u8(function->deferred ? function->deferred->uses_frame_slots : function->uses_frame_slots);
+                payloads.u8(function->deferred ? function->deferred->is_generator : function->is_generator);
+                const auto& number_locals = function->deferred ? function->deferred->number_locals : function->number_locals;
+                payloads.u32(static_cast<uint32_t>(number_locals.size()));
+                for (const auto& name : number_locals) {
+                    payloads.str(name);
+                }
+                payloads.u32(object(function->owner.lock().get(), ObjectKind::CLASS));
+                break;
+            }
+            case ObjectKind::CLASS: {
+                auto cls = static_cast<const Class*>(ptr);
+                payloads.str(cls->name);
+                code(cls->source.get(), cls->body, "class '" + cls->name + "'");
+                payloads.u32(object(cls->closure.get(), ObjectKind::ENVIRONMENT));
+                payloads.u32(object(cls->base.get(), ObjectKind::CLASS));
+                payloads.u32(static_cast<uint32_t>(cls->methods.size()));
+                for (const auto& [name, method] : cls->methods) {
+                    payloads.str(name);
+                    payloads.u32(value(method));
+                }
+                break;
+            }
+            case ObjectKind::INSTANCE: {
+                auto instance = static_cast<const ClassInstance*>(ptr);
+                payloads.u32(object(instance->classRef.get(), ObjectKind::CLASS));
+                payloads.u32(static_cast<uint32_t>(instance->attributes.size()));
+                for (const auto& [name, attr] : instance->attributes) {
+                    payloads.str(name);
+                    payloads.u32(value(attr));
+                }
+                break;
+            }
+            case ObjectKind::MODULE: {
+                auto module = static_cast<const Module*>(ptr);
+                payloads.str(module->name);
+                payloads.str(module->file_path);
+                payloads.u32(object(module->module_env.get(), ObjectKind::ENVIRONMENT));
+                payloads.u32(module->ast ? programId(module->ast.get()) : 0);
+                payloads.u64(static_cast<uint64_t>(module->mtime.time_since_epoch().count()));
+                break;
+            }
+            case ObjectKind::BUILTIN_MODULE:
+                break;
+        }
+    }
+
+    void writeValue(const ValueWrapper& wrapper) {
+        payloads.u8(static_cast<uint8_t>(wrapper.value.index()));
+        switch (static_cast<ValueTag>(wrapper.value.index())) {
+            case ValueTag::NUMBER:
+                payloads.f64(std::get<double>(wrapper.value));
+                break;
+            case ValueTag::STRING:
+                payloads.str(std::get<std::string>(wrapper.value));
+                break;
+            case ValueTag::BOOL:
+                payloads.u8(std::get<bool>(wrapper.value) ? 1 : 0);
+                break;
+            case ValueTag::NONE:
+                break;
+            case ValueTag::FUNCTION:
+                payloads.u32(object(std::get<std::shared_ptr<Function>>(wrapper.value).get(), ObjectKind::FUNCTION));
+                break;
+            case ValueTag::LIST: {
+                const auto& list = std::get<ListType>(wrapper.value);
+                payloads.u32(static_cast<uint32_t>(list.size()));
+                for (const auto& item : list) {
+                    payloads.u32(value(item));
+                }
+                break;
+            }
+            case ValueTag::DICT: {
+                const auto& dict = std::get<DictType>(wrapper.value);
+                payloads.u32(static_cast<uint32_t>(dict.size()));
+                for (const auto& [key, item] : dict) {
+                    payloads.str(key);
+                    payloads.u32(value(item));
+                }
+                break;
+            }
+            case ValueTag::CLASS:
+                payloads.u32(object(std::get<std::shared_ptr<Class>>(wrapper.value).get(), ObjectKind::CLASS));
+                break;
+            case ValueTag::INSTANCE:
+                payloads.u32(object(std::get<std::shared_ptr<ClassInstance>>(wrapper.value).get(), ObjectKind::INSTANCE));
+                break;
+            case ValueTag::MODULE:
+                payloads.u32(moduleId(std::get<std::shared_ptr<Module>>(wrapper.value).get()));
+                break;
+            case ValueTag::RANGE: {
+                const auto& range = std::get<Range>(wrapper.value);
+                payloads.f64(range.start);
+                payloads.f64(range.stop);
+                payloads.f64(range.step);
+                break;
+            }
+            case ValueTag::GENERATOR:
+                throw std::runtime_error("Cannot snapshot a generator");
+            case ValueTag::BUILTIN:
+                payloads.str(std::get<std::shared_ptr<const Builtin>>(wrapper.value)->name);
+                break;
+        }
+    }
+};
+
+class Snapshot::Reader {
+private:
+    Interpreter& interpreter;
+    GarbageCollector& collector;
+    Input in;
+
+    std::vector<std::shared_ptr<Program>> programs;
+    std::vector<std::vector<const BlockStatement*>> blocks;
+
+    // Indexed by object id; only the vector matching an object's kind is set
+    std::vector<ObjectKind> kinds;
+    std::vector<Value> values;
+    std::vector<std::shared_ptr<Environment>> environments;
+    std::vector<std::shared_ptr<Cell>> cells;
+    std::vector<std::shared_ptr<Function>> functions;
+    std::vector<std::shared_ptr<Class>> classes;
+    std::vector<std::shared_ptr<ClassInstance>> instances;
+    std::vector<std::shared_ptr<Module>> modules;
+
+public:
+    Reader(Interpreter& interp, const char* data, size_t size, const std::string& path)
+        : interpreter(interp), collector(interp.collector), in(data, size, path) {}
+
+    void read() {
+        Header header;
+        std::memcpy(&header, in.take(sizeof(header)), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            in.invalid("not a snapshot file");
+        }
+        if (header.version != VERSION || header.byte_order != BYTE_ORDER_MARK) {
+            in.invalid("written by an incompatible version or platform");
+        }
+
+        // Code first: functions and classes point into it
+        for (uint32_t i = 0; i < header.program_count; ++i) {
+            uint64_t size = in.u64();
+            const char* bytes = in.take(size);
+            in.pad();
+            flat::FlatAstView view = flat::FlatAstView::fromBuffer(bytes, size, "program " + std::to_string(i + 1));
+            blocks.emplace_back();
+            programs.push_back(view.inflate(&blocks.back()));
+        }
+
+        // Every object is created before any is filled in, so references
+        // (including cycles) can be resolved in one pass
+        uint32_t count = header.object_count;
+        kinds.resize(count + 1);
+        values.resize(count + 1);
+        environments.resize(count + 1);
+        cells.resize(count + 1);
+        functions.resize(count + 1);
+        classes.resize(count + 1);
+        instances.resize(count + 1);
+        modules.resize(count + 1);
+        for (uint32_t id = 1; id <= count; ++id) {
+            createObject(id);
+        }
+
+        // The globals are bound last, so a bad file leaves them untouched
+        std::vector<std::pair<std::string, Environment::Binding>> global_bindings;
+        for (uint32_t id = 1; id <= count; ++id) {
+            if (kinds[id] == ObjectKind::GLOBALS) {
+                in.u32();
+                in.u8();
+                global_bindings = readBindings();
+            } else {
+                readPayload(id);
+            }
+        }
+
+        std::vector<std::pair<std::string, std::shared_ptr<Module>>> cached;
+        uint32_t module_count = in.u32();
+        for (uint32_t i = 0; i < module_count; ++i) {
+            std::string name = in.str();
+            cached.emplace_back(name, module(in.u32()));
+        }
+        if (!in.atEnd()) {
+            in.invalid("trailing data");
+        }
+
+        for (auto& [name, binding] : global_bindings) {
+            interpreter.globals->variables[Symbol(name)] = std::move(binding);
+        }
+        for (auto& [name, mod] : cached) {
+            if (mod) {
+                interpreter.module_cache[name] = mod;
+            }
+        }
+    }
+
+private:
+    void createObject(uint32_t id) {
+        ObjectKind kind = static_cast<ObjectKind>(in.u8());
+        kinds[id] = kind;
+        switch (kind) {
+            case ObjectKind::VALUE:
+                values[id] = makeValue(nullptr);
+                break;
+            case ObjectKind::ENVIRONMENT:
+                environments[id] = makeEnvironment();
+                break;
+            case ObjectKind::GLOBALS:
+                environments[id] = interpreter.globals;
+                break;
+            case ObjectKind::CELL:
+                cells[id] = std::make_shared<Cell>();
+                collector.track(cells[id], GCKind::CELL);
+                break;
+            case ObjectKind::FUNCTION:
+                functions[id] = std::make_shared<Function>(std::vector<Symbol>(), nullptr, nullptr);
+                collector.track(functions[id], GCKind::FUNCTION);
+                break;
+            case ObjectKind::CLASS:
+                classes[id] = std::make_shared<Class>("", nullptr, nullptr);
+                collector.track(classes[id], GCKind::CLASS);
+                break;
+            case ObjectKind::INSTANCE:
+                instances[id] = std::make_shared<ClassInstance>(nullptr);
+                collector.track(instances[id], GCKind::INSTANCE);
+                break;
+            case ObjectKind::MODULE:
+                modules[id] = std::make_shared<Module>();
+                collector.track(modules[id], GCKind::MODULE);
+                break;
+            case ObjectKind::BUILTIN_MODULE: {
+                std::string name = in.str();
+                auto it = interpreter.module_cache.find(name);
+                if (it == interpreter.module_cache.end()) {
+                    in.invalid("unknown built-in module '" + name + "'");
+                }
+                modules[id] = it->second;
+                break;
+            }
+            default:
+                in.invalid("unknown object kind");
+        }
+    }
+
+    // Typed references; 0 is no object
+    template <typename T>
+    const T& reference(std::vector<T>& table, uint32_t id, ObjectKind expected, ObjectKind alternative) {
+        static const T none;
+        if (id == 0) {
+            return none;
+        }
+        if (id >= kinds.size() || (kinds[id] != expected && kinds[id] != alternative)) {
+            in.invalid("object " + std::to_string(id) + " has the wrong kind");
+        }
+        return table[id];
+    }
+
+    Value value(uint32_t id) { return reference(values, id, ObjectKind::VALUE, ObjectKind::VALUE); }
+    std::shared_ptr<Environment> environment(uint32_t id) {
+        return reference(environments, id, ObjectKind::ENVIRONMENT, ObjectKind::GLOBALS);
+    }
+    std::shared_ptr<Cell> cell(uint32_t id) { return reference(cells, id, ObjectKind::CELL, ObjectKind::CELL); }
+    std::shared_ptr<Function> function(uint32_t id) {
+        return reference(functions, id, ObjectKind::FUNCTION, ObjectKind::FUNCTION);
+    }
+    std::shared_ptr<Class> cls(uint32_t id) { return reference(classes, id, ObjectKind::CLASS, ObjectKind::CLASS); }
+    std::shared_ptr<ClassInstance> instance(uint32_t id) {
+        return reference(instances, id, ObjectKind::INSTANCE, ObjectKind::INSTANCE);
+    }
+    std::shared_ptr<Module> module(uint32_t id) {
+        return reference(modules, id, ObjectKind::MODULE, ObjectKind::BUILTIN_MODULE);
+    }
+
+    std::shared_ptr<Program> program(uint32_t id) {
+        if (id == 0 || id > programs.size()) {
+            in.invalid("invalid program " + std::to_string(id));
+        }
+        return programs[id - 1];
+    }
+
+    // (program, node index) of a function or class body
+    std::pair<std::shared_ptr<Program>, const BlockStatement*> code() {
+        uint32_t id = in.u32();
+        uint32_t index = in.u32();
+        std::shared_ptr<Program> source = program(id);
+        const auto& table = blocks[id - 1];
+        if (index >= table.size() || !table[index]) {
+            in.invalid("node " + std::to_string(index) + " is not a block");
+        }
+        return {source, table[index]};
+    }
+
+    std::vector<std::pair<std::string, Environment::Binding>> readBindings() {
+        std::vector<std::pair<std::string, Environment::Binding>> bindings;
+        uint32_t count = in.u32();
+        for (uint32_t i = 0; i < count; ++i) {
+            std::string name = in.str();
+            Environment::Binding binding;
+            binding.cell = cell(in.u32());
+            binding.value = value(in.u32());
+            bindings.emplace_back(std::move(name), std::move(binding));
+        }
+        return bindings;
+    }
+
+    void readPayload(uint32_t id) {
+        switch (kinds[id]) {
+            case ObjectKind::VALUE:
+                readValue(*values[id]);
+                // Containers and references take part in cycles, like makeValue() does
+                if (values[id]->value.index() >= static_cast<size_t>(ValueTag::FUNCTION) &&
+                    values[id]->value.index() <= static_cast<size_t>(ValueTag::MODULE)) {
+                    collector.track(values[id], GCKind::VALUE);
+                }
+                break;
+            case ObjectKind::ENVIRONMENT: {
+                auto& env = environments[id];
+                env->parent = environment(in.u32());
+                env->module_scope = in.u8() != 0;
+                for (auto& [name, binding] : readBindings()) {
+                    env->variables[Symbol(name)] = std::move(binding);
+                }
+                break;
+            }
+            case ObjectKind::CELL:
+                cells[id]->value = value(in.u32());
+                break;
+            case ObjectKind::FUNCTION: {
+                auto& fn = functions[id];
+                fn->name = Symbol(in.str());
+                uint32_t params = in.u32();
+                for (uint32_t i = 0; i < params; ++i) {
+                    fn->parameters.emplace_back(in.str());
+                }
+                auto [source, body] = code();
+                fn->source = source;
+                fn->body = body;
+                fn->closure = environment(in.u32());
+                fn->uses_frame_slots = in.u8() != 0;
+                fn->is_generator = in.u8() != 0;
+                uint32_t number_locals = in.u32();
+                for (uint32_t i = 0; i < number_locals; ++i) {
+                    fn->number_locals.emplace_back(in.str());
+                }
+                fn->owner = cls(in.u32());
+                break;
+            }
+            case ObjectKind::CLASS: {
+                auto& c = classes[id];
+                c->name = in.str();
+                auto [source, body] = code();
+                c->source = source;
+                c->body = body;
+                c->closure = environment(in.u32());
+                c->base = cls(in.u32());
+                uint32_t methods = in.u32();
+                for (uint32_t i = 0; i < methods; ++i) {
+                    Symbol name(in.str());
+                    c->methods[name] = value(in.u32());
+                }
+                break;
+            }
+            case ObjectKind::INSTANCE: {
+                auto& obj = instances[id];
+                obj->classRef = cls(in.u32());
+                if (!obj->classRef) {
+                    in.invalid("instance without a class");
+                }
+                uint32_t attributes = in.u32();
+                for (uint32_t i = 0; i < attributes; ++i) {
+                    Symbol name(in.str());
+                    obj->attributes[name] = value(in.u32());
+                }
+                break;
+            }
+            case ObjectKind::MODULE: {
+                auto& mod = modules[id];
+                mod->name = in.str();
+                mod->file_path = in.str();
+                mod->module_env = environment(in.u32());
+                if (!mod->module_env) {
+                    in.invalid("module without an environment");
+                }
+                uint32_t ast = in.u32();
+                mod->ast = ast ? program(ast) : nullptr;
+                mod->mtime = std::filesystem::file_time_type(
+                    std::filesystem::file_time_type::duration(static_cast<int64_t>(in.u64())));
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void readValue(ValueWrapper& wrapper) {
+        switch (static_cast<ValueTag>(in.u8())) {
+            case ValueTag::NUMBER:
+                wrapper.value = in.f64();
+                break;
+            case ValueTag::STRING:
+                wrapper.value = in.str();
+                break;
+            case ValueTag::BOOL:
+                wrapper.value = in.u8() != 0;
+                break;
+            case ValueTag::NONE:
+                wrapper.value = nullptr;
+                break;
+            case ValueTag::FUNCTION:
+                wrapper.value = nonNull(function(in.u32()));
+                break;
+            case ValueTag::LIST: {
+                ListType list;
+                uint32_t count = in.u32();
+                for (uint32_t i = 0; i < count; ++i) {
+                    list.push_back(nonNull(value(in.u32())));
+                }
+                wrapper.value = std::move(list);
+                break;
+            }
+            case ValueTag::DICT: {
+                DictType dict;
+                uint32_t count = in.u32();
+                for (uint32_t i = 0; i < count; ++i) {
+                    std::string key = in.str();
+                    dict[key] = nonNull(value(in.u32()));
+                }
+                wrapper.value = std::move(dict);
+                break;
+            }
+            case ValueTag::CLASS:
+                wrapper.value = nonNull(cls(in.u32()));
+                break;
+            case ValueTag::INSTANCE:
+                wrapper.value = nonNull(instance(in.u32()));
+                break;
+            case ValueTag::MODULE:
+                wrapper.value = nonNull(module(in.u32()));
+                break;
+            case ValueTag::RANGE: {
+                Range range;
+                range.start = in.f64();
+                range.stop = in.f64();
+                range.step = in.f64();
+                wrapper.value = range;
+                break;
+            }
+            case ValueTag::BUILTIN: {
+                auto builtin = interpreter.builtins.find(Symbol(in.str()));
+                if (builtin == interpreter.builtins.end()) {
+                    in.invalid("unknown builtin");
+                }
+                wrapper.value = builtin->second->value;
+                break;
+            }
+            default:
+                in.invalid("unknown value type");
+        }
+    }
+
+    template <typename T>
+    T nonNull(T object) {
+        if (!object) {
+            in.invalid("missing object in a value");
+        }
+        return object;
+    }
+};
+
+void Snapshot::save(Interpreter& interpreter, const std::string& path, const Program& main_program) {
+    Writer writer(interpreter, main_program);
+    writer.write(path);
+}
+
+void Snapshot::restore(Interpreter& interpreter, const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    size_t size = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+
+    // Flat ASTs are read in place and need 8-byte alignment
+    std::vector<uint64_t> buffer((size + 7) / 8);
+    char* data = reinterpret_cast<char*>(buffer.data());
+    if (!file.read(data, static_cast<std::streamsize>(size))) {
+        throw std::runtime_error("Could not read file: " + path);
+    }
+
+    Reader reader(interpreter, data, size, path);
+    reader.read();
+}
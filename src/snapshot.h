@@ -0,0 +1,24 @@
+#pragma once
+#include "interpreter.h"
+#include <string>
+
+// Heap snapshots for warm starts.
+//
+// save() writes the interpreter's globals, its cached modules and every
+// object they reach (environments and cells, functions, classes, instances,
+// lists, dicts and scalars, with sharing and cycles preserved) together with
+// the ASTs those functions and classes point into, stored as flat ASTs.
+// restore() rebuilds the same heap in a fresh interpreter: globals are bound
+// again and the modules go into the module cache, so importing them does not
+// run their code a second time. Built-in modules are referenced by name.
+class Snapshot {
+public:
+    // main_program is the program the interpreter ran; functions defined by
+    // it point into its AST
+    static void save(Interpreter& interpreter, const std::string& path, const Program& main_program);
+    static void restore(Interpreter& interpreter, const std::string& path);
+
+private:
+    class Writer;
+    class Reader;
+};
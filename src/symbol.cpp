@@ -0,0 +1,47 @@
+#include "symbol.h"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// Sharded so parser threads interning different names rarely contend
+struct Shard {
+    std::mutex mutex;
+    std::unordered_map<std::string_view, std::unique_ptr<const std::string>> names;
+};
+
+constexpr size_t SHARD_COUNT = 16;
+
+// Function-local so symbols can be made during static initialization
+const std::string* emptyName() {
+    static const std::string empty;
+    return &empty;
+}
+
+Shard* shards() {
+    static Shard table[SHARD_COUNT];
+    return table;
+}
+
+const std::string* intern(std::string_view text) {
+    if (text.empty()) {
+        return emptyName();
+    }
+    Shard& shard = shards()[std::hash<std::string_view>()(text) % SHARD_COUNT];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.names.find(text);
+    if (it != shard.names.end()) {
+        return it->second.get();
+    }
+    auto name = std::make_unique<const std::string>(text);
+    const std::string* address = name.get();
+    shard.names.emplace(*address, std::move(name));
+    return address;
+}
+
+} // namespace
+
+Symbol::Symbol() noexcept : text(emptyName()) {}
+
+Symbol::Symbol(std::string_view text) : text(intern(text)) {}
@@ -0,0 +1,88 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Interned name: there is one canonical string per distinct name, so two
+// symbols are equal exactly when they point at the same string, and hashing
+// one hashes the pointer. Identifiers, attribute and parameter names are
+// interned once when they are parsed; every name-keyed map at run time
+// (environments, class methods, instance attributes) is keyed by Symbol.
+//
+// Interning is thread-safe (the parallel parser interns from its workers)
+// and interned names live until the process exits. Making a symbol from a
+// string is explicit, as it takes a lock; reading the name back is free.
+class Symbol {
+public:
+    Symbol() noexcept;  // the empty name
+    explicit Symbol(std::string_view text);
+    explicit Symbol(const std::string& text) : Symbol(std::string_view(text)) {}
+    explicit Symbol(const char* text) : Symbol(std::string_view(text)) {}
+    
+    const std::string& str() const noexcept { return *text; }
+    operator const std::string&() const noexcept { return *text; }
+    bool empty() const noexcept { return text->empty(); }
+    const std::string* address() const noexcept { return text; }
+    
+    friend bool operator==(Symbol a, Symbol b) noexcept { return a.text == b.text; }
+    friend bool operator!=(Symbol a, Symbol b) noexcept { return a.text != b.text; }
+    friend bool operator==(Symbol a, const std::string& b) { return *a.text == b; }
+    friend bool operator!=(Symbol a, const std::string& b) { return *a.text != b; }
+    friend bool operator==(const std::string& a, Symbol b) { return a == *b.text; }
+    friend bool operator!=(const std::string& a, Symbol b) { return a != *b.text; }
+    friend bool operator==(Symbol a, const char* b) { return *a.text == b; }
+    friend bool operator!=(Symbol a, const char* b) { return *a.text != b; }
+    
+    // For building messages
+    friend std::string operator+(const std::string& a, Symbol b) { return a + *b.text; }
+    friend std::string operator+(const char* a, Symbol b) { return a + *b.text; }
+    friend std::string operator+(Symbol a, const std::string& b) { return *a.text + b; }
+    friend std::string operator+(Symbol a, const char* b) { return *a.text + b; }
+    friend std::ostream& operator<<(std::ostream& out, Symbol symbol) { return out << *symbol.text; }
+    
+private:
+    const std::string* text;
+};
+
+namespace std {
+template <>
+struct hash<Symbol> {
+    size_t operator()(Symbol symbol) const noexcept {
+        // Interned strings are heap nodes, so the low bits carry no information
+        return reinterpret_cast<size_t>(symbol.address()) >> 4;
+    }
+};
+} // namespace std
+
+// Set of symbols that iterates in insertion order, so passes that collect
+// names by hash still report them in a stable, source-like order
+class SymbolSet {
+public:
+    bool insert(Symbol symbol) {
+        if (!members.insert(symbol).second) return false;
+        order.push_back(symbol);
+        return true;
+    }
+    template <typename Iterator>
+    void insert(Iterator first, Iterator last) {
+        for (; first != last; ++first) insert(*first);
+    }
+    size_t erase(Symbol symbol) {
+        if (!members.erase(symbol)) return 0;
+        order.erase(std::find(order.begin(), order.end(), symbol));
+        return 1;
+    }
+    size_t count(Symbol symbol) const { return members.count(symbol); }
+    size_t size() const noexcept { return order.size(); }
+    std::vector<Symbol>::const_iterator begin() const noexcept { return order.begin(); }
+    std::vector<Symbol>::const_iterator end() const noexcept { return order.end(); }
+    
+private:
+    std::vector<Symbol> order;
+    std::unordered_set<Symbol> members;
+};
@@ -0,0 +1,455 @@
+#include "type_inference.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Finds the locals a body assigns and rules out the ones that are bound some
+// other way or visible to nested scopes. Nested function bodies are separate
+// scopes and are not entered.
+class Candidates {
+public:
+    SymbolSet names;
+    std::unordered_map<Symbol, std::string> boxed; // name -> reason
+    std::vector<AssignmentStatement*> assignments;
+    bool defines_class = false;
+
+    void statements(std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (auto& stmt : stmts) statement(*stmt);
+    }
+
+    void statement(Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::ASSIGNMENT_STMT: {
+                auto& assign = static_cast<AssignmentStatement&>(stmt);
+                names.insert(assign.identifier);
+                assignments.push_back(&assign);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                auto& if_stmt = static_cast<IfStatement&>(stmt);
+                statements(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) statement(*if_stmt.else_branch);
+                break;
+            }
+            case NodeType::WHILE_STMT:
+                statements(static_cast<WhileStatement&>(stmt).body->statements);
+                break;
+            case NodeType::FOR_STMT: {
+                auto& for_stmt = static_cast<ForStatement&>(stmt);
+                bind(for_stmt.variable, "bound by a for loop");
+                statements(for_stmt.body->statements);
+                break;
+            }
+            case NodeType::BLOCK_STMT:
+                statements(static_cast<BlockStatement&>(stmt).statements);
+                break;
+            case NodeType::TRY_STMT: {
+                auto& try_stmt = static_cast<TryStatement&>(stmt);
+                statements(try_stmt.try_body->statements);
+                for (auto& clause : try_stmt.except_clauses) {
+                    if (!clause.variable_name.empty()) bind(clause.variable_name, "bound by an except clause");
+                    statements(clause.body->statements);
+                }
+                break;
+            }
+            case NodeType::FUNCTION_DEF_STMT: {
+                const auto& def = static_cast<const FunctionDefStatement&>(stmt);
+                bind(def.name, "bound by def");
+                for (const auto& name : def.free_names) {
+                    bind(name, "used by a nested function");
+                }
+                break;
+            }
+            case NodeType::CLASS_DEF_STMT:
+                bind(static_cast<const ClassDefStatement&>(stmt).name, "bound by class");
+                defines_class = true;
+                break;
+            case NodeType::IMPORT_STMT: {
+                const auto& import_stmt = static_cast<const ImportStatement&>(stmt);
+                bind(Symbol(import_stmt.alias.empty() ? import_stmt.module_name : import_stmt.alias), "bound by import");
+                break;
+            }
+            case NodeType::FROM_IMPORT_STMT:
+                for (const auto& [name, alias] : static_cast<const FromImportStatement&>(stmt).imports) {
+                    bind(Symbol(alias.empty() ? name : alias), "bound by import");
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+private:
+    void bind(Symbol name, const std::string& reason) {
+        boxed.emplace(name, reason);
+    }
+};
+
+// Walks the body in execution order tracking the names definitely assigned
+// at each point. A name first assigned inside a block only lives until the
+// block ends, so blocks restore the set they started with.
+class DefiniteAssignment {
+public:
+    DefiniteAssignment(const SymbolSet& candidates, std::unordered_map<Symbol, std::string>& boxed)
+        : candidates(candidates), boxed(boxed) {}
+
+    void statements(const std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (const auto& stmt : stmts) statement(*stmt);
+    }
+
+private:
+    const SymbolSet& candidates;
+    std::unordered_map<Symbol, std::string>& boxed;
+    std::unordered_set<Symbol> assigned;
+
+    void block(const std::vector<std::unique_ptr<Statement>>& stmts) {
+        auto outer = assigned;
+        statements(stmts);
+        assigned = std::move(outer);
+    }
+
+    void statement(const Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::EXPRESSION_STMT:
+                expression(*static_cast<const ExpressionStatement&>(stmt).expression);
+                break;
+            case NodeType::ASSIGNMENT_STMT: {
+                const auto& assign = static_cast<const AssignmentStatement&>(stmt);
+                expression(*assign.value);
+                assigned.insert(assign.identifier);
+                break;
+            }
+            case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+                const auto& assign = static_cast<const AttributeAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::INDEX_ASSIGNMENT_STMT: {
+                const auto& assign = static_cast<const IndexAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.index);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                const auto& if_stmt = static_cast<const IfStatement&>(stmt);
+                expression(*if_stmt.condition);
+                block(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) statement(*if_stmt.else_branch);
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                const auto& while_stmt = static_cast<const WhileStatement&>(stmt);
+                expression(*while_stmt.condition);
+                block(while_stmt.body->statements);
+                break;
+            }
+            case NodeType::FOR_STMT: {
+                const auto& for_stmt = static_cast<const ForStatement&>(stmt);
+                expression(*for_stmt.iterable);
+                block(for_stmt.body->statements);
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                const auto& return_stmt = static_cast<const ReturnStatement&>(stmt);
+                if (return_stmt.value) expression(*return_stmt.value);
+                break;
+            }
+            case NodeType::BLOCK_STMT:
+                block(static_cast<const BlockStatement&>(stmt).statements);
+                break;
+            case NodeType::TRY_STMT: {
+                const auto& try_stmt = static_cast<const TryStatement&>(stmt);
+                block(try_stmt.try_body->statements);
+                for (const auto& clause : try_stmt.except_clauses) {
+                    block(clause.body->statements);
+                }
+                break;
+            }
+            case NodeType::CLASS_DEF_STMT: {
+                const auto& class_def = static_cast<const ClassDefStatement&>(stmt);
+                if (class_def.base) expression(*class_def.base);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void expression(const Expression& expr) {
+        switch (expr.type) {
+            case NodeType::IDENTIFIER_EXPR: {
+                const auto& name = static_cast<const IdentifierExpression&>(expr).name;
+                if (candidates.count(name) && !assigned.count(name)) {
+                    boxed.emplace(name, "may be read before it is assigned");
+                }
+                break;
+            }
+            case NodeType::BINARY_EXPR: {
+                const auto& bin = static_cast<const BinaryExpression&>(expr);
+                expression(*bin.left);
+                expression(*bin.right);
+                break;
+            }
+            case NodeType::UNARY_EXPR:
+                expression(*static_cast<const UnaryExpression&>(expr).operand);
+                break;
+            case NodeType::CALL_EXPR: {
+                const auto& call = static_cast<const CallExpression&>(expr);
+                expression(*call.callee);
+                for (const auto& arg : call.arguments) expression(*arg);
+                break;
+            }
+            case NodeType::LIST_EXPR:
+                for (const auto& elem : static_cast<const ListExpression&>(expr).elements) expression(*elem);
+                break;
+            case NodeType::DICT_EXPR:
+                for (const auto& pair : static_cast<const DictExpression&>(expr).pairs) {
+                    expression(*pair.first);
+                    expression(*pair.second);
+                }
+                break;
+            case NodeType::INDEX_EXPR: {
+                const auto& index = static_cast<const IndexExpression&>(expr);
+                expression(*index.object);
+                expression(*index.index);
+                break;
+            }
+            case NodeType::ATTRIBUTE_EXPR:
+                expression(*static_cast<const AttributeExpression&>(expr).object);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+// True if expr always evaluates to a number (or raises), given that the
+// names in numbers hold numbers. - * / % and unary minus only accept numbers;
+// + yields a number whenever one side is one.
+bool isNumber(const Expression& expr, const SymbolSet& numbers) {
+    switch (expr.type) {
+        case NodeType::NUMBER_EXPR:
+            return true;
+        case NodeType::IDENTIFIER_EXPR:
+            return numbers.count(static_cast<const IdentifierExpression&>(expr).name) > 0;
+        case NodeType::UNARY_EXPR:
+            return static_cast<const UnaryExpression&>(expr).operator_type == TokenType::MINUS;
+        case NodeType::BINARY_EXPR: {
+            const auto& bin = static_cast<const BinaryExpression&>(expr);
+            switch (bin.operator_type) {
+                case TokenType::MINUS:
+                case TokenType::MULTIPLY:
+                case TokenType::DIVIDE:
+                case TokenType::MODULO:
+                    return true;
+                case TokenType::PLUS:
+                    return isNumber(*bin.left, numbers) || isNumber(*bin.right, numbers);
+                default:
+                    return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+// Points reads and writes of number locals at their slots and marks the
+// expressions that can be computed without boxing
+class SlotAnnotator {
+public:
+    explicit SlotAnnotator(const std::unordered_map<Symbol, int>& slots) : slots(slots) {}
+
+    void statements(std::vector<std::unique_ptr<Statement>>& stmts) {
+        for (auto& stmt : stmts) statement(*stmt);
+    }
+
+private:
+    const std::unordered_map<Symbol, int>& slots;
+
+    void statement(Statement& stmt) {
+        switch (stmt.type) {
+            case NodeType::EXPRESSION_STMT:
+                expression(*static_cast<ExpressionStatement&>(stmt).expression);
+                break;
+            case NodeType::ASSIGNMENT_STMT: {
+                auto& assign = static_cast<AssignmentStatement&>(stmt);
+                auto it = slots.find(assign.identifier);
+                assign.number_slot = it == slots.end() ? -1 : it->second;
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::ATTRIBUTE_ASSIGNMENT_STMT: {
+                auto& assign = static_cast<AttributeAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::INDEX_ASSIGNMENT_STMT: {
+                auto& assign = static_cast<IndexAssignmentStatement&>(stmt);
+                expression(*assign.object);
+                expression(*assign.index);
+                expression(*assign.value);
+                break;
+            }
+            case NodeType::IF_STMT: {
+                auto& if_stmt = static_cast<IfStatement&>(stmt);
+                expression(*if_stmt.condition);
+                statements(if_stmt.then_branch->statements);
+                if (if_stmt.else_branch) statement(*if_stmt.else_branch);
+                break;
+            }
+            case NodeType::WHILE_STMT: {
+                auto& while_stmt = static_cast<WhileStatement&>(stmt);
+                expression(*while_stmt.condition);
+                statements(while_stmt.body->statements);
+                break;
+            }
+            case NodeType::FOR_STMT: {
+                auto& for_stmt = static_cast<ForStatement&>(stmt);
+                expression(*for_stmt.iterable);
+                statements(for_stmt.body->statements);
+                break;
+            }
+            case NodeType::RETURN_STMT: {
+                auto& return_stmt = static_cast<ReturnStatement&>(stmt);
+                if (return_stmt.value) expression(*return_stmt.value);
+                break;
+            }
+            case NodeType::BLOCK_STMT:
+                statements(static_cast<BlockStatement&>(stmt).statements);
+                break;
+            case NodeType::TRY_STMT: {
+                auto& try_stmt = static_cast<TryStatement&>(stmt);
+                statements(try_stmt.try_body->statements);
+                for (auto& clause : try_stmt.except_clauses) {
+                    statements(clause.body->statements);
+                }
+                break;
+            }
+            case NodeType::CLASS_DEF_STMT: {
+                auto& class_def = static_cast<ClassDefStatement&>(stmt);
+                if (class_def.base) expression(*class_def.base);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    bool expression(Expression& expr) {
+        switch (expr.type) {
+            case NodeType::NUMBER_EXPR:
+                expr.unboxed = true;
+                break;
+            case NodeType::IDENTIFIER_EXPR: {
+                auto& id = static_cast<IdentifierExpression&>(expr);
+                auto it = slots.find(id.name);
+                if (it != slots.end()) {
+                    id.number_slot = it->second;
+                    expr.unboxed = true;
+                }
+                break;
+            }
+            case NodeType::UNARY_EXPR: {
+                auto& un = static_cast<UnaryExpression&>(expr);
+                bool operand = expression(*un.operand);
+                expr.unboxed = operand && un.operator_type == TokenType::MINUS;
+                break;
+            }
+            case NodeType::BINARY_EXPR: {
+                auto& bin = static_cast<BinaryExpression&>(expr);
+                bool left = expression(*bin.left);
+                bool right = expression(*bin.right);
+                bool arithmetic = bin.operator_type == TokenType::PLUS || bin.operator_type == TokenType::MINUS ||
+                                  bin.operator_type == TokenType::MULTIPLY || bin.operator_type == TokenType::DIVIDE ||
+                                  bin.operator_type == TokenType::MODULO;
+                expr.unboxed = left && right && arithmetic;
+                break;
+            }
+            case NodeType::CALL_EXPR: {
+                auto& call = static_cast<CallExpression&>(expr);
+                expression(*call.callee);
+                for (auto& arg : call.arguments) expression(*arg);
+                break;
+            }
+            case NodeType::LIST_EXPR:
+                for (auto& elem : static_cast<ListExpression&>(expr).elements) expression(*elem);
+                break;
+            case NodeType::DICT_EXPR:
+                for (auto& pair : static_cast<DictExpression&>(expr).pairs) {
+                    expression(*pair.first);
+                    expression(*pair.second);
+                }
+                break;
+            case NodeType::INDEX_EXPR: {
+                auto& index = static_cast<IndexExpression&>(expr);
+                expression(*index.object);
+                expression(*index.index);
+                break;
+            }
+            case NodeType::ATTRIBUTE_EXPR:
+                expression(*static_cast<AttributeExpression&>(expr).object);
+                break;
+            default:
+                break;
+        }
+        return expr.unboxed;
+    }
+};
+
+} // namespace
+
+void TypeInference::inferFunction(FunctionDefStatement& function) {
+    Candidates candidates;
+    candidates.statements(function.body->statements);
+
+    // Parameters already live in the frame and can hold anything
+    for (const auto& param : function.parameters) {
+        candidates.names.erase(param);
+    }
+    if (candidates.defines_class || function.is_generator) {
+        // Class bodies can read any enclosing local, and a generator's locals
+        // have to survive its suspensions
+        const char* reason = function.is_generator ? "the function is a generator" : "the function defines a class";
+        for (const auto& name : candidates.names) {
+            candidates.boxed.emplace(name, reason);
+        }
+    }
+
+    DefiniteAssignment(candidates.names, candidates.boxed).statements(function.body->statements);
+
+    // Greatest fixpoint: assume every remaining local is a number and drop
+    // the ones assigned something that is not one under that assumption
+    SymbolSet numbers;
+    for (const auto& name : candidates.names) {
+        if (!candidates.boxed.count(name)) numbers.insert(name);
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto* assign : candidates.assignments) {
+            if (numbers.count(assign->identifier) && !isNumber(*assign->value, numbers)) {
+                numbers.erase(assign->identifier);
+                candidates.boxed.emplace(assign->identifier, "assigned a value that may not be a number");
+                changed = true;
+            }
+        }
+    }
+
+    std::unordered_map<Symbol, int> slots;
+    function.number_locals.clear();
+    for (const auto& name : numbers) {
+        slots.emplace(name, static_cast<int>(function.number_locals.size()));
+        function.number_locals.emplace_back(name);
+    }
+    function.boxed_locals.clear();
+    for (const auto& name : candidates.names) {
+        auto it = candidates.boxed.find(name);
+        if (it != candidates.boxed.end()) function.boxed_locals.emplace_back(name, it->second);
+    }
+
+    SlotAnnotator(slots).statements(function.body->statements);
+}
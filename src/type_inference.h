@@ -0,0 +1,18 @@
+#pragma once
+#include "parser.h"
+
+// Intraprocedural type inference for function locals.
+//
+// Proves which locals always hold numbers: every assignment to them yields a
+// number (a literal, another number local, or arithmetic, which either
+// produces a number or raises), every read comes after an assignment in the
+// same or an enclosing block, and no nested function or class refers to them.
+// Those locals get number slots: the interpreter keeps them as raw doubles in
+// an unboxed frame and evaluates expressions built only from them and
+// literals without allocating. Values are boxed when they escape (passed to
+// calls, stored in containers, returned, mixed with other values).
+class TypeInference {
+public:
+    // Run by the resolver once the function's own scope analysis is done
+    static void inferFunction(FunctionDefStatement& function);
+};
@@ -0,0 +1,137 @@
+# Test augmented assignment (+= -= *= /= %=) on names, attributes and subscripts
+
+n = 10
+n += 5
+n -= 3
+n *= 4
+n /= 6
+print("n:", n)
+n %= 5
+print("n % 5:", n)
+
+# % takes the sign of the divisor
+print("modulo:", 7 % 3, -7 % 3, 7 % -3, -7 % -3, 7.5 % 2)
+
+# Strings
+s = "ab"
+s += "cd"
+s += "e" + "f"
+print("s:", s)
+s += s
+print("s + s:", s)
+
+# A list is extended in place, so aliases see the new items
+items = [1, 2]
+alias = items
+items += [3, 4]
+items += range(5, 7)
+print("items:", items)
+print("alias:", alias)
+items += items
+print("doubled:", len(items), "alias:", len(alias))
+
+# Locals, globals and unboxed numbers in a hot function
+total = 0
+def add_to_total(x):
+    total += x
+
+def sum_squares(limit):
+    acc = 0
+    i = 0
+    while i < limit:
+        acc += i * i
+        i += 1
+    return acc
+
+k = 0
+squares = 0
+while k < 200:
+    squares = sum_squares(10)
+    add_to_total(k)
+    k += 1
+print("sum_squares:", squares, "total:", total)
+
+def remainders(limit, m):
+    count = 0
+    i = 0
+    while i < limit:
+        if i % m == 0:
+            count += 1
+        i += 1
+    return count
+print("multiples of 3 below 20:", remainders(20, 3))
+
+# Attributes
+class Counter:
+    def __init__(self):
+        self.count = 0
+        self.log = []
+        self.name = "c"
+
+    def bump(self, by):
+        self.count += by
+        self.log += [by]
+        self.name += "+"
+
+c = Counter()
+c.bump(2)
+c.bump(3)
+c.count *= 10
+print("counter:", c.count, c.log, c.name)
+
+# Subscripts
+values = [1, 2, 3]
+values[0] = 100
+values[-1] += 5
+values[1] *= 7
+print("values:", values)
+
+nested = [[1], [2]]
+inner = nested[0]
+nested[0] += [9]
+print("nested:", nested, "inner:", inner)
+
+scores = {"a": 1}
+scores["b"] = 2
+scores["a"] += 10
+scores["b"] %= 2
+print("scores a:", scores["a"], "b:", scores["b"])
+
+# The index is evaluated once
+calls = 0
+def position():
+    calls += 1
+    return 1
+values[position()] += 1
+print("values:", values, "calls:", calls)
+
+# Errors
+try:
+    values[10] += 1
+except RuntimeError as e:
+    print("caught:", e)
+try:
+    values[10] = 1
+except RuntimeError as e:
+    print("caught:", e)
+try:
+    scores["missing"] += 1
+except RuntimeError as e:
+    print("caught:", e)
+try:
+    word = "abc"
+    word[0] = "x"
+except RuntimeError as e:
+    print("caught:", e)
+try:
+    items += 5
+except RuntimeError as e:
+    print("caught:", e)
+try:
+    undefined_name += 1
+except RuntimeError as e:
+    print("caught:", e)
+try:
+    x = 5 % 0
+except RuntimeError as e:
+    print("caught:", e)
@@ -0,0 +1,60 @@
+# Test call frames: parameters on the value stack, promoted frames, returns
+
+def fib(n):
+    if n <= 1:
+        return n
+    return fib(n - 1) + fib(n - 2)
+
+print("fib(15):", fib(15))
+
+def countdown(n):
+    steps = 0
+    while n > 0:
+        n = n - 1
+        steps = steps + 1
+    return steps
+
+print("countdown(5):", countdown(5))
+
+def make_adder(x):
+    def add(y):
+        return x + y
+    return add
+
+add3 = make_adder(3)
+print("add3(4):", add3(4))
+
+def first_item(items, item):
+    for item in items:
+        return item
+    return None
+
+print("first_item:", first_item([7, 8, 9], 0))
+
+def nothing():
+    return
+
+print("bare return:", nothing())
+
+def guarded(x):
+    try:
+        return x * 2
+    except:
+        print("not reached")
+    return 0
+
+print("return inside try:", guarded(21))
+
+class Counter:
+    def __init__(self, start):
+        self.value = start
+
+    def bump(self, by):
+        self.value = self.value + by
+        return self
+
+def make_counter():
+    print("make_counter called")
+    return Counter(10)
+
+print("chained value:", make_counter().bump(5).value)
@@ -0,0 +1,70 @@
+# Closures keep only the variables they refer to
+
+def make_counter(start):
+    count = start
+    unused = [1, 2, 3]
+    def increment():
+        count = count + 1
+        return count
+    return increment
+
+counter = make_counter(10)
+print("counter:", counter())
+print("counter:", counter())
+
+# Two closures over the same variable share it
+def make_pair():
+    value = 0
+    def get():
+        return value
+    def set(v):
+        value = v
+    return [get, set]
+
+pair = make_pair()
+getter = pair[0]
+setter = pair[1]
+setter(42)
+print("shared:", getter())
+
+# Recursive local function refers to itself
+def outer(n):
+    def fact(k):
+        if k <= 1:
+            return 1
+        return k * fact(k - 1)
+    return fact(n)
+
+print("fact:", outer(5))
+
+# Variables assigned after the definition are still seen
+def late():
+    def show():
+        return message
+    message = "assigned later"
+    return show
+
+print("late:", late()())
+
+# Globals are looked up through the module scope
+scale = 3
+def make_scaler():
+    factor = 2
+    def apply(x):
+        return x * factor * scale
+    return apply
+
+scaler = make_scaler()
+scale = 5
+print("scaled:", scaler(7))
+
+# Nested closures pass captured variables through
+def level1():
+    a = 1
+    def level2():
+        def level3():
+            return a + 100
+        return level3
+    return level2
+
+print("nested:", level1()()())
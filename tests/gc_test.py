@@ -0,0 +1,61 @@
+# Test the cycle collector
+import gc
+
+class Node:
+    def __init__(self, name):
+        self.name = name
+        self.me = self
+
+def make_counter(start):
+    def counter():
+        return start
+    return counter
+
+gc.collect()
+
+i = 0
+while i < 50:
+    n = Node("node")
+    c = make_counter(i)
+    i = i + 1
+
+freed = gc.collect()
+print("Freed cycles:", freed > 0)
+
+stats = gc.stats()
+print("Collections run:", stats["collections"] >= 2)
+print("Objects freed total:", stats["objects_freed"] >= freed)
+
+gc.set_threshold(500)
+print("Threshold:", gc.stats()["threshold"])
+
+keep = Node("kept")
+gc.collect()
+print("Still alive:", keep.name, keep.me.name)
+
+# A suspended generator whose frame refers back to the object holding it
+class Box:
+    def __init__(self):
+        self.g = None
+
+def produce(owner):
+    yield 1
+    yield 2
+
+gc.collect()
+before = gc.stats()["tracked"]
+j = 0
+while j < 500:
+    b = Box()
+    b.g = produce(b)
+    next(b.g)
+    j = j + 1
+b = None
+print("Freed generator cycles:", gc.collect() > 0)
+print("Tracked objects back down:", gc.stats()["tracked"] <= before + 10)
+
+live = Box()
+live.g = produce(live)
+print("Live generator first:", next(live.g))
+gc.collect()
+print("Live generator second:", next(live.g))
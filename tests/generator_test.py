@@ -0,0 +1,104 @@
+# Test generator functions: yield, resumable frames and for-loop integration
+
+def count_up(start, stop):
+    n = start
+    while n < stop:
+        yield n
+        n = n + 1
+
+for k in count_up(3, 6):
+    print("count_up:", k)
+
+# Each call gets its own frame
+a = count_up(0, 3)
+b = count_up(10, 13)
+print("interleaved:", next(a), next(b), next(a), next(b))
+print("type:", a)
+
+# A pipeline of generators holds one item per stage at a time
+def numbers(limit):
+    for i in range(limit):
+        yield i
+
+def squares(source):
+    for x in source:
+        yield x * x
+
+def above(source, limit):
+    for x in source:
+        if x > limit:
+            yield x
+
+total = 0
+for x in above(squares(numbers(1000)), 250000):
+    total = total + x
+print("sum of squares from 501^2 to 999^2:", total)
+
+# yield without a value, return ending the generator early
+def until_negative(items):
+    for item in items:
+        if item < 0:
+            return
+        yield item
+    yield
+
+for item in until_negative([1, 2, -1, 3]):
+    print("item:", item)
+for item in until_negative([4]):
+    print("item:", item)
+
+# next() with a default, and StopIteration without one
+g = count_up(0, 1)
+print("next:", next(g))
+print("exhausted:", next(g, "done"))
+try:
+    next(g)
+except StopIteration:
+    print("caught StopIteration")
+
+# Exceptions inside the generator reach the consumer, and yield may appear
+# in try bodies and except clauses
+def risky():
+    yield 1
+    try:
+        raise("ValueError", "inside")
+    except ValueError as e:
+        yield "handled " + e
+    yield 2 / 0
+
+try:
+    for value in risky():
+        print("risky:", value)
+except RuntimeError as e:
+    print("consumer caught:", e)
+
+# Closures and nested generators
+def make_counter(step):
+    def gen(n):
+        i = 0
+        while i < n:
+            yield i * step
+            i = i + 1
+    return gen
+
+by_three = make_counter(3)
+for v in by_three(4):
+    print("by three:", v)
+
+# Abandoned generators are cleaned up
+def forever():
+    i = 0
+    while True:
+        yield i
+        i = i + 1
+
+def first_above(limit):
+    for i in forever():
+        if i > limit:
+            return i
+
+print("first_above:", first_above(5))
+started = forever()
+print("started:", next(started), next(started))
+started = None
+print("after dropping a suspended generator")
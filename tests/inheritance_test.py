@@ -0,0 +1,83 @@
+# Single inheritance, method overriding and super()
+
+class Animal:
+    def __init__(self, name):
+        self.name = name
+
+    def speak(self):
+        return "..."
+
+    def describe(self):
+        return self.name + " says " + self.speak()
+
+class Dog(Animal):
+    def speak(self):
+        return "Woof"
+
+class Puppy(Dog):
+    def __init__(self, name, age):
+        super().__init__(name)
+        self.age = age
+
+    def speak(self):
+        return super().speak() + " (squeaky)"
+
+a = Animal("Generic")
+d = Dog("Rex")
+p = Puppy("Bit", 1)
+print(a.describe())
+print(d.describe())
+print(p.describe())
+print("age:", p.age)
+
+# Each level's super() reaches its own parent
+class Base:
+    def chain(self):
+        return "Base"
+
+class Middle(Base):
+    def chain(self):
+        return "Middle>" + super().chain()
+
+class Leaf(Middle):
+    def chain(self):
+        return "Leaf>" + super().chain()
+
+print(Leaf().chain())
+
+# Inherited methods from deep hierarchies
+class L0:
+    def origin(self):
+        return "defined in L0"
+
+class L1(L0):
+    pass_marker = 1
+
+class L2(L1):
+    pass_marker = 2
+
+class L3(L2):
+    pass_marker = 3
+
+print(L3().origin())
+
+# Errors
+try:
+    class Bad(42):
+        x = 1
+except:
+    print("caught: base is not a class")
+
+class Orphan:
+    def call_super(self):
+        return super().missing()
+
+try:
+    Orphan().call_super()
+except:
+    print("caught: no base class")
+
+try:
+    Leaf().missing_method()
+except:
+    print("caught: missing method")
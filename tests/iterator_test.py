@@ -0,0 +1,172 @@
+# Test user-defined iteration with __iter__ and __next__
+
+class Countdown:
+    def __init__(self, start):
+        self.current = start
+    
+    def __iter__(self):
+        return self
+    
+    def __next__(self):
+        if self.current <= 0:
+            raise("StopIteration")
+        self.current = self.current - 1
+        return self.current + 1
+
+for n in Countdown(3):
+    print("countdown:", n)
+
+# A container whose iterator is a separate object
+class Bag:
+    def __init__(self, items):
+        self.items = items
+    
+    def __iter__(self):
+        return BagIterator(self.items)
+
+class BagIterator:
+    def __init__(self, items):
+        self.items = items
+        self.index = 0
+    
+    def __next__(self):
+        if self.index >= len(self.items):
+            raise("StopIteration", "no more items")
+        value = self.items[self.index]
+        self.index = self.index + 1
+        return value
+
+bag = Bag(["a", "b", "c"])
+for item in bag:
+    for other in bag:
+        print("pair:", item + other)
+
+# __iter__ may return any iterable, including a generator
+class Evens:
+    def __init__(self, limit):
+        self.limit = limit
+    
+    def __iter__(self):
+        i = 0
+        while i < self.limit:
+            yield i
+            i = i + 2
+
+class Wrapper:
+    def __init__(self, items):
+        self.items = items
+    
+    def __iter__(self):
+        return self.items
+
+for e in Evens(7):
+    print("even:", e)
+for w in Wrapper(range(2)):
+    print("wrapped:", w)
+
+# Many short loops end without raising a C++ exception
+total = 0
+k = 0
+while k < 2000:
+    for n in Countdown(2):
+        total = total + n
+    k = k + 1
+print("total:", total)
+
+# StopIteration raised further down, or inside a try, still ends the loop
+class Helper:
+    def __init__(self):
+        self.count = 0
+    
+    def __iter__(self):
+        return self
+    
+    def stop(self):
+        raise("StopIteration")
+    
+    def __next__(self):
+        self.count = self.count + 1
+        if self.count > 2:
+            self.stop()
+        return self.count
+
+for h in Helper():
+    print("helper:", h)
+
+class Guarded:
+    def __init__(self):
+        self.done = False
+    
+    def __iter__(self):
+        return self
+    
+    def __next__(self):
+        if self.done:
+            raise("StopIteration")
+        try:
+            raise("StopIteration")
+        except StopIteration:
+            self.done = True
+        return "caught inside __next__"
+
+for g in Guarded():
+    print("guarded:", g)
+
+# A nested call of the loop's own __next__ raises StopIteration as usual,
+# which ends the loop from inside the outer call
+class Nested:
+    def __init__(self):
+        self.calls = 0
+    
+    def __iter__(self):
+        return self
+    
+    def __next__(self):
+        self.calls = self.calls + 1
+        if self.calls > 1:
+            raise("StopIteration")
+        v = self.__next__()
+        print("inner returned", v)
+        return "after inner call"
+
+for nested_item in Nested():
+    print("nested:", nested_item)
+print("nested loop done")
+
+# next() on an iterator object
+it = Countdown(2)
+print("next:", next(it), next(it), next(it, "end"))
+
+# Errors
+class NotIterable:
+    def __init__(self):
+        self.x = 1
+
+try:
+    for x in NotIterable():
+        print(x)
+except RuntimeError as e:
+    print("Error caught:", e)
+
+class NoNext:
+    def __iter__(self):
+        return self
+
+try:
+    for x in NoNext():
+        print(x)
+except RuntimeError as e:
+    print("Error caught:", e)
+
+class Failing:
+    def __iter__(self):
+        return self
+    
+    def __next__(self):
+        raise("ValueError", "broken iterator")
+
+try:
+    for x in Failing():
+        print(x)
+except ValueError as e:
+    print("Error caught:", e)
@@ -0,0 +1,82 @@
+# Test the baseline JIT: hot numeric functions and deoptimization back to the interpreter
+
+def fib(n):
+    if n <= 1:
+        return n
+    return fib(n - 1) + fib(n - 2)
+
+print("fib(20):", fib(20))
+
+def sum_to(n):
+    total = 0
+    i = 0
+    while i < n:
+        total = total + i * 2 - i / 4
+        i = i + 1
+    return total
+
+def compare(a, b):
+    r = 0
+    if a == b:
+        r = r + 1
+    if a != b:
+        r = r + 2
+    if not (a < b) and (a >= b or a <= b):
+        r = r + 4
+    if a > b or False:
+        r = r + 8
+    return r
+
+def divide(a, b):
+    return a / b
+
+def twice(x):
+    return x + x
+
+def first_positive(x):
+    if x > 0:
+        return x
+
+k = 0
+acc = 0
+while k < 200:
+    acc = acc + sum_to(10) + compare(k, 100) + divide(k, 4)
+    first_positive(k)
+    twice(k)
+    k = k + 1
+print("accumulated:", acc)
+
+# Calls that leave the compiled code
+print("twice string:", twice("ab"))
+try:
+    divide(1, 0)
+except:
+    print("caught division by zero")
+print("no return value:", first_positive(-1))
+
+# A local that is a global at call time is assigned by the interpreter
+def bump(x):
+    counter = x + 1
+    return counter
+
+j = 0
+while j < 150:
+    bump(j)
+    j = j + 1
+counter = 0
+print("bump(5):", bump(5), "counter:", counter)
+
+# Rebinding the name a recursive function calls
+def depth(n):
+    if n == 0:
+        return 0
+    return depth(n - 1) + 1
+
+j = 0
+while j < 150:
+    depth(3)
+    j = j + 1
+old_depth = depth
+def depth(n):
+    return 100
+print("old_depth(5):", old_depth(5))
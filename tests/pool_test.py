@@ -0,0 +1,21 @@
+# Test the value and environment pools
+import gc
+
+def square(x):
+    return x * x
+
+total = 0
+i = 0
+while i < 200:
+    total = total + square(i)
+    i = i + 1
+print("Total:", total)
+
+stats = gc.pool_stats()
+print("Pool hits recorded:", stats["hits"] > 0)
+print("Hit rate in range:", stats["hit_rate"] > 0 and stats["hit_rate"] <= 1)
+print("Has size classes:", len(stats["size_classes"]) > 0)
+
+released = gc.trim_pools()
+print("Released bytes:", released >= 0)
+print("Retained after trim is small:", gc.pool_stats()["retained_bytes"] < 4096)
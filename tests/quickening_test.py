@@ -0,0 +1,50 @@
+# Test quickening: operator nodes specialize to operand types and fall back when they change
+
+def add(a, b):
+    return a + b
+
+def lookup(container, key):
+    return container[key]
+
+def negate(x):
+    return -x
+
+def less(a, b):
+    return a < b
+
+print("numbers:", add(1, 2), add(2.5, 4))
+print("strings:", add("ab", "cd"))
+print("lists:", add([1], [2, 3]))
+print("numbers again:", add(5, 6))
+
+print("list by number:", lookup([10, 20, 30], 1), lookup([10, 20, 30], -1))
+print("dict by string:", lookup({"a": 1, "b": 2}, "b"))
+print("list again:", lookup([7, 8], 0))
+
+print("negate:", negate(3), negate(-2.5))
+try:
+    negate("x")
+except:
+    print("caught negate string")
+
+print("less:", less(1, 2), less(3, 2))
+print("equal:", 1 == 1, "a" == "a", "a" != "b", 1 == "1")
+
+def ratio(a, b):
+    return a / b
+
+print("ratio:", ratio(6, 3))
+try:
+    ratio(1, 0)
+except:
+    print("caught division by zero")
+print("ratio after error:", ratio(9, 3))
+
+try:
+    lookup([1, 2], 5)
+except:
+    print("caught index out of range")
+try:
+    lookup({"a": 1}, "z")
+except:
+    print("caught missing key")
@@ -0,0 +1,51 @@
+# Test range() and for loops over ranges, lists and dicts
+
+print("range(5):", range(5), "len:", len(range(5)))
+print("range(2, 8, 3):", range(2, 8, 3), "len:", len(range(2, 8, 3)))
+
+for i in range(3):
+    print("up", i)
+for i in range(10, 0, -4):
+    print("down", i)
+for i in range(5, 5):
+    print("never printed")
+
+# Truthiness and equality compare the numbers produced
+if range(0):
+    print("empty range is true")
+else:
+    print("empty range is false")
+print("range(0, 3) == range(3):", range(0, 3) == range(3))
+print("range(0) == range(4, 2):", range(0) == range(4, 2))
+print("range(1, 5, 2) == range(1, 4, 2):", range(1, 5, 2) == range(1, 4, 2))
+
+# A long loop keeps no list of its numbers
+total = 0
+for i in range(20000):
+    total = total + i
+print("sum of range(20000):", total)
+
+r = range(1, 4)
+for a in r:
+    for b in r:
+        total = a * b
+print("nested over one range:", total)
+
+for key in {"x": 1, "y": 2}:
+    print("key", key)
+for item in [10, 20]:
+    print("item", item)
+
+try:
+    range(1, 2, 0)
+except RuntimeError as e:
+    print("Error caught:", e)
+try:
+    range(1.5)
+except RuntimeError as e:
+    print("Error caught:", e)
+try:
+    for x in 42:
+        print(x)
+except RuntimeError as e:
+    print("Error caught:", e)
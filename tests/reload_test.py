@@ -0,0 +1,24 @@
+# reload() re-executes a module into its existing namespace
+
+import math_utils
+saved_add = math_utils.add
+
+# Re-runs the module body (prints its load message again)
+same = reload(math_utils)
+print("same module:", same == math_utils)
+print("PI:", math_utils.PI)
+
+# Functions taken from the old version keep working
+print("old add:", saved_add(2, 3))
+print("new add:", math_utils.add(2, 3))
+
+import gc
+try:
+    reload(gc)
+except:
+    print("caught: built-in modules cannot be reloaded")
+
+try:
+    reload(42)
+except:
+    print("caught: reload needs a module")
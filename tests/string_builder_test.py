@@ -0,0 +1,82 @@
+# Test building strings by repeated concatenation and with join()
+
+# A string built in a loop is extended in place
+text = ""
+i = 0
+while i < 5:
+    text = text + "ab" + "-"
+    i = i + 1
+print("built:", text, len(text))
+
+# Other references to the string keep the old value
+before = text
+text = text + "end"
+print("alias:", before)
+print("text:", text)
+parts = [text]
+text = text + "!"
+print("in list:", parts[0])
+print("text:", text)
+
+# Inside a function, on a parameter
+def repeat(word, count):
+    result = ""
+    k = 0
+    while k < count:
+        result = result + word
+        k = k + 1
+    return result
+
+print("repeat:", repeat("xy", 4))
+
+# A piece that rebinds the target: the old string is used, as in Python
+log = "start"
+def rebind():
+    log = "changed"
+    return "+piece"
+log = log + rebind()
+print("rebind:", log)
+
+# Concatenating the string with itself
+twice = "ha"
+twice = twice + twice
+print("twice:", twice)
+
+# A piece that is not a string fails and leaves the target unchanged
+msg = "keep"
+try:
+    msg = msg + "more" + 1
+except RuntimeError:
+    print("error, msg:", msg)
+
+# Attributes of an instance
+class Report:
+    def __init__(self):
+        self.body = ""
+    def add(self, line):
+        self.body = self.body + line + ";"
+
+report = Report()
+report.add("one")
+saved = report.body
+report.add("two")
+print("report:", report.body)
+print("saved:", saved)
+
+# Generators can produce the pieces
+def numbers_as_words(limit):
+    words = ["zero", "one", "two", "three"]
+    idx = 0
+    while idx < limit:
+        yield words[idx]
+        idx = idx + 1
+
+print("join:", join(", ", ["a", "b", "c"]))
+print("join empty:", "[" + join(", ", []) + "]")
+print("join single:", join("-", ["solo"]))
+print("join generator:", join(" ", numbers_as_words(4)))
+print("join dict keys:", join("", {"k": 1}))
+try:
+    join(",", ["a", 2])
+except RuntimeError:
+    print("join rejects non-strings")
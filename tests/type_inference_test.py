@@ -0,0 +1,68 @@
+# Test unboxed number locals: inferred numeric locals and the cases that stay boxed
+
+def sum_to(n):
+    total = 0
+    i = 0
+    while i < n:
+        step = i * 2
+        total = total + step - i / 2
+        i = i + 1
+    return total
+
+print("sum_to(100):", sum_to(100))
+
+def mixed(p):
+    label = "items"
+    x = 1
+    y = x + p
+    items = [x, y]
+    for k in items:
+        x = x + k
+    return [label, x, y]
+
+print("mixed(2):", mixed(2))
+
+# A global of the same name is assigned, so the local cannot be unboxed
+count = 0
+def set_count():
+    count = 5
+    return count
+
+print("set_count():", set_count(), "count:", count)
+
+def square_negated(a):
+    b = -a
+    c = b * b
+    return c
+
+print("square_negated(3):", square_negated(3))
+try:
+    square_negated("s")
+except:
+    print("caught negating a string")
+
+def divide_by_zero():
+    zero = 0
+    result = 1 / zero
+    return result
+
+try:
+    divide_by_zero()
+except:
+    print("caught division by zero")
+
+def compare(limit):
+    a = 2
+    b = 3
+    flags = [a < b, a == b, a + 1 == b, a >= limit]
+    return flags
+
+print("compare(2):", compare(2))
+
+def recurse(n):
+    depth = n - 1
+    if depth > 0:
+        return recurse(depth) + 1
+    return 0
+
+print("recurse(10):", recurse(10))